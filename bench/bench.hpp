@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Controls the measurement loop of a single benchmark run. Setup code that
+ * should not be measured is surrounded by pause() and resume().
+ */
+class State {
+public:
+    explicit State(double minSeconds, long maxIterations);
+
+    bool keepRunning();
+
+    void pause();
+
+    void resume();
+
+    void counter(const std::string& name, double value);
+
+    long getIterations() const;
+
+    double getSeconds() const;
+
+    const std::map<std::string, double>& getCounters() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const double mMinSeconds;
+    const long mMaxIterations;
+    long mIterations;
+    bool mStarted;
+    Clock::time_point mBegin;
+    Clock::time_point mPausedAt;
+    double mPausedSeconds;
+    double mSeconds;
+    std::map<std::string, double> mCounters;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State&)> body;
+};
+
+std::vector<Benchmark>& benchmarks();
+
+bool registerBenchmark(const std::string& name, std::function<void(State&)> body);
@@ -0,0 +1,43 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/parser.hpp"
+#include "../src/symbol.hpp"
+#include "../src/default-formatter.hpp"
+#include "../src/glm-formatter.hpp"
+#include "../src/latex-formatter.hpp"
+
+namespace {
+    void formatModelToWorld(State& state, const Formatter& formatter) {
+        Parser parser {};
+        std::stringstream input {workloads::modelToWorld()};
+        parser.parse(input);
+        const Symbol* symbol = parser.get("modelToWorld");
+
+        size_t length = 0;
+        while (state.keepRunning()) {
+            length = symbol->format(formatter).size();
+        }
+        state.counter("characters", (double) length);
+    }
+
+    const bool registered = [] {
+        registerBenchmark("formatter/default", [](State& state) {
+            formatModelToWorld(state, DefaultFormatter{});
+        });
+        registerBenchmark("formatter/default-pretty", [](State& state) {
+            formatModelToWorld(state, DefaultFormatter{true});
+        });
+        registerBenchmark("formatter/glm", [](State& state) {
+            formatModelToWorld(state, GlmFormatter{});
+        });
+        registerBenchmark("formatter/latex", [](State& state) {
+            formatModelToWorld(state, LatexFormatter{});
+        });
+        return true;
+    }();
+}
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "bench.hpp"
+
+State::State(double minSeconds, long maxIterations) :
+    mMinSeconds{minSeconds}, mMaxIterations{maxIterations}, mIterations{0},
+    mStarted{false}, mBegin{}, mPausedAt{}, mPausedSeconds{0.0},
+    mSeconds{0.0}, mCounters{} {}
+
+bool State::keepRunning() {
+    const auto now = Clock::now();
+    if (!mStarted) {
+        mStarted = true;
+        mBegin = now;
+        return true;
+    }
+
+    mIterations++;
+    mSeconds = std::chrono::duration<double>(now - mBegin).count() - mPausedSeconds;
+    return mIterations < mMaxIterations && mSeconds < mMinSeconds;
+}
+
+void State::pause() {
+    mPausedAt = Clock::now();
+}
+
+void State::resume() {
+    mPausedSeconds += std::chrono::duration<double>(Clock::now() - mPausedAt).count();
+}
+
+void State::counter(const std::string& name, double value) {
+    mCounters[name] = value;
+}
+
+long State::getIterations() const {
+    return mIterations;
+}
+
+double State::getSeconds() const {
+    return mSeconds;
+}
+
+const std::map<std::string, double>& State::getCounters() const {
+    return mCounters;
+}
+
+std::vector<Benchmark>& benchmarks() {
+    static std::vector<Benchmark> instance;
+    return instance;
+}
+
+bool registerBenchmark(const std::string& name, std::function<void(State&)> body) {
+    benchmarks().push_back(Benchmark{name, std::move(body)});
+    return true;
+}
+
+namespace {
+    struct Result {
+        std::string name;
+        long iterations;
+        double meanNs, minNs, maxNs, stddevNs;
+        std::map<std::string, double> counters;
+    };
+
+    void printUsage(const char* executable) {
+        std::cerr << "Usage: " << executable << " [options]\n"
+            " --filter text      only run benchmarks with names containing text\n"
+            " --format json|csv  format of the results (default json)\n"
+            " --min-time seconds minimum time of each repetition (default 0.1)\n"
+            " --repetitions n    number of repetitions (default 5)\n"
+            " --list             list the benchmarks and exit\n";
+    }
+
+    void printJson(const std::vector<Result>& results, int repetitions) {
+        std::cout << "{\"repetitions\":" << repetitions << ",\"benchmarks\":[";
+        for (std::vector<Result>::size_type i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            if (i > 0) std::cout << ",";
+            std::cout << "\n{\"name\":\"" << r.name << "\""
+                << ",\"iterations\":" << r.iterations
+                << ",\"mean_ns\":" << r.meanNs
+                << ",\"min_ns\":" << r.minNs
+                << ",\"max_ns\":" << r.maxNs
+                << ",\"stddev_ns\":" << r.stddevNs;
+            for (auto& counter : r.counters) {
+                std::cout << ",\"" << counter.first << "\":" << counter.second;
+            }
+            std::cout << "}";
+        }
+        std::cout << "\n]}" << std::endl;
+    }
+
+    void printCsv(const std::vector<Result>& results) {
+        std::cout << "name,iterations,mean_ns,min_ns,max_ns,stddev_ns,counters" << std::endl;
+        for (auto& r : results) {
+            std::cout << r.name << "," << r.iterations << "," << r.meanNs << ","
+                      << r.minNs << "," << r.maxNs << "," << r.stddevNs << ",";
+            bool first = true;
+            for (auto& counter : r.counters) {
+                if (!first) std::cout << ";";
+                std::cout << counter.first << "=" << counter.second;
+                first = false;
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    bool json = true;
+    bool list = false;
+    double minSeconds = 0.1;
+    int repetitions = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--format") == 0 && hasValue) {
+            json = std::strcmp(argv[++i], "csv") != 0;
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            minSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (auto& benchmark : benchmarks()) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+        if (list) {
+            std::cout << benchmark.name << std::endl;
+            continue;
+        }
+
+        Result result {benchmark.name, 0, 0.0, INFINITY, 0.0, 0.0, {}};
+        std::vector<double> samples;
+        for (int r = 0; r < repetitions; r++) {
+            State state {minSeconds, 1000000};
+            benchmark.body(state);
+            if (state.getIterations() == 0) continue;
+
+            samples.push_back(state.getSeconds() * 1e9 / state.getIterations());
+            result.iterations += state.getIterations();
+            result.counters = state.getCounters();
+        }
+
+        for (double sample : samples) {
+            result.meanNs += sample / samples.size();
+            result.minNs = std::min(result.minNs, sample);
+            result.maxNs = std::max(result.maxNs, sample);
+        }
+        for (double sample : samples) {
+            result.stddevNs += (sample - result.meanNs) * (sample - result.meanNs) / samples.size();
+        }
+        result.stddevNs = std::sqrt(result.stddevNs);
+
+        results.push_back(result);
+        std::cerr << benchmark.name << ": " << result.meanNs << " ns" << std::endl;
+    }
+
+    if (list) return 0;
+    if (json) printJson(results, repetitions);
+    else printCsv(results);
+    return 0;
+}
@@ -0,0 +1,269 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include <vector>
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/block-matrix.hpp"
+#include "../src/constant.hpp"
+#include "../src/dense.hpp"
+#include "../src/matrix.hpp"
+#include "../src/parser.hpp"
+#include "../src/sparse.hpp"
+
+namespace {
+    const bool registered = [] {
+        for (int size : {2, 4, 8, 16, 32}) {
+            registerBenchmark("matrix/multiply/" + std::to_string(size), [size](State& state) {
+                auto* left = workloads::symbolicMatrix(size, "a");
+                auto* right = workloads::symbolicMatrix(size, "b");
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = left->copy();
+                    auto* rhs = right->copy();
+                    state.resume();
+
+                    auto* result = *lhs * rhs;
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete left;
+                delete right;
+            });
+
+            // A single element of the product, without computing the rest
+            registerBenchmark("matrix/element/" + std::to_string(size), [size](State& state) {
+                const std::string source = workloads::symbolicProduct(size);
+                while (state.keepRunning()) {
+                    Parser parser {};
+                    parser.setLazy(true);
+                    std::stringstream input {source};
+                    parser.parse(input);
+                    delete parser.find("C[0,0]");
+                }
+            });
+        }
+
+        // Triangular and diagonal operands only multiply where they overlap
+        for (int size : {16, 32}) {
+            auto triangle = [size](const std::string& prefix, bool diagonal) {
+                auto* matrix = workloads::symbolicMatrix(size, prefix);
+                for (int i = 0; i < size; i++) {
+                    for (int j = 0; j < (diagonal ? size : i); j++) {
+                        if (i != j) matrix->set(i, j, new Constant{0.0f});
+                    }
+                }
+                return matrix;
+            };
+
+            for (const char* kind : {"triangular", "diagonal"}) {
+                const bool diagonal = kind[0] == 'd';
+                registerBenchmark("matrix/" + std::string(kind) + "/" + std::to_string(size),
+                        [size, diagonal, triangle](State& state) {
+                    auto* left = triangle("a", diagonal);
+                    auto* right = diagonal ? workloads::symbolicMatrix(size, "b") : triangle("b", false);
+                    while (state.keepRunning()) {
+                        state.pause();
+                        auto* lhs = left->copy();
+                        auto* rhs = right->copy();
+                        state.resume();
+
+                        auto* result = *lhs * rhs;
+
+                        state.pause();
+                        delete result;
+                        state.resume();
+                    }
+                    delete left;
+                    delete right;
+                });
+            }
+        }
+
+        // Gram matrices, like the normal equations A' * A
+        for (int size : {4, 16, 32}) {
+            registerBenchmark("matrix/gram/" + std::to_string(size), [size](State& state) {
+                auto* matrix = workloads::symbolicMatrix(size, "a");
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = dynamic_cast<Matrix*>(matrix->copy())->transpose();
+                    auto* rhs = matrix->copy();
+                    state.resume();
+
+                    auto* result = *lhs * rhs;
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete matrix;
+            });
+        }
+
+        // The sizes of the transforms that most inputs are made of
+        for (int size : {2, 3, 4}) {
+            registerBenchmark("matrix/numeric/" + std::to_string(size), [size](State& state) {
+                auto* left = Matrix::zero(size, size);
+                auto* right = Matrix::zero(size, size);
+                for (int i = 0; i < size; i++) {
+                    for (int j = 0; j < size; j++) {
+                        left->set(i, j, new Constant{(float) (i + 2 * j + 1)});
+                        right->set(i, j, new Constant{(float) (3 * i - j)});
+                    }
+                }
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = left->copy();
+                    auto* rhs = right->copy();
+                    state.resume();
+
+                    auto* result = *(*lhs * rhs) + left->copy();
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete left;
+                delete right;
+            });
+
+            registerBenchmark("matrix/symbolic/" + std::to_string(size), [size](State& state) {
+                auto* left = workloads::symbolicMatrix(size, "a");
+                auto* right = workloads::symbolicMatrix(size, "b");
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = left->copy();
+                    auto* rhs = right->copy();
+                    state.resume();
+
+                    auto* result = *(*lhs * rhs) + left->copy();
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete left;
+                delete right;
+            });
+        }
+
+        // A chain of joints as a 3x3 grid of 4x4 blocks, where the blocks
+        // under the diagonal are zero and those on it the identity
+        auto joints = [](const std::string& prefix) {
+            std::vector<Symbol*> blocks;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    if (i == j) blocks.push_back(Matrix::eye(4));
+                    else if (i > j) blocks.push_back(new Constant{0.0f});
+                    else blocks.push_back(workloads::symbolicMatrix(4, prefix + std::to_string(i * 3 + j)));
+                }
+            }
+            return BlockMatrix::of(3, 3, std::move(blocks));
+        };
+
+        for (const char* kind : {"grid", "flat"}) {
+            const bool flat = kind[0] == 'f';
+            registerBenchmark("matrix/blocks/" + std::string(kind), [flat, joints](State& state) {
+                Symbol* left = joints("a");
+                Symbol* right = joints("b");
+                if (flat) {
+                    left = BlockMatrix::flatten(left);
+                    right = BlockMatrix::flatten(right);
+                }
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = left->copy();
+                    auto* rhs = right->copy();
+                    state.resume();
+
+                    auto* result = *lhs * rhs;
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete left;
+                delete right;
+            });
+        }
+
+        for (int size : {64, 256}) {
+            // Scales every column of a numeric matrix by its own factor
+            auto* image = Matrix::zero(size, size);
+            auto* scale = Matrix::zero(1, size);
+            for (int i = 0; i < size; i++) {
+                scale->set(0, i, new Constant{1.0f + (float) i / size});
+                for (int j = 0; j < size; j++) {
+                    image->set(i, j, new Constant{(float) (i * size + j)});
+                }
+            }
+
+            registerBenchmark("matrix/elementwise/" + std::to_string(size), [image, scale](State& state) {
+                while (state.keepRunning()) {
+                    auto* result = image->multiplyElements(scale);
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+            });
+        }
+
+        for (int size : {128, 512}) {
+            // Diagonally dominant, so it is both invertible and positive definite
+            std::vector<double> values((std::size_t) size * size);
+            for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                    values[i * size + j] = i == j ? size : 1.0 / (1 + i + j);
+                }
+            }
+
+            registerBenchmark("dense/lu/" + std::to_string(size), [size, values](State& state) {
+                std::vector<int> pivots;
+                while (state.keepRunning()) {
+                    state.pause();
+                    std::vector<double> factors {values};
+                    state.resume();
+
+                    Dense::factorLU(factors, size, pivots);
+                }
+            });
+
+            registerBenchmark("dense/cholesky/" + std::to_string(size), [size, values](State& state) {
+                while (state.keepRunning()) {
+                    state.pause();
+                    std::vector<double> factors {values};
+                    state.resume();
+
+                    Dense::factorCholesky(factors, size);
+                }
+            });
+        }
+
+        for (int side : {32, 128}) {
+            // The five-point Laplacian, with one unknown per grid point
+            std::vector<Sparse::Entry> entries;
+            for (int i = 0; i < side * side; i++) {
+                entries.push_back({i, i, 4.0});
+                if (i >= side) entries.push_back({i, i - side, -1.0});
+                if (i + side < side * side) entries.push_back({i, i + side, -1.0});
+                if (i % side > 0) entries.push_back({i, i - 1, -1.0});
+                if (i % side < side - 1) entries.push_back({i, i + 1, -1.0});
+            }
+            const Sparse laplacian {side * side, side * side, std::move(entries)};
+
+            registerBenchmark("sparse/cg/" + std::to_string(side * side), [laplacian](State& state) {
+                const std::vector<double> right(laplacian.getRows(), 1.0);
+                while (state.keepRunning()) {
+                    std::vector<double> solution(laplacian.getRows(), 0.0);
+                    laplacian.conjugateGradient(right, solution);
+                }
+            });
+        }
+        return true;
+    }();
+}
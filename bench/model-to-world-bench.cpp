@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/parser.hpp"
+#include "../src/default-formatter.hpp"
+#include "../src/symbol.hpp"
+
+namespace {
+    // The canonical end-to-end workload: parse, substitute, optimize and
+    // format the model-to-world transform.
+    const bool registered = registerBenchmark("model-to-world", [](State& state) {
+        const std::string source = workloads::modelToWorld();
+        DefaultFormatter formatter {};
+        while (state.keepRunning()) {
+            Parser parser {};
+            std::stringstream input {source};
+            parser.parse(input);
+            parser.format(formatter);
+        }
+    });
+
+    // Only the translation column, computed lazily
+    const bool registeredColumn = registerBenchmark("model-to-world/translation", [](State& state) {
+        const std::string source = workloads::modelToWorld();
+        DefaultFormatter formatter {};
+        while (state.keepRunning()) {
+            Parser parser {};
+            parser.setLazy(true);
+            std::stringstream input {source};
+            parser.parse(input);
+            Symbol* column = parser.find("modelToWorld[:,3]");
+            column->format(formatter);
+            delete column;
+        }
+    });
+}
@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/optimizer.hpp"
+#include "../src/parser.hpp"
+#include "../src/symbol.hpp"
+
+namespace {
+    const bool registered = [] {
+        for (int level : {1, 2}) {
+            registerBenchmark("optimizer/model-to-world/O" + std::to_string(level), [level](State& state) {
+                // Parse without optimizing to get the substituted expression
+                Parser parser {};
+                parser.getOptimizer().setLevel(0);
+                std::stringstream input {workloads::modelToWorld()};
+                parser.parse(input);
+
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* expression = parser.get("modelToWorld")->copy();
+                    state.resume();
+
+                    // A new optimizer every iteration so that the memo is empty
+                    Optimizer optimizer {level};
+
+                    auto* result = optimizer.optimize(expression);
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+            });
+        }
+        return true;
+    }();
+}
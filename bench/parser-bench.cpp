@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/parser.hpp"
+
+namespace {
+    const bool registered = [] {
+        for (int count : {10, 100, 1000}) {
+            registerBenchmark("parser/statements/" + std::to_string(count), [count](State& state) {
+                const std::string source = workloads::statements(count);
+                while (state.keepRunning()) {
+                    Parser parser {};
+                    std::stringstream input {source};
+                    parser.parse(input);
+                }
+                state.counter("bytes", (double) source.size());
+            });
+        }
+
+        registerBenchmark("parser/jacobian/modelToWorld", [](State& state) {
+            const std::string source = workloads::modelToWorld() +
+                "J = jacobian(modelToWorld[0:2,3], [a_x, a_y, cosR, sinR, p_x, p_y, o_x, o_y]);\n";
+            while (state.keepRunning()) {
+                Parser parser {};
+                std::stringstream input {source};
+                parser.parse(input);
+            }
+        });
+        return true;
+    }();
+}
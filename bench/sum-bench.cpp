@@ -0,0 +1,33 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include "bench.hpp"
+#include "workloads.hpp"
+#include "../src/symbol.hpp"
+
+namespace {
+    const bool registered = [] {
+        for (int terms : {2, 4, 8, 16}) {
+            registerBenchmark("sum/expand/" + std::to_string(terms), [terms](State& state) {
+                auto* left = workloads::symbolicSum(terms, "a");
+                auto* right = workloads::symbolicSum(terms, "b");
+                while (state.keepRunning()) {
+                    state.pause();
+                    auto* lhs = left->copy();
+                    auto* rhs = right->copy();
+                    state.resume();
+
+                    auto* result = *lhs * rhs;
+
+                    state.pause();
+                    delete result;
+                    state.resume();
+                }
+                delete left;
+                delete right;
+            });
+        }
+        return true;
+    }();
+}
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include "workloads.hpp"
+
+#include <sstream>
+#include "../src/matrix.hpp"
+#include "../src/variable.hpp"
+
+namespace workloads {
+
+    std::string name(const std::string& prefix, int index) {
+        // Always three letters so that names sort in the order they were
+        // generated in
+        std::string letters(3, 'a');
+        for (int i = 2; i >= 0; i--) {
+            letters[i] = (char) ('a' + index % 26);
+            index /= 26;
+        }
+        return prefix + "_" + letters;
+    }
+
+    std::string modelToWorld() {
+        return
+            "A = [a_x,0,0,0; 0,a_y,0,0; 0,0,1,0; 0,0,0,1];\n"
+            "O = [1,0,0,-o_x; 0,1,0,o_y-1; 0,0,1,0; 0,0,0,1];\n"
+            "P = [1,0,0,p_x; 0,1,0,p_y; 0,0,1,0; 0,0,0,1];\n"
+            "R = [cosR,sinR,0,0; -sinR,cosR,0,0; 0,0,1,0; 0,0,0,1];\n"
+            "S = [s_x,0,0,0; 0,s_y,0,0; 0,0,1,0; 0,0,0,1];\n"
+            "M = [1,0,0,0; 0,-1,0,0; 0,0,1,0; 0,0,0,1];\n"
+            "modelToWorld = P*M*S*R*A*O;\n";
+    }
+
+    std::string statements(int count) {
+        std::ostringstream ss;
+        for (int i = 0; i < count; i++) {
+            ss << name("x", i) << " = 3*" << name("a", i) << "*" << name("b", i)
+               << " + 2*" << name("c", i) << " - " << name("a", i) << "*"
+               << name("b", i) << " + " << (i % 7) << ".5;\n";
+        }
+        return ss.str();
+    }
+
+    std::string defineChain(int length) {
+        std::ostringstream ss;
+        ss << name("d", 0) << " = [c,s;s,c];\n";
+        for (int i = 1; i < length; i++) {
+            ss << name("d", i) << " = " << name("d", i - 1) << " + [a,0;0,b];\n";
+        }
+        return ss.str();
+    }
+
+    std::string numericProduct(int size) {
+        std::ostringstream ss;
+        for (const char* matrix : {"A", "B"}) {
+            ss << matrix << " = [";
+            for (int i = 0; i < size; i++) {
+                if (i > 0) ss << ";";
+                for (int j = 0; j < size; j++) {
+                    if (j > 0) ss << ",";
+                    const int seed = matrix[0] == 'A' ? 0 : 13;
+                    ss << ((i * 31 + j * 17 + seed) % 97) << "." << ((i + j) % 10);
+                }
+            }
+            ss << "];\n";
+        }
+        ss << "C = A*B;\n";
+        return ss.str();
+    }
+
+    std::string symbolicProduct(int size) {
+        std::ostringstream ss;
+        for (const char* matrix : {"A", "B"}) {
+            ss << matrix << " = [";
+            for (int i = 0; i < size; i++) {
+                if (i > 0) ss << ";";
+                for (int j = 0; j < size; j++) {
+                    if (j > 0) ss << ",";
+                    ss << name(matrix[0] == 'A' ? "a" : "b", i * size + j);
+                }
+            }
+            ss << "];\n";
+        }
+        ss << "C = A*B;\n";
+        return ss.str();
+    }
+
+    std::string sumProduct(int terms) {
+        std::ostringstream ss;
+        ss << "x = (";
+        for (int i = 0; i < terms; i++) {
+            if (i > 0) ss << "+";
+            ss << name("a", i);
+        }
+        ss << ")*(";
+        for (int i = 0; i < terms; i++) {
+            if (i > 0) ss << "+";
+            ss << name("b", i);
+        }
+        ss << ");\n";
+        return ss.str();
+    }
+
+    Matrix* symbolicMatrix(int size, const std::string& prefix) {
+        auto* matrix = Matrix::zero(size, size);
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                matrix->set(i, j, new Variable{name(prefix, i * size + j)});
+            }
+        }
+        return matrix;
+    }
+
+    Symbol* symbolicSum(int terms, const std::string& prefix) {
+        Symbol* sum = new Variable{name(prefix, 0)};
+        for (int i = 1; i < terms; i++) {
+            sum = *sum + new Variable{name(prefix, i)};
+        }
+        return sum;
+    }
+}
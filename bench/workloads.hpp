@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+
+class Symbol;
+class Matrix;
+
+/**
+ * Deterministic inputs shared by the benchmarks and the performance suite.
+ */
+namespace workloads {
+
+    /**
+     * Names can only contain letters and underscores, so indices are
+     * written in base 26 using the letters a to z.
+     */
+    std::string name(const std::string& prefix, int index);
+
+    /**
+     * Source text of the model-to-world transform, P*M*S*R*A*O.
+     */
+    std::string modelToWorld();
+
+    /**
+     * Source text with the given number of independent scalar statements.
+     */
+    std::string statements(int count);
+
+    /**
+     * Source text where every define uses the previous one.
+     */
+    std::string defineChain(int length);
+
+    /**
+     * Source text of a product of two numeric matrices whose literals have
+     * the given number of elements per row.
+     */
+    std::string numericProduct(int size);
+
+    /**
+     * Source text of a product of two symbolic matrices of the given size.
+     */
+    std::string symbolicProduct(int size);
+
+    /**
+     * Source text of a product of two sums with the given number of terms.
+     */
+    std::string sumProduct(int terms);
+
+    Matrix* symbolicMatrix(int size, const std::string& prefix);
+
+    Symbol* symbolicSum(int terms, const std::string& prefix);
+}
@@ -0,0 +1,291 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../bench/workloads.hpp"
+#include "../src/parser.hpp"
+#include "../src/stats.hpp"
+
+/**
+ * Scaling suite that solves workloads of increasing size and compares the
+ * time, the peak memory and the number of output nodes against the baselines
+ * checked in next to this file. Times are compared relative to a calibration
+ * workload so that baselines can be shared between machines and build types.
+ */
+namespace {
+    struct Family {
+        std::string name;
+        std::vector<int> sizes;
+        std::function<std::string(int)> source;
+        std::function<std::string(int)> output;
+
+        // The expected growth of the workload, as the largest accepted
+        // exponent k in cost ~ size^k between two consecutive sizes.
+        double nodeExponent;
+        double memoryExponent;
+        double timeExponent;
+    };
+
+    struct Measurement {
+        double seconds;
+        long peakBytes;
+        long nodes;
+    };
+
+    // Exponents are allowed to exceed the expected ones by this much, since
+    // lower order terms still matter at these sizes.
+    const double SIZE_SLACK = 0.25;
+    const double TIME_SLACK = 0.75;
+
+    // Times shorter than this are too noisy to compare.
+    const double TIME_FLOOR = 0.002;
+
+    std::vector<Family> families() {
+        return {
+            // Adding each product to an element scans the terms already there.
+            {"symbolic-product", {2, 4, 8, 12}, workloads::symbolicProduct,
+                [](int) { return std::string{"C"}; }, 3.0, 3.0, 3.5},
+
+            // Sum::operator* compares every new term with all previous terms,
+            // so the time is quadratic in the number of output terms.
+            {"sum-product", {4, 8, 16, 24}, workloads::sumProduct,
+                [](int) { return std::string{"x"}; }, 2.0, 2.0, 4.0},
+
+            // Every define keeps its own substituted copy of the chain.
+            {"define-chain", {8, 16, 32, 64}, workloads::defineChain,
+                [](int size) { return workloads::name("d", size - 1); }, 1.0, 2.0, 2.0},
+
+            {"numeric-literals", {8, 16, 32, 64}, workloads::numericProduct,
+                [](int) { return std::string{"C"}; }, 2.0, 2.0, 3.0}
+        };
+    }
+
+    Measurement measure(const std::string& source, const std::string& output) {
+        Measurement result {INFINITY, 0, 0};
+
+        // Repeat short workloads and keep the fastest run
+        double total = 0.0;
+        for (int run = 0; run < 3 || (total < 0.2 && run < 50); run++) {
+            Stats::resetPeaks();
+            const long liveBefore = Stats::getPeakLiveBytes();
+            const auto begin = std::chrono::steady_clock::now();
+
+            Parser parser {};
+            std::stringstream input {source};
+            parser.parse(input);
+
+            const double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - begin).count();
+
+            total += seconds;
+            result.seconds = std::min(result.seconds, seconds);
+            result.peakBytes = Stats::getPeakLiveBytes() - liveBefore;
+            result.nodes = Stats::countNodes(parser.get(output));
+            if (seconds > 1.0) break;
+        }
+
+        return result;
+    }
+
+    std::string key(const std::string& workload, int size) {
+        return workload + "/" + std::to_string(size);
+    }
+
+    std::map<std::string, Measurement> readBaselines(const std::string& filename) {
+        std::map<std::string, Measurement> baselines;
+        std::ifstream in(filename);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream row {line};
+            std::string workload;
+            int size;
+            Measurement measurement {};
+            if (row >> workload >> size >> measurement.seconds
+                    >> measurement.peakBytes >> measurement.nodes) {
+                baselines[key(workload, size)] = measurement;
+            }
+        }
+        return baselines;
+    }
+
+    void writeBaselines(const std::string& filename,
+                        const std::vector<std::pair<std::string, Measurement>>& rows) {
+        std::ofstream out(filename, std::ios::trunc);
+        out << "# Generated by solve_perf --update. Times are only compared" << std::endl
+            << "# relative to the calibration row." << std::endl
+            << "# workload,size,seconds,peak_bytes,nodes" << std::endl;
+        for (auto& row : rows) {
+            const auto slash = row.first.rfind('/');
+            out << row.first.substr(0, slash) << ","
+                << row.first.substr(slash + 1) << ","
+                << std::setprecision(6) << row.second.seconds << ","
+                << row.second.peakBytes << ","
+                << row.second.nodes << std::endl;
+        }
+    }
+
+    double exponent(double smaller, double larger, int fromSize, int toSize) {
+        return std::log(larger / smaller) / std::log((double) toSize / fromSize);
+    }
+
+    void printUsage(const char* executable) {
+        std::cerr << "Usage: " << executable << " [options]\n"
+            " --baselines file        csv file with the expected results\n"
+            " --update                overwrite the baselines with this run\n"
+            " --filter text           only run workloads with names containing text\n"
+            " --time-tolerance x      accepted slowdown factor (default 3)\n"
+            " --memory-tolerance x    accepted peak memory factor (default 1.25)\n"
+            " --node-tolerance x      accepted output size factor (default 1.1)\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string baselinesFilename;
+    std::string filter;
+    bool update = false;
+    double timeTolerance = 3.0;
+    double memoryTolerance = 1.25;
+    double nodeTolerance = 1.1;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--baselines") == 0 && hasValue) {
+            baselinesFilename = argv[++i];
+        } else if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--time-tolerance") == 0 && hasValue) {
+            timeTolerance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--memory-tolerance") == 0 && hasValue) {
+            memoryTolerance = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--node-tolerance") == 0 && hasValue) {
+            nodeTolerance = std::atof(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const auto baselines = readBaselines(baselinesFilename);
+    std::vector<std::pair<std::string, Measurement>> rows;
+    std::vector<std::string> failures;
+
+    const Measurement calibration = measure(workloads::modelToWorld(), "modelToWorld");
+    rows.emplace_back(key("calibration", 0), calibration);
+
+    double baselineCalibration = calibration.seconds;
+    auto found = baselines.find(key("calibration", 0));
+    if (found != baselines.end()) baselineCalibration = found->second.seconds;
+    const double scale = calibration.seconds / baselineCalibration;
+
+    std::cout << std::left << std::setw(24) << "workload"
+              << std::right << std::setw(12) << "ms"
+              << std::setw(12) << "peak bytes"
+              << std::setw(10) << "nodes"
+              << std::setw(10) << "k(time)"
+              << std::setw(10) << "k(nodes)"
+              << std::setw(10) << "k(bytes)" << "  status" << std::endl;
+
+    for (auto& family : families()) {
+        if (family.name.find(filter) == std::string::npos) continue;
+
+        Measurement previous {};
+        for (std::vector<int>::size_type s = 0; s < family.sizes.size(); s++) {
+            const int size = family.sizes[s];
+            const std::string name = key(family.name, size);
+            const Measurement current = measure(family.source(size), family.output(size));
+            rows.emplace_back(name, current);
+
+            std::vector<std::string> problems;
+
+            // Compare with the stored baseline
+            auto baseline = baselines.find(name);
+            if (baseline == baselines.end()) {
+                problems.emplace_back("no baseline");
+            } else if (!update) {
+                const Measurement& expected = baseline->second;
+                const double allowed = std::max(expected.seconds, TIME_FLOOR) * scale * timeTolerance;
+                if (current.seconds > allowed) {
+                    failures.push_back(name + " is " + std::to_string(current.seconds / (expected.seconds * scale)) + "x slower than its baseline");
+                    problems.emplace_back("slower");
+                }
+                if (current.peakBytes > expected.peakBytes * memoryTolerance) {
+                    failures.push_back(name + " uses " + std::to_string(current.peakBytes) + " bytes, baseline is " + std::to_string(expected.peakBytes));
+                    problems.emplace_back("memory");
+                }
+                if (current.nodes > expected.nodes * nodeTolerance) {
+                    failures.push_back(name + " produced " + std::to_string(current.nodes) + " nodes, baseline is " + std::to_string(expected.nodes));
+                    problems.emplace_back("nodes");
+                }
+            }
+
+            // Look for superlinear blowups between consecutive sizes
+            double timeExponent = NAN, nodeExponent = NAN, memoryExponent = NAN;
+            if (s > 0) {
+                const int previousSize = family.sizes[s - 1];
+                nodeExponent = exponent(previous.nodes, current.nodes, previousSize, size);
+                if (nodeExponent > family.nodeExponent + SIZE_SLACK) {
+                    failures.push_back(name + " output grows as size^" + std::to_string(nodeExponent) + ", expected at most size^" + std::to_string(family.nodeExponent));
+                    problems.emplace_back("node growth");
+                }
+
+                memoryExponent = exponent(previous.peakBytes, current.peakBytes, previousSize, size);
+                if (memoryExponent > family.memoryExponent + SIZE_SLACK) {
+                    failures.push_back(name + " peak memory grows as size^" + std::to_string(memoryExponent) + ", expected at most size^" + std::to_string(family.memoryExponent));
+                    problems.emplace_back("memory growth");
+                }
+
+                if (previous.seconds >= TIME_FLOOR) {
+                    timeExponent = exponent(previous.seconds, current.seconds, previousSize, size);
+                    if (timeExponent > family.timeExponent + TIME_SLACK) {
+                        failures.push_back(name + " time grows as size^" + std::to_string(timeExponent) + ", expected at most size^" + std::to_string(family.timeExponent));
+                        problems.emplace_back("time growth");
+                    }
+                }
+            }
+            previous = current;
+
+            std::string status = problems.empty() ? "ok" : "";
+            for (auto& problem : problems) {
+                if (!status.empty()) status += ", ";
+                status += problem;
+            }
+
+            std::cout << std::left << std::setw(24) << name << std::right
+                      << std::setw(12) << std::fixed << std::setprecision(3) << (current.seconds * 1000.0)
+                      << std::setw(12) << current.peakBytes
+                      << std::setw(10) << current.nodes
+                      << std::setw(10) << std::setprecision(2) << timeExponent
+                      << std::setw(10) << nodeExponent
+                      << std::setw(10) << memoryExponent
+                      << "  " << status << std::endl;
+        }
+    }
+
+    if (update) {
+        writeBaselines(baselinesFilename, rows);
+        std::cout << "Baselines written to " << baselinesFilename << "." << std::endl;
+        return 0;
+    }
+
+    for (auto& failure : failures) {
+        std::cerr << "FAILED: " << failure << std::endl;
+    }
+    return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+// Replaces the global allocation functions so that every heap allocation is
+// included in the --stats report. This adds a small header to every block, so
+// it is only compiled in when configured with -DSOLVE_TRACK_ALLOCATIONS=ON.
+#ifdef SOLVE_TRACK_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "stats.hpp"
+
+namespace {
+    // The size of the block is stored in front of it, padded to keep the
+    // alignment guaranteed by operator new.
+    constexpr std::size_t HEADER = alignof(std::max_align_t);
+}
+
+void* operator new(std::size_t size) {
+    void* block = std::malloc(size + HEADER);
+    if (block == nullptr) throw std::bad_alloc();
+    *static_cast<std::size_t*>(block) = size;
+    Stats::bytesAllocated(size);
+    return static_cast<char*>(block) + HEADER;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr) return;
+    void* block = static_cast<char*>(pointer) - HEADER;
+    Stats::bytesFreed(*static_cast<std::size_t*>(block));
+    std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "bareiss.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "constant.hpp"
+#include "fraction.hpp"
+#include "governor.hpp"
+#include "matrix.hpp"
+#include "trace.hpp"
+
+namespace {
+    void assertSquare(const Matrix* matrix, const char* operation) {
+        if (matrix->getRows() != matrix->getColumns()) {
+            throw std::invalid_argument(
+                std::string("Can't compute the ") + operation + " of a non-square [" +
+                std::to_string(matrix->getRows()) + ", " +
+                std::to_string(matrix->getColumns()) + "] matrix.");
+        }
+    }
+}
+
+Symbol *Bareiss::determinant(const Matrix* matrix) {
+    assertSquare(matrix, "determinant");
+    Trace::Span span {"determinant", matrix->getRows() >= 4};
+
+    Rows rows = toRows(matrix, nullptr);
+    const int sign = eliminate(rows);
+    if (sign == 0) return new Constant{0.0f};
+
+    const Polynomial& last = rows.back().back();
+    return (sign > 0 ? last : -last).toSymbol();
+}
+
+Matrix *Bareiss::solve(const Matrix* left, const Matrix* right) {
+    assertSquare(left, "solution");
+    if (right->getRows() != left->getRows()) {
+        throw std::invalid_argument(
+            "Can't solve a [" + std::to_string(left->getRows()) + ", " +
+            std::to_string(left->getColumns()) + "] system for a [" +
+            std::to_string(right->getRows()) + ", " +
+            std::to_string(right->getColumns()) + "] right-hand side.");
+    }
+    Trace::Span span {"solve", left->getRows() >= 4};
+
+    const int n = left->getRows();
+    Rows rows = toRows(left, right);
+    if (eliminate(rows) == 0) {
+        throw std::invalid_argument("Matrix is singular.");
+    }
+
+    // Every solution is y / d for the last pivot d, where y is a polynomial
+    // that is found by back substitution with exact divisions.
+    const Polynomial& last = rows[n - 1][n - 1];
+    auto* result = Matrix::zero(n, right->getColumns());
+    std::vector<Polynomial> solution(n);
+    for (int c = 0; c < right->getColumns(); c++) {
+        for (int i = n - 1; i >= 0; i--) {
+            Polynomial value = last * rows[i][n + c];
+            for (int j = i + 1; j < n; j++) {
+                value = value - rows[i][j] * solution[j];
+            }
+            solution[i] = divideExactly(value, rows[i][i]);
+            result->set(i, c, toSymbol(solution[i], last));
+        }
+    }
+
+    return result;
+}
+
+Matrix *Bareiss::inverse(const Matrix* matrix) {
+    assertSquare(matrix, "inverse");
+    Matrix* identity = Matrix::eye(matrix->getRows());
+    try {
+        Matrix* result = solve(matrix, identity);
+        delete identity;
+        return result;
+    } catch (...) {
+        delete identity;
+        throw;
+    }
+}
+
+Bareiss::Rows Bareiss::toRows(const Matrix* left, const Matrix* right) {
+    const int width = left->getColumns() + (right == nullptr ? 0 : right->getColumns());
+    Rows rows(left->getRows(), std::vector<Polynomial>(width));
+    for (int i = 0; i < left->getRows(); i++) {
+        for (int j = 0; j < left->getColumns(); j++) {
+            rows[i][j] = Polynomial::of(left->get(i, j));
+        }
+        for (int j = left->getColumns(); j < width; j++) {
+            rows[i][j] = Polynomial::of(right->get(i, j - left->getColumns()));
+        }
+    }
+    return rows;
+}
+
+int Bareiss::eliminate(Rows& rows) {
+    const auto n = rows.size();
+    const auto width = n == 0 ? 0 : rows[0].size();
+    Polynomial previous {1.0};
+    int sign = 1;
+
+    for (std::size_t k = 0; k < n; k++) {
+        if (rows[k][k].isZero()) {
+            std::size_t pivot = k + 1;
+            while (pivot < n && rows[pivot][k].isZero()) pivot++;
+            if (pivot == n) return 0;
+            std::swap(rows[k], rows[pivot]);
+            sign = -sign;
+        }
+
+        // By Sylvester's identity, every new element is divisible by the
+        // pivot of the previous step.
+        for (std::size_t i = k + 1; i < n; i++) {
+            for (std::size_t j = k + 1; j < width; j++) {
+                Governor::check();
+                rows[i][j] = divideExactly(
+                    rows[k][k] * rows[i][j] - rows[i][k] * rows[k][j], previous);
+            }
+            rows[i][k] = Polynomial{};
+        }
+        previous = rows[k][k];
+    }
+
+    return sign;
+}
+
+Polynomial Bareiss::divideExactly(const Polynomial& numerator,
+                                  const Polynomial& denominator) {
+    Polynomial quotient;
+    if (!numerator.divide(denominator, quotient)) {
+        throw std::logic_error("Fraction-free elimination left a remainder.");
+    }
+    return quotient;
+}
+
+Symbol *Bareiss::toSymbol(const Polynomial& top, const Polynomial& bottom) {
+    if (top.isZero()) return new Constant{0.0f};
+
+    Polynomial quotient;
+    if (top.divide(bottom, quotient)) {
+        return quotient.toSymbol();
+    }
+
+    // Cancel the names that are factors of both, like b^2/(a^2*b^2) = 1/a^2
+    Polynomial::Monomial common {bottom.getCommonFactor()};
+    const Polynomial::Monomial topFactor {top.getCommonFactor()};
+    for (auto power = common.powers.begin(); power != common.powers.end();) {
+        auto found = topFactor.powers.find(power->first);
+        if (found == topFactor.powers.end()) {
+            power = common.powers.erase(power);
+        } else {
+            power->second = std::min(power->second, found->second);
+            ++power;
+        }
+    }
+
+    Polynomial numerator {top}, denominator {bottom};
+    if (!common.powers.empty()) {
+        numerator = divideExactly(top, Polynomial{common});
+        denominator = divideExactly(bottom, Polynomial{common});
+    }
+
+    if (denominator.isConstant()) {
+        return (numerator * Polynomial{1.0 / denominator.getConstant()}).toSymbol();
+    }
+
+    return new Fraction(numerator.toSymbol(), denominator.toSymbol());
+}
@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include "polynomial.hpp"
+
+class Symbol;
+class Matrix;
+
+/**
+ * Determinants, inverses and linear systems of symbolic matrices, using
+ * fraction-free Bareiss elimination. Every step divides exactly by the
+ * previous pivot, so the elements stay polynomials of a size that grows
+ * polynomially instead of factorially with the size of the matrix. The
+ * elements must be polynomials in their names.
+ */
+class Bareiss {
+public:
+    /**
+     * Returns a new symbol with the determinant of a square matrix.
+     */
+    static Symbol* determinant(const Matrix* matrix);
+
+    /**
+     * Returns a new matrix X such that left * X = right. Throws
+     * std::invalid_argument if the left matrix is singular.
+     */
+    static Matrix* solve(const Matrix* left, const Matrix* right);
+
+    /**
+     * Returns a new matrix with the inverse of a square matrix.
+     */
+    static Matrix* inverse(const Matrix* matrix);
+
+private:
+    typedef std::vector<std::vector<Polynomial>> Rows;
+
+    static Rows toRows(const Matrix* left, const Matrix* right);
+
+    /**
+     * Eliminates everything below the diagonal in the first columns. Returns
+     * the sign of the row permutation, or 0 if the matrix is singular.
+     */
+    static int eliminate(Rows& rows);
+
+    static Polynomial divideExactly(const Polynomial& numerator,
+                                    const Polynomial& denominator);
+
+    static Symbol* toSymbol(const Polynomial& top, const Polynomial& bottom);
+};
@@ -0,0 +1,404 @@
+#include "block-matrix.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <utility>
+#include "constant.hpp"
+#include "formatter.hpp"
+#include "governor.hpp"
+#include "invalid-expression.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+#include "transpose.hpp"
+
+namespace {
+    bool isIdentity(const Symbol* block) {
+        auto* matrix = dynamic_cast<const Matrix*>(block);
+        return matrix != nullptr && matrix->getStructure() == Matrix::IDENTITY;
+    }
+
+    // Takes a size that is found in a block, unless it was already known
+    void fit(int& size, int found) {
+        if (found == Symbol::UNKNOWN) return;
+        if (size == Symbol::UNKNOWN) size = found;
+        else if (size != found) throw InvalidExpression(); // Blocks do not line up
+    }
+}
+
+BlockMatrix* BlockMatrix::of(int rows, int cols, std::vector<Symbol*> blocks) {
+    auto* matrix = new BlockMatrix(rows, cols, std::move(blocks),
+        std::vector<int>(rows, UNKNOWN), std::vector<int>(cols, UNKNOWN));
+    try {
+        matrix->measure();
+    } catch (...) {
+        delete matrix;
+        throw;
+    }
+    return matrix;
+}
+
+Symbol* BlockMatrix::flatten(Symbol* symbol) {
+    auto* blocks = dynamic_cast<BlockMatrix*>(symbol);
+    if (blocks == nullptr || !blocks->isKnown()) return symbol;
+
+    Matrix* matrix = blocks->toMatrix();
+    delete symbol;
+    return matrix;
+}
+
+BlockMatrix::BlockMatrix(int rows, int cols, std::vector<Symbol*> blocks,
+                         std::vector<int> heights, std::vector<int> widths) :
+    Symbol{}, mRows{rows}, mCols{cols}, mBlocks{std::move(blocks)},
+    mHeights{std::move(heights)}, mWidths{std::move(widths)} {}
+
+BlockMatrix::~BlockMatrix() {
+    for (auto* block : mBlocks) {
+        delete block;
+    }
+}
+
+int BlockMatrix::getBlockRows() const {
+    return mRows;
+}
+
+int BlockMatrix::getBlockColumns() const {
+    return mCols;
+}
+
+int BlockMatrix::getHeight(int row) const {
+    return mHeights[row];
+}
+
+int BlockMatrix::getWidth(int col) const {
+    return mWidths[col];
+}
+
+const Symbol *BlockMatrix::get(int row, int col) const {
+    return mBlocks[row * mCols + col];
+}
+
+Symbol *&BlockMatrix::block(int row, int col) {
+    return mBlocks[row * mCols + col];
+}
+
+void BlockMatrix::measure() {
+    std::vector<bool> rowFound(mRows, false), colFound(mCols, false);
+    for (int i = 0; i < mRows; i++) {
+        for (int j = 0; j < mCols; j++) {
+            const Symbol* block = get(i, j);
+            if (block->isScalar()) continue;
+            fit(mHeights[i], block->getRows());
+            fit(mWidths[j], block->getColumns());
+            rowFound[i] = colFound[j] = true;
+        }
+    }
+
+    // Rows and columns of only scalars are one element thick
+    for (int i = 0; i < mRows; i++) {
+        if (!rowFound[i]) fit(mHeights[i], 1);
+    }
+    for (int j = 0; j < mCols; j++) {
+        if (!colFound[j]) fit(mWidths[j], 1);
+    }
+
+    // Only a zero can stand for a larger block
+    for (int i = 0; i < mRows; i++) {
+        for (int j = 0; j < mCols; j++) {
+            const Symbol* block = get(i, j);
+            if (!block->isScalar() || block->isZero()) continue;
+            if ((mHeights[i] != UNKNOWN && mHeights[i] != 1)
+            ||  (mWidths[j] != UNKNOWN && mWidths[j] != 1)) {
+                throw InvalidExpression();
+            }
+        }
+    }
+}
+
+bool BlockMatrix::isKnown() const {
+    for (int height : mHeights) {
+        if (height == UNKNOWN) return false;
+    }
+    for (int width : mWidths) {
+        if (width == UNKNOWN) return false;
+    }
+    for (auto* block : mBlocks) {
+        if (block->isScalar() || dynamic_cast<const Matrix*>(block)) continue;
+        auto* nested = dynamic_cast<const BlockMatrix*>(block);
+        if (nested == nullptr || !nested->isKnown()) return false;
+    }
+    return true;
+}
+
+Matrix *BlockMatrix::toMatrix() const {
+    auto* matrix = Matrix::zero(getRows(), getColumns());
+
+    int top = 0;
+    for (int i = 0; i < mRows; i++) {
+        int left = 0;
+        for (int j = 0; j < mCols; j++) {
+            const Symbol* block = get(i, j);
+            const Matrix* elements = dynamic_cast<const Matrix*>(block);
+            Matrix* nested = nullptr;
+            if (auto* blocks = dynamic_cast<const BlockMatrix*>(block)) {
+                elements = nested = blocks->toMatrix();
+            }
+
+            if (elements != nullptr) {
+                for (int r = 0; r < elements->getRows(); r++) {
+                    for (int c = 0; c < elements->getColumns(); c++) {
+                        const Symbol* element = elements->get(r, c);
+                        if (!element->isZero()) matrix->set(top + r, left + c, element->copy());
+                    }
+                }
+            } else if (!block->isZero()) {
+                matrix->set(top, left, block->copy());
+            }
+
+            delete nested;
+            left += mWidths[j];
+        }
+        top += mHeights[i];
+    }
+
+    return matrix;
+}
+
+BlockMatrix* BlockMatrix::transpose() {
+    std::vector<Symbol*> blocks(mBlocks.size());
+    for (int i = 0; i < mRows; i++) {
+        for (int j = 0; j < mCols; j++) {
+            Symbol* block = this->block(i, j);
+            blocks[j * mRows + i] = block->isScalar() ? block : Transpose::of(block);
+        }
+    }
+
+    mBlocks = std::move(blocks);
+    std::swap(mRows, mCols);
+    std::swap(mHeights, mWidths);
+    return this;
+}
+
+Symbol *BlockMatrix::copy() const {
+    Stats::symbolCopied();
+    std::vector<Symbol*> blocks;
+    blocks.reserve(mBlocks.size());
+    for (auto* block : mBlocks) {
+        blocks.push_back(block->copy());
+    }
+    return new BlockMatrix(mRows, mCols, std::move(blocks), mHeights, mWidths);
+}
+
+Symbol *BlockMatrix::negate() {
+    for (auto& block : mBlocks) {
+        block = block->negate();
+    }
+    return this;
+}
+
+Symbol *BlockMatrix::operator+(Symbol *other) {
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+
+    if (!other->isScalar()) assertSameDimensions(other);
+
+    // Blocks that line up are added one by one, and zeros are skipped
+    auto* blocks = dynamic_cast<BlockMatrix*>(other);
+    bool aligned = blocks != nullptr && blocks->mRows == mRows && blocks->mCols == mCols;
+    for (int i = 0; aligned && i < mRows; i++) {
+        aligned = isSameSize(mHeights[i], blocks->mHeights[i]);
+    }
+    for (int j = 0; aligned && j < mCols; j++) {
+        aligned = isSameSize(mWidths[j], blocks->mWidths[j]);
+    }
+
+    if (aligned) {
+        for (int i = 0; i < mRows; i++) {
+            for (int j = 0; j < mCols; j++) {
+                Symbol*& target = block(i, j);
+                Symbol*& source = blocks->block(i, j);
+                if (source->isZero()) continue;
+                if (target->isZero()) {
+                    std::swap(target, source);
+                } else {
+                    Governor::check();
+                    target = *target + source;
+                    source = new Constant{0.0f};
+                }
+            }
+        }
+        for (int i = 0; i < mRows; i++) fit(mHeights[i], blocks->mHeights[i]);
+        for (int j = 0; j < mCols; j++) fit(mWidths[j], blocks->mWidths[j]);
+        delete other;
+        return this;
+    }
+
+    if (isKnown() && (dynamic_cast<Matrix*>(other) || other->isScalar()
+    || (blocks != nullptr && blocks->isKnown()))) {
+        Symbol* left = toMatrix();
+        delete this;
+        return *left + flatten(other);
+    }
+
+    // Kept as it is until the blocks are known
+    return new Sum(this, other);
+}
+
+Symbol *BlockMatrix::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *BlockMatrix::operator*(Symbol *other) {
+    if (other->isScalar()) {
+        for (auto& block : mBlocks) {
+            if (!block->isZero()) block = *block * other->copy();
+        }
+        delete other;
+        return this;
+    }
+
+    if (!isSameSize(getColumns(), other->getRows())) {
+        throw dimensionMismatch("multiply", other);
+    }
+
+    if (auto* blocks = dynamic_cast<BlockMatrix*>(other)) {
+        bool aligned = blocks->mRows == mCols;
+        for (int k = 0; aligned && k < mCols; k++) {
+            aligned = isSameSize(mWidths[k], blocks->mHeights[k]);
+        }
+
+        if (aligned) {
+            BlockMatrix* result = multiplyBlocks(blocks);
+            delete this;
+            delete other;
+            return result;
+        }
+    }
+
+    // Blocks that do not line up are multiplied element by element
+    auto* blocks = dynamic_cast<BlockMatrix*>(other);
+    if (isKnown() && (dynamic_cast<Matrix*>(other) || (blocks != nullptr && blocks->isKnown()))) {
+        Symbol* left = toMatrix();
+        delete this;
+        return *left * flatten(other);
+    }
+
+    // The order is kept since both are matrices
+    return new Product(this, other);
+}
+
+BlockMatrix *BlockMatrix::multiplyBlocks(const BlockMatrix* other) const {
+    // Which blocks are zero is looked up once instead of once for every
+    // product that they are part of
+    std::vector<char> leftZero(mBlocks.size()), rightZero(other->mBlocks.size());
+    for (std::size_t k = 0; k < mBlocks.size(); k++) leftZero[k] = mBlocks[k]->isZero();
+    for (std::size_t k = 0; k < other->mBlocks.size(); k++) {
+        rightZero[k] = other->mBlocks[k]->isZero();
+    }
+
+    const int cols = other->mCols;
+    std::vector<Symbol*> blocks;
+    blocks.reserve((std::size_t) mRows * cols);
+    for (int i = 0; i < mRows; i++) {
+        for (int j = 0; j < cols; j++) {
+            Symbol* sum = nullptr;
+            for (int k = 0; k < mCols; k++) {
+                if (leftZero[i * mCols + k] || rightZero[k * cols + j]) continue;
+
+                Governor::check();
+                const Symbol* left = get(i, k);
+                const Symbol* right = other->get(k, j);
+                Symbol* term = isIdentity(left) ? right->copy()
+                             : isIdentity(right) ? left->copy()
+                             : *left->copy() * right->copy();
+                sum = sum == nullptr ? term : *sum + term;
+            }
+            blocks.push_back(sum == nullptr ? new Constant{0.0f} : sum);
+        }
+    }
+
+    return new BlockMatrix(mRows, cols, std::move(blocks), mHeights, other->mWidths);
+}
+
+Symbol *BlockMatrix::operator/(Symbol *other) {
+    if (!other->isScalar()) throw InvalidExpression();
+
+    for (auto& block : mBlocks) {
+        if (!block->isZero()) block = *block / other->copy();
+    }
+    delete other;
+    return this;
+}
+
+Symbol *BlockMatrix::replace(const std::function<bool(const Symbol *)> &predicate,
+                             const std::function<Symbol *(Symbol *)> &mapper) {
+    for (auto& block : mBlocks) {
+        if (predicate(block)) {
+            block = mapper(block);
+        }
+    }
+
+    // Names that were substituted may have told the size of their blocks
+    measure();
+    return this;
+}
+
+std::string BlockMatrix::format(const Formatter &formatter) const {
+    if (isKnown()) {
+        Matrix* matrix = toMatrix();
+        std::string result = matrix->format(formatter);
+        delete matrix;
+        return result;
+    }
+
+    std::vector<std::string> blocks;
+    for (auto* block : mBlocks) {
+        blocks.push_back(block->format(formatter));
+    }
+    return formatter.matrix(mRows, mCols, blocks);
+}
+
+bool BlockMatrix::isConstant() const {
+    for (auto* block : mBlocks) {
+        if (!block->isConstant()) return false;
+    }
+    return true;
+}
+
+bool BlockMatrix::isZero() const {
+    for (auto* block : mBlocks) {
+        if (!block->isZero()) return false;
+    }
+    return true;
+}
+
+int BlockMatrix::getColumns() const {
+    int cols = 0;
+    for (int width : mWidths) {
+        if (width == UNKNOWN) return UNKNOWN;
+        cols += width;
+    }
+    return cols;
+}
+
+int BlockMatrix::getRows() const {
+    int rows = 0;
+    for (int height : mHeights) {
+        if (height == UNKNOWN) return UNKNOWN;
+        rows += height;
+    }
+    return rows;
+}
+
+std::set<std::string> BlockMatrix::findUndefined() {
+    std::set<std::string> undefined;
+    for (auto* block : mBlocks) {
+        auto found = block->findUndefined();
+        undefined.insert(found.begin(), found.end());
+    }
+    return undefined;
+}
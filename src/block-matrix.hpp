@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include "symbol.hpp"
+
+class Matrix;
+
+/**
+ * A matrix that is written as a grid of blocks, like [A, B; C, D]. Blocks
+ * are multiplied and added as whole matrices, so blocks that are zero or
+ * the identity are skipped without looking at their elements. A scalar
+ * zero stands for a zero block of the size of its row and column. The
+ * blocks are only turned into a plain matrix for the output.
+ */
+class BlockMatrix : public Symbol {
+public:
+    /**
+     * Creates a matrix of the given number of rows and columns of blocks,
+     * which are in row-major order. Throws InvalidExpression if the blocks
+     * in a row or a column do not have the same size, and consumes the
+     * blocks either way.
+     */
+    static BlockMatrix* of(int rows, int cols, std::vector<Symbol*> blocks);
+
+    /**
+     * Returns the elements of the symbol as a plain matrix if it is a block
+     * matrix that is known, or the symbol itself otherwise.
+     */
+    static Symbol* flatten(Symbol* symbol);
+
+    explicit BlockMatrix(int rows, int cols, std::vector<Symbol*> blocks,
+                         std::vector<int> heights, std::vector<int> widths);
+
+    ~BlockMatrix() override;
+
+    int getBlockRows() const;
+
+    int getBlockColumns() const;
+
+    /**
+     * The number of rows of every block in the given row of blocks.
+     */
+    int getHeight(int row) const;
+
+    /**
+     * The number of columns of every block in the given column of blocks.
+     */
+    int getWidth(int col) const;
+
+    const Symbol* get(int row, int col) const;
+
+    /**
+     * True if every block is a matrix or a scalar of a known size, so that
+     * it can be turned into a plain matrix.
+     */
+    bool isKnown() const;
+
+    /**
+     * Returns a new matrix with the elements of every block. The blocks
+     * have to be known.
+     */
+    Matrix* toMatrix() const;
+
+    /**
+     * Transposes this matrix in place by transposing the grid and every
+     * block in it.
+     */
+    BlockMatrix* transpose();
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    /**
+     * Fills in the sizes that are still unknown from the blocks. Throws
+     * InvalidExpression if two blocks disagree on a size.
+     */
+    void measure();
+
+    /**
+     * Multiplies the blocks with the blocks of other, which has as many
+     * rows of blocks as this has columns, and with the same sizes.
+     */
+    BlockMatrix* multiplyBlocks(const BlockMatrix* other) const;
+
+    Symbol*& block(int row, int col);
+
+    int mRows, mCols;
+    std::vector<Symbol*> mBlocks;
+    std::vector<int> mHeights, mWidths;
+};
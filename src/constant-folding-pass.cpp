@@ -0,0 +1,76 @@
+#include "constant-folding-pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include "pass-manager.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "transpose.hpp"
+#include "fraction.hpp"
+
+const char* ConstantFoldingPass::getName() const {
+    return "constant-folding";
+}
+
+Symbol* ConstantFoldingPass::leave(Symbol* input, PassManager&) {
+    if (auto* variable = dynamic_cast<Variable*>(input)) {
+        if (fabsf(variable->getQuantity()) < FLT_EPSILON) {
+            delete input;
+            return new Constant{0.0f};
+        } else if (fabsf(variable->getExponent()) < FLT_EPSILON) {
+            float quantity = variable->getQuantity();
+            delete input;
+            return new Constant{quantity};
+        }
+        return input; // TODO: Try to resolve variable?
+    }
+
+    if (auto* product = dynamic_cast<Product*>(input)) {
+        float value = 1.0f;
+        for (int i = 0; i < product->getFactors(); i++) {
+            auto* constant = dynamic_cast<const Constant*>(product->get(i));
+            if (constant == nullptr) return input;
+            value *= constant->getValue();
+        }
+        delete input;
+        return new Constant{value};
+    }
+
+    if (auto* sum = dynamic_cast<Sum*>(input)) {
+        float value = 0.0f;
+        for (int i = 0; i < sum->getTerms(); i++) {
+            auto* constant = dynamic_cast<const Constant*>(sum->get(i));
+            if (constant == nullptr) return input;
+            value += constant->getValue();
+        }
+        delete input;
+        return new Constant{value};
+    }
+
+    if (auto* fraction = dynamic_cast<Fraction*>(input)) {
+        auto* top = dynamic_cast<const Constant*>(fraction->getNumerator());
+        auto* bottom = dynamic_cast<const Constant*>(fraction->getDenominator());
+        if (top == nullptr || bottom == nullptr || bottom->isZero()) return input;
+        const float value = top->getValue() / bottom->getValue();
+        delete input;
+        return new Constant{value};
+    }
+
+    if (auto* transpose = dynamic_cast<Transpose*>(input)) {
+        // Names that are still undefined after substitution are scalars
+        if (transpose->getInner()->isScalar()) {
+            Symbol* inner = transpose->getInner()->copy();
+            delete input;
+            return inner;
+        }
+        return input;
+    }
+
+    return input;
+}
@@ -0,0 +1,18 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include "pass.hpp"
+
+/**
+ * Replaces variables that are effectively constant, and products or sums of
+ * constants, with a single constant.
+ */
+class ConstantFoldingPass : public Pass {
+public:
+    const char* getName() const override;
+
+    Symbol* leave(Symbol* input, PassManager& manager) override;
+};
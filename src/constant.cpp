@@ -7,6 +7,7 @@
 #include "constant.hpp"
 #include "sum.hpp"
 #include "invalid-expression.hpp"
+#include "stats.hpp"
 
 Symbol *Constant::negate() {
     mValue = -mValue;
@@ -94,6 +95,11 @@ Symbol *Constant::operator/(Symbol::value_t other) {
     return this;
 }
 
+Symbol *Constant::pow(Symbol::value_t exponent) {
+    mValue = powf(mValue, exponent);
+    return this;
+}
+
 bool Constant::isConstant() const {
     return true;
 }
@@ -134,6 +140,7 @@ Symbol::value_t Constant::getValue() const {
 }
 
 Symbol *Constant::copy() const {
+    Stats::symbolCopied();
     return new Constant(mValue);
 }
 
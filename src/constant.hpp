@@ -32,6 +32,8 @@ public:
 
     Symbol *operator/(value_t other) override;
 
+    Symbol *pow(value_t exponent) override;
+
     Symbol *replace(const std::function<bool(const Symbol *)> &predicate,
                     const std::function<Symbol *(
                         Symbol *)> &mapper) override;
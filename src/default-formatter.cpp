@@ -79,6 +79,20 @@ std::string DefaultFormatter::negate(const std::string& unknown) const {
     return "-" + unknown;
 }
 
+std::string DefaultFormatter::transpose(const std::string& inner) const {
+    return inner + "'";
+}
+
+std::string DefaultFormatter::call(const std::string& function,
+                                   const std::vector<std::string>& arguments) const {
+    std::string result = function + "(";
+    for (std::vector<std::string>::size_type i = 0; i < arguments.size(); i++) {
+        if (i > 0) result += pretty ? ", " : ",";
+        result += arguments[i];
+    }
+    return result + ")";
+}
+
 std::string DefaultFormatter::assign(const std::string& name,
                                      const std::string& value) const {
     return pretty
@@ -0,0 +1,410 @@
+#include "dense.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include "constant.hpp"
+#include "governor.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+namespace {
+    // Columns factorized per step. The pivot rows of a block are read once
+    // for every remaining row, so a block should stay in the L1 cache.
+    const int BLOCK = 64;
+
+    // Columns of the remaining rows updated at a time, so that the part of
+    // the pivot rows that is read stays in the L2 cache.
+    const int COLUMN_TILE = 256;
+
+    // Multiply-adds that make it worth handing a chunk to another thread
+    const long GRAIN_WORK = 1L << 16;
+
+    int grainFor(long workPerIndex) {
+        return (int) std::max(1L, GRAIN_WORK / std::max(1L, workPerIndex));
+    }
+
+    double tolerance(const std::vector<double>& values, int n) {
+        double largest = 0.0;
+        for (double value : values) largest = std::max(largest, std::fabs(value));
+        return n * DBL_EPSILON * largest;
+    }
+
+    void assertSquare(const Matrix* matrix, const char* operation) {
+        if (matrix->getRows() != matrix->getColumns()) {
+            throw std::invalid_argument(
+                std::string("Can't compute the ") + operation + " of a non-square [" +
+                std::to_string(matrix->getRows()) + ", " +
+                std::to_string(matrix->getColumns()) + "] matrix.");
+        }
+    }
+}
+
+bool Dense::accepts(const Matrix* matrix) {
+    for (int i = 0; i < matrix->getRows(); i++) {
+        for (int j = 0; j < matrix->getColumns(); j++) {
+            if (!dynamic_cast<const Constant*>(matrix->get(i, j))) return false;
+        }
+    }
+    return true;
+}
+
+Symbol *Dense::determinant(const Matrix* matrix) {
+    assertSquare(matrix, "determinant");
+    Trace::Span span {"determinant", matrix->getRows() >= Trace::SIZE_THRESHOLD};
+
+    const int n = matrix->getRows();
+    std::vector<double> values = toValues(matrix);
+    std::vector<int> pivots;
+    const int sign = factorLU(values, n, pivots);
+
+    double result = sign;
+    for (int i = 0; sign != 0 && i < n; i++) {
+        result *= values[i * n + i];
+    }
+    return new Constant{(float) result};
+}
+
+Matrix *Dense::solve(const Matrix* left, const Matrix* right) {
+    assertSquare(left, "solution");
+    if (right->getRows() != left->getRows()) {
+        throw std::invalid_argument(
+            "Can't solve a [" + std::to_string(left->getRows()) + ", " +
+            std::to_string(left->getColumns()) + "] system for a [" +
+            std::to_string(right->getRows()) + ", " +
+            std::to_string(right->getColumns()) + "] right-hand side.");
+    }
+    Trace::Span span {"solve", left->getRows() >= Trace::SIZE_THRESHOLD};
+
+    const int n = left->getRows(), m = right->getColumns();
+    std::vector<double> values = toValues(left);
+    std::vector<double> solution = toValues(right);
+
+    // Cholesky needs half the work of LU, but only works for symmetric
+    // positive definite matrices, which is only known once it fails.
+    if (isSymmetric(values, n)) {
+        std::vector<double> factors {values};
+        if (factorCholesky(factors, n)) {
+            solveCholesky(factors, n, solution, m);
+            return toMatrix(solution, n, m);
+        }
+    }
+
+    std::vector<int> pivots;
+    if (factorLU(values, n, pivots) == 0) {
+        throw std::invalid_argument("Matrix is singular.");
+    }
+    solveLU(values, n, pivots, solution, m);
+    return toMatrix(solution, n, m);
+}
+
+Matrix *Dense::inverse(const Matrix* matrix) {
+    assertSquare(matrix, "inverse");
+    auto* identity = Matrix::eye(matrix->getRows());
+    try {
+        Matrix* result = solve(matrix, identity);
+        delete identity;
+        return result;
+    } catch (...) {
+        delete identity;
+        throw;
+    }
+}
+
+int Dense::factorLU(std::vector<double>& values, int n, std::vector<int>& pivots) {
+    pivots.assign(n, 0);
+    const double smallest = tolerance(values, n);
+    double* a = values.data();
+    int sign = 1;
+
+    for (int k0 = 0; k0 < n; k0 += BLOCK) {
+        Governor::check();
+        const int kend = std::min(k0 + BLOCK, n);
+
+        // Factorize the columns of the block, swapping whole rows so that
+        // the rows below the block are permuted as well.
+        for (int k = k0; k < kend; k++) {
+            int pivot = k;
+            for (int i = k + 1; i < n; i++) {
+                if (std::fabs(a[i * n + k]) > std::fabs(a[pivot * n + k])) pivot = i;
+            }
+            if (std::fabs(a[pivot * n + k]) <= smallest) return 0;
+
+            pivots[k] = pivot;
+            if (pivot != k) {
+                std::swap_ranges(a + k * n, a + (k + 1) * n, a + pivot * n);
+                sign = -sign;
+            }
+
+            const double* top = a + k * n;
+            for (int i = k + 1; i < n; i++) {
+                double* row = a + i * n;
+                const double factor = row[k] /= top[k];
+                for (int j = k + 1; j < kend; j++) {
+                    row[j] -= factor * top[j];
+                }
+            }
+        }
+
+        if (kend == n) break;
+        const int blockSize = kend - k0;
+
+        // The pivot rows right of the block, U12 = L11^-1 * A12
+        Parallel::forRange(kend, n, grainFor((long) blockSize * blockSize),
+                [a, n, k0, kend](int from, int to) {
+            for (int k = k0; k < kend; k++) {
+                const double* top = a + k * n;
+                for (int i = k + 1; i < kend; i++) {
+                    double* row = a + i * n;
+                    const double factor = row[k];
+                    for (int j = from; j < to; j++) {
+                        row[j] -= factor * top[j];
+                    }
+                }
+            }
+        });
+
+        // The remaining rows, A22 -= L21 * U12
+        Parallel::forRange(kend, n, grainFor((long) blockSize * (n - kend)),
+                [a, n, k0, kend](int from, int to) {
+            for (int j0 = kend; j0 < n; j0 += COLUMN_TILE) {
+                const int jend = std::min(j0 + COLUMN_TILE, n);
+                for (int i = from; i < to; i++) {
+                    double* row = a + i * n;
+                    for (int k = k0; k < kend; k++) {
+                        const double factor = row[k];
+                        if (factor == 0.0) continue;
+                        const double* top = a + k * n;
+                        for (int j = j0; j < jend; j++) {
+                            row[j] -= factor * top[j];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    return sign;
+}
+
+bool Dense::factorCholesky(std::vector<double>& values, int n) {
+    const double smallest = tolerance(values, n);
+    double* a = values.data();
+
+    for (int k0 = 0; k0 < n; k0 += BLOCK) {
+        Governor::check();
+        const int kend = std::min(k0 + BLOCK, n);
+
+        // The diagonal block. Earlier blocks are already subtracted from it.
+        for (int k = k0; k < kend; k++) {
+            double* pivotRow = a + k * n;
+            double diagonal = pivotRow[k];
+            for (int j = k0; j < k; j++) {
+                diagonal -= pivotRow[j] * pivotRow[j];
+            }
+            if (diagonal <= smallest) return false;
+            pivotRow[k] = std::sqrt(diagonal);
+
+            for (int i = k + 1; i < kend; i++) {
+                double* row = a + i * n;
+                double value = row[k];
+                for (int j = k0; j < k; j++) {
+                    value -= row[j] * pivotRow[j];
+                }
+                row[k] = value / pivotRow[k];
+            }
+        }
+
+        if (kend == n) break;
+        const int blockSize = kend - k0;
+
+        // The block of L below the diagonal block, L21 = A21 * L11^-T
+        Parallel::forRange(kend, n, grainFor((long) blockSize * blockSize),
+                [a, n, k0, kend](int from, int to) {
+            for (int i = from; i < to; i++) {
+                double* row = a + i * n;
+                for (int k = k0; k < kend; k++) {
+                    const double* pivotRow = a + k * n;
+                    double value = row[k];
+                    for (int j = k0; j < k; j++) {
+                        value -= row[j] * pivotRow[j];
+                    }
+                    row[k] = value / pivotRow[k];
+                }
+            }
+        });
+
+        // The lower triangle of the remaining rows, A22 -= L21 * L21'. The
+        // rows get longer further down, so chunks are handed out as threads
+        // become free.
+        Parallel::forRange(kend, n, grainFor((long) blockSize * (n - kend) / 2),
+                [a, n, k0, kend](int from, int to) {
+            for (int i = from; i < to; i++) {
+                double* row = a + i * n;
+                for (int j = kend; j <= i; j++) {
+                    const double* other = a + j * n;
+                    double sum = 0.0;
+                    for (int k = k0; k < kend; k++) {
+                        sum += row[k] * other[k];
+                    }
+                    row[j] -= sum;
+                }
+            }
+        });
+    }
+
+    return true;
+}
+
+Matrix *Dense::elementwise(const Matrix* left, const Matrix* right, bool divide) {
+    const int leftRows = left->getRows(), leftCols = left->getColumns();
+    const int rightRows = right->getRows(), rightCols = right->getColumns();
+    const int rows = std::max(leftRows, rightRows), cols = std::max(leftCols, rightCols);
+
+    const std::vector<double> a = toValues(left), b = toValues(right);
+    if (divide && std::find(b.begin(), b.end(), 0.0) != b.end()) {
+        throw std::invalid_argument("Division by zero.");
+    }
+
+    // A repeated row is read from the start every time, and a repeated
+    // column is a single value for the whole row
+    std::vector<double> values((std::size_t) rows * cols);
+    for (int i = 0; i < rows; i++) {
+        const double* x = a.data() + (std::size_t) (leftRows == 1 ? 0 : i) * leftCols;
+        const double* y = b.data() + (std::size_t) (rightRows == 1 ? 0 : i) * rightCols;
+        double* out = values.data() + (std::size_t) i * cols;
+
+        if (leftCols == rightCols) {
+            if (divide) for (int j = 0; j < cols; j++) out[j] = x[j] / y[j];
+            else        for (int j = 0; j < cols; j++) out[j] = x[j] * y[j];
+        } else if (rightCols == 1) {
+            const double scalar = y[0];
+            if (divide) for (int j = 0; j < cols; j++) out[j] = x[j] / scalar;
+            else        for (int j = 0; j < cols; j++) out[j] = x[j] * scalar;
+        } else {
+            const double scalar = x[0];
+            if (divide) for (int j = 0; j < cols; j++) out[j] = scalar / y[j];
+            else        for (int j = 0; j < cols; j++) out[j] = scalar * y[j];
+        }
+    }
+
+    return toMatrix(values, rows, cols);
+}
+
+std::vector<double> Dense::toValues(const Matrix* matrix) {
+    const int rows = matrix->getRows(), cols = matrix->getColumns();
+    std::vector<double> values((std::size_t) rows * cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            auto* constant = dynamic_cast<const Constant*>(matrix->get(i, j));
+            if (constant == nullptr) {
+                throw std::invalid_argument("Matrix is not numeric.");
+            }
+            values[(std::size_t) i * cols + j] = constant->getValue();
+        }
+    }
+    return values;
+}
+
+Matrix *Dense::toMatrix(const std::vector<double>& values, int rows, int cols) {
+    auto* matrix = Matrix::zero(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            const double value = values[(std::size_t) i * cols + j];
+            if (value != 0.0) matrix->set(i, j, new Constant{(float) value});
+        }
+    }
+    return matrix;
+}
+
+bool Dense::isSymmetric(const std::vector<double>& values, int n) {
+    for (int i = 0; i < n; i++) {
+        if (values[i * n + i] <= 0.0) return false;
+        for (int j = i + 1; j < n; j++) {
+            if (values[i * n + j] != values[j * n + i]) return false;
+        }
+    }
+    return true;
+}
+
+void Dense::solveLU(const std::vector<double>& factors, int n,
+                    const std::vector<int>& pivots,
+                    std::vector<double>& right, int m) {
+    const double* a = factors.data();
+    double* b = right.data();
+
+    for (int k = 0; k < n; k++) {
+        if (pivots[k] != k) {
+            std::swap_ranges(b + k * m, b + (k + 1) * m, b + pivots[k] * m);
+        }
+    }
+
+    // The columns of the right-hand side are independent
+    Parallel::forRange(0, m, grainFor((long) n * n), [a, b, n, m](int from, int to) {
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < i; k++) {
+                const double factor = a[i * n + k];
+                if (factor == 0.0) continue;
+                for (int j = from; j < to; j++) {
+                    b[i * m + j] -= factor * b[k * m + j];
+                }
+            }
+        }
+
+        for (int i = n - 1; i >= 0; i--) {
+            for (int k = i + 1; k < n; k++) {
+                const double factor = a[i * n + k];
+                if (factor == 0.0) continue;
+                for (int j = from; j < to; j++) {
+                    b[i * m + j] -= factor * b[k * m + j];
+                }
+            }
+            for (int j = from; j < to; j++) {
+                b[i * m + j] /= a[i * n + i];
+            }
+        }
+    });
+}
+
+void Dense::solveCholesky(const std::vector<double>& factors, int n,
+                          std::vector<double>& right, int m) {
+    const double* a = factors.data();
+    double* b = right.data();
+
+    Parallel::forRange(0, m, grainFor((long) n * n), [a, b, n, m](int from, int to) {
+        // L * y = b
+        for (int i = 0; i < n; i++) {
+            for (int k = 0; k < i; k++) {
+                const double factor = a[i * n + k];
+                if (factor == 0.0) continue;
+                for (int j = from; j < to; j++) {
+                    b[i * m + j] -= factor * b[k * m + j];
+                }
+            }
+            for (int j = from; j < to; j++) {
+                b[i * m + j] /= a[i * n + i];
+            }
+        }
+
+        // L' * x = y, where row i of L' is column i of L
+        for (int i = n - 1; i >= 0; i--) {
+            for (int k = i + 1; k < n; k++) {
+                const double factor = a[k * n + i];
+                if (factor == 0.0) continue;
+                for (int j = from; j < to; j++) {
+                    b[i * m + j] -= factor * b[k * m + j];
+                }
+            }
+            for (int j = from; j < to; j++) {
+                b[i * m + j] /= a[i * n + i];
+            }
+        }
+    });
+}
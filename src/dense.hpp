@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+
+class Symbol;
+class Matrix;
+
+/**
+ * Determinants, inverses and linear systems of numeric matrices, using LU
+ * decomposition with partial pivoting, or Cholesky decomposition if the
+ * matrix is symmetric positive definite. The elements are copied to a dense
+ * row-major array of doubles and factorized a block of columns at a time,
+ * so that the update of the remaining rows, where almost all of the time is
+ * spent, reads the same block of pivot rows from the cache and is split
+ * between threads.
+ */
+class Dense {
+public:
+    /**
+     * True if every element is a number.
+     */
+    static bool accepts(const Matrix* matrix);
+
+    /**
+     * Returns a new constant with the determinant of a square matrix.
+     */
+    static Symbol* determinant(const Matrix* matrix);
+
+    /**
+     * Returns a new matrix X such that left * X = right. Throws
+     * std::invalid_argument if the left matrix is singular.
+     */
+    static Matrix* solve(const Matrix* left, const Matrix* right);
+
+    /**
+     * Returns a new matrix with the inverse of a square matrix.
+     */
+    static Matrix* inverse(const Matrix* matrix);
+
+    /**
+     * Returns a new matrix with the elements of left multiplied, or divided
+     * if divide is set, by the elements of right. Either side may be a
+     * single row, column or element that is repeated across the other.
+     * Every row is computed in a single loop over contiguous values that
+     * the compiler vectorizes. Throws std::invalid_argument if an element
+     * is divided by zero.
+     */
+    static Matrix* elementwise(const Matrix* left, const Matrix* right, bool divide);
+
+    /**
+     * Replaces the n x n row-major matrix with its LU decomposition, where L
+     * has an implicit unit diagonal, and sets the row swapped with each row.
+     * Returns the sign of the permutation, or 0 if the matrix is singular.
+     */
+    static int factorLU(std::vector<double>& values, int n, std::vector<int>& pivots);
+
+    /**
+     * Replaces the lower triangle of the n x n row-major symmetric matrix
+     * with L such that L * L' is the matrix. Returns false if the matrix is
+     * not positive definite, in which case the values are undefined.
+     */
+    static bool factorCholesky(std::vector<double>& values, int n);
+
+private:
+    static std::vector<double> toValues(const Matrix* matrix);
+
+    static Matrix* toMatrix(const std::vector<double>& values, int rows, int cols);
+
+    static bool isSymmetric(const std::vector<double>& values, int n);
+
+    /**
+     * Overwrites the n x m right-hand side with the solution.
+     */
+    static void solveLU(const std::vector<double>& factors, int n,
+                        const std::vector<int>& pivots,
+                        std::vector<double>& right, int m);
+
+    static void solveCholesky(const std::vector<double>& factors, int n,
+                              std::vector<double>& right, int m);
+};
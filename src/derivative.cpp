@@ -0,0 +1,272 @@
+#include "derivative.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include "constant.hpp"
+#include "fraction.hpp"
+#include "governor.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "serializer.hpp"
+#include "sum.hpp"
+#include "variable.hpp"
+
+namespace {
+    std::vector<std::string> namesOf(const Matrix* variables) {
+        std::vector<std::string> names;
+        for (int i = 0; i < variables->getRows(); i++) {
+            for (int j = 0; j < variables->getColumns(); j++) {
+                auto* variable = dynamic_cast<const Variable*>(variables->get(i, j));
+                if (variable == nullptr
+                ||  fabsf(variable->getQuantity() - 1.0f) >= FLT_EPSILON
+                ||  fabsf(variable->getExponent() - 1.0f) >= FLT_EPSILON) {
+                    throw std::invalid_argument(
+                        "Derivatives are only taken with respect to names that are not defined.");
+                }
+                names.push_back(variable->getName());
+            }
+        }
+        return names;
+    }
+
+    const Symbol* element(const Matrix* vector, int index) {
+        return vector->getRows() == 1 ? vector->get(0, index) : vector->get(index, 0);
+    }
+
+    template <typename T>
+    void append(std::string& key, const T& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof value);
+    }
+
+    // A factor is multiplied into the numerator of a fraction, so that the
+    // result is a single fraction instead of a product with one. Consumes
+    // both.
+    Symbol* multiply(Symbol* left, Symbol* right) {
+        if (dynamic_cast<Fraction*>(right) && !dynamic_cast<Fraction*>(left)) {
+            std::swap(left, right);
+        }
+        auto* fraction = dynamic_cast<Fraction*>(left);
+        if (fraction == nullptr) return *left * right;
+
+        Symbol* result = new Fraction(*fraction->getNumerator()->copy() * right,
+                                      fraction->getDenominator()->copy());
+        delete left;
+        return result;
+    }
+
+    // Sums and products can't be divided by themselves, so anything but a
+    // number becomes a fraction. Consumes both.
+    Symbol* divide(Symbol* numerator, Symbol* denominator) {
+        if (auto* constant = dynamic_cast<Constant*>(denominator)) {
+            const Symbol::value_t inverse = 1.0f / constant->getValue();
+            delete denominator;
+            return *numerator * inverse;
+        }
+        if (dynamic_cast<Fraction*>(numerator)) {
+            return *numerator / denominator;
+        }
+        return new Fraction(numerator, denominator);
+    }
+}
+
+Derivative::Derivative(std::vector<std::string> names) :
+    mNames{std::move(names)}, mNodes{}, mIds{} {}
+
+Matrix *Derivative::of(const Matrix* expression, const Matrix* variable) {
+    if (!variable->isScalar()) {
+        throw std::invalid_argument("d() takes a single name to differentiate with respect to.");
+    }
+
+    Derivative derivative {namesOf(variable)};
+    auto* result = Matrix::zero(expression->getRows(), expression->getColumns());
+    try {
+        for (int i = 0; i < expression->getRows(); i++) {
+            for (int j = 0; j < expression->getColumns(); j++) {
+                const int output = derivative.add(expression->get(i, j));
+                result->set(i, j, derivative.gradient(output)[0]);
+            }
+        }
+    } catch (...) {
+        delete result;
+        throw;
+    }
+    return result;
+}
+
+Matrix *Derivative::jacobian(const Matrix* outputs, const Matrix* variables) {
+    if ((outputs->getRows() != 1 && outputs->getColumns() != 1)
+    ||  (variables->getRows() != 1 && variables->getColumns() != 1)) {
+        throw std::invalid_argument("jacobian() takes a vector of outputs and a vector of names.");
+    }
+
+    // Every output is added before any of them is differentiated, so that
+    // they share the nodes of the subexpressions they have in common
+    Derivative derivative {namesOf(variables)};
+    const int count = outputs->getRows() * outputs->getColumns();
+    std::vector<int> roots;
+    for (int i = 0; i < count; i++) {
+        roots.push_back(derivative.add(element(outputs, i)));
+    }
+
+    auto* result = Matrix::zero(count, (int) derivative.mNames.size());
+    try {
+        for (int i = 0; i < count; i++) {
+            auto gradient = derivative.gradient(roots[i]);
+            for (std::vector<Symbol*>::size_type j = 0; j < gradient.size(); j++) {
+                result->set(i, (int) j, gradient[j]);
+            }
+        }
+    } catch (...) {
+        delete result;
+        throw;
+    }
+    return result;
+}
+
+int Derivative::add(const Symbol* symbol) {
+    Node node {symbol, {}, false};
+    std::string key;
+
+    if (auto* constant = dynamic_cast<const Constant*>(symbol)) {
+        key = "c";
+        append(key, constant->getValue());
+    } else if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        key = "v";
+        append(key, variable->getQuantity());
+        append(key, variable->getExponent());
+        key += variable->getName();
+        node.dependent = std::find(mNames.begin(), mNames.end(),
+                                   variable->getName()) != mNames.end();
+    } else if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        key = "+";
+        for (int i = 0; i < sum->getTerms(); i++) {
+            node.children.push_back(add(sum->get(i)));
+        }
+    } else if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        key = "*";
+        for (int i = 0; i < product->getFactors(); i++) {
+            node.children.push_back(add(product->get(i)));
+        }
+    } else if (auto* fraction = dynamic_cast<const Fraction*>(symbol)) {
+        key = "/";
+        node.children.push_back(add(fraction->getNumerator()));
+        node.children.push_back(add(fraction->getDenominator()));
+    } else {
+        // Anything else is a leaf that depends on the names it refers to
+        key = "o";
+        Serializer::encode(key, symbol);
+        Symbol* copy = symbol->copy();
+        for (auto& name : copy->findUndefined()) {
+            if (std::find(mNames.begin(), mNames.end(), name) != mNames.end()) {
+                node.dependent = true;
+            }
+        }
+        delete copy;
+    }
+
+    for (int child : node.children) {
+        append(key, child);
+        node.dependent = node.dependent || mNodes[child].dependent;
+    }
+
+    auto found = mIds.find(key);
+    if (found != mIds.end()) return found->second;
+
+    const int id = (int) mNodes.size();
+    mNodes.push_back(std::move(node));
+    mIds.emplace(std::move(key), id);
+    return id;
+}
+
+std::vector<Symbol*> Derivative::gradient(int output) const {
+    std::vector<Symbol*> gradient(mNames.size(), nullptr);
+    std::vector<Symbol*> adjoints(output + 1, nullptr);
+    if (mNodes[output].dependent) adjoints[output] = new Constant{1.0f};
+
+    try {
+        // Parents come after their children, so every node has received
+        // all of its contributions once it is reached
+        for (int id = output; id >= 0; id--) {
+            const Symbol* adjoint = adjoints[id];
+            if (adjoint == nullptr) continue;
+            Governor::check();
+
+            const Node& node = mNodes[id];
+            const Symbol* symbol = node.symbol;
+            if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+                const Symbol::value_t exponent = variable->getExponent();
+                for (std::vector<std::string>::size_type k = 0; k < mNames.size(); k++) {
+                    if (mNames[k] != variable->getName()) continue;
+
+                    Symbol* local;
+                    if (fabsf(exponent - 1.0f) < FLT_EPSILON) {
+                        local = new Constant{variable->getQuantity()};
+                    } else {
+                        auto* power = new Variable{variable->getName()};
+                        power->setQuantity(variable->getQuantity() * exponent);
+                        power->setExponent(exponent - 1.0f);
+                        local = power;
+                    }
+                    accumulate(gradient, (int) k, multiply(adjoint->copy(), local));
+                }
+            } else if (dynamic_cast<const Sum*>(symbol)) {
+                for (int child : node.children) {
+                    if (mNodes[child].dependent) accumulate(adjoints, child, adjoint->copy());
+                }
+            } else if (dynamic_cast<const Product*>(symbol)) {
+                for (std::vector<int>::size_type i = 0; i < node.children.size(); i++) {
+                    if (!mNodes[node.children[i]].dependent) continue;
+
+                    Symbol* contribution = adjoint->copy();
+                    for (std::vector<int>::size_type j = 0; j < node.children.size(); j++) {
+                        if (j == i) continue;
+                        contribution = multiply(contribution, mNodes[node.children[j]].symbol->copy());
+                    }
+                    accumulate(adjoints, node.children[i], contribution);
+                }
+            } else if (dynamic_cast<const Fraction*>(symbol)) {
+                // d(n/d) = dn/d - n*dd/d^2
+                const int numerator = node.children[0], denominator = node.children[1];
+                const Symbol* bottom = mNodes[denominator].symbol;
+                if (mNodes[numerator].dependent) {
+                    accumulate(adjoints, numerator, divide(adjoint->copy(), bottom->copy()));
+                }
+                if (mNodes[denominator].dependent) {
+                    Symbol* top = multiply(adjoint->copy(), mNodes[numerator].symbol->copy())->negate();
+                    accumulate(adjoints, denominator, divide(top, *bottom->copy() * bottom->copy()));
+                }
+            } else {
+                throw std::invalid_argument(
+                    "Can't differentiate a matrix or a function with respect to a name in it.");
+            }
+
+            delete adjoints[id];
+            adjoints[id] = nullptr;
+        }
+    } catch (...) {
+        for (auto* adjoint : adjoints) delete adjoint;
+        for (auto* partial : gradient) delete partial;
+        throw;
+    }
+
+    for (auto& partial : gradient) {
+        if (partial == nullptr) partial = new Constant{0.0f};
+    }
+    return gradient;
+}
+
+void Derivative::accumulate(std::vector<Symbol*>& adjoints, int node, Symbol* contribution) {
+    auto* constant = dynamic_cast<Constant*>(contribution);
+    if (constant != nullptr && constant->isZero()) {
+        delete contribution;
+        return;
+    }
+    adjoints[node] = adjoints[node] == nullptr ? contribution : *adjoints[node] + contribution;
+}
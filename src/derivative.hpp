@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Symbol;
+class Matrix;
+
+/**
+ * Partial derivatives of scalar expressions, taken in reverse mode. The
+ * expressions are first turned into a graph where identical subtrees are a
+ * single node. The derivative of an output with respect to every node is
+ * then pushed down from the output, so a subexpression that is used in many
+ * places is only differentiated once, and a single sweep gives the
+ * derivatives with respect to all of the names. Nodes that do not depend on
+ * any of the names are never visited.
+ */
+class Derivative {
+public:
+    /**
+     * Returns a new matrix with every element of the expression
+     * differentiated with respect to the name in the 1x1 variable matrix.
+     */
+    static Matrix* of(const Matrix* expression, const Matrix* variable);
+
+    /**
+     * Returns a new matrix with the derivative of every element of the
+     * outputs with respect to every name in the variables, with a row per
+     * output and a column per name. Both have to be vectors. Throws
+     * std::invalid_argument if a variable is not a plain name, or if an
+     * output depends on a name through a symbol that can't be
+     * differentiated, like a function of a matrix.
+     */
+    static Matrix* jacobian(const Matrix* outputs, const Matrix* variables);
+
+private:
+    struct Node {
+        const Symbol* symbol;
+        std::vector<int> children;
+        bool dependent;
+    };
+
+    explicit Derivative(std::vector<std::string> names);
+
+    /**
+     * Adds the symbol and everything below it to the graph, unless an
+     * identical subtree is already in it. Children are always added before
+     * their parents. Returns the index of the node.
+     */
+    int add(const Symbol* symbol);
+
+    /**
+     * Returns new symbols with the derivative of the node with respect to
+     * every name.
+     */
+    std::vector<Symbol*> gradient(int output) const;
+
+    /**
+     * Adds the contribution to the derivative of the output with respect to
+     * the node, consuming the contribution.
+     */
+    static void accumulate(std::vector<Symbol*>& adjoints, int node, Symbol* contribution);
+
+    std::vector<std::string> mNames;
+    std::vector<Node> mNodes;
+    std::unordered_map<std::string, int> mIds;
+};
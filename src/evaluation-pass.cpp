@@ -0,0 +1,81 @@
+#include "evaluation-pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <vector>
+#include "pass-manager.hpp"
+#include "matrix-chain.hpp"
+#include "matrix.hpp"
+#include "sparse-matrix.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "function.hpp"
+
+const char* EvaluationPass::getName() const {
+    return "evaluation";
+}
+
+Symbol* EvaluationPass::leave(Symbol* input, PassManager& manager) {
+    if (auto* product = dynamic_cast<Product*>(input)) {
+        bool anyMatrix = false;
+        for (int i = 0; i < product->getFactors(); i++) {
+            const Symbol* factor = product->get(i);
+            if (isKnown(factor)) anyMatrix = true;
+            else if (!factor->isScalar()) return input;
+        }
+        if (!anyMatrix) return input;
+
+        std::vector<Symbol*> scalars, matrices;
+        for (int i = 0; i < product->getFactors(); i++) {
+            Symbol* factor = product->get(i)->copy();
+            (isKnown(factor) ? matrices : scalars).push_back(factor);
+        }
+        delete input;
+
+        // Scalars commute with matrices, so they are applied last
+        Symbol* result = MatrixChain::multiply(matrices);
+        for (auto* scalar : scalars) {
+            result = *result * scalar;
+        }
+
+        // The elements of the result are new expressions
+        return manager.run(result);
+    }
+
+    if (auto* sum = dynamic_cast<Sum*>(input)) {
+        if (sum->getTerms() == 0) return input;
+        for (int i = 0; i < sum->getTerms(); i++) {
+            if (!isKnown(sum->get(i))) return input;
+        }
+
+        Symbol* result = sum->get(0)->copy();
+        for (int i = 1; i < sum->getTerms(); i++) {
+            result = *result + sum->get(i)->copy();
+        }
+        delete input;
+        return manager.run(result);
+    }
+
+    if (auto* function = dynamic_cast<Function*>(input)) {
+        // Names that are still undefined after substitution are scalars
+        for (int i = 0; i < function->getArguments(); i++) {
+            const Symbol* argument = function->get(i);
+            if (!isKnown(argument) && !argument->isScalar()) return input;
+        }
+
+        // The elements of the result are new expressions
+        return manager.run(function->apply());
+    }
+
+    return input;
+}
+
+bool EvaluationPass::isKnown(const Symbol* symbol) {
+    if (dynamic_cast<const Matrix*>(symbol)) return true;
+    if (dynamic_cast<const SparseMatrix*>(symbol)) return true;
+    auto* blocks = dynamic_cast<const BlockMatrix*>(symbol);
+    return blocks != nullptr && blocks->isKnown();
+}
@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include "pass.hpp"
+
+/**
+ * Computes products and sums of matrices whose elements are known, like the
+ * ones left behind when defined matrices are substituted into an
+ * expression, and calls to functions whose arguments are known. It runs at every optimization level and is never skipped, so
+ * the level and the time budget only decide how much the result is
+ * simplified, not whether it is computed.
+ */
+class EvaluationPass : public Pass {
+public:
+    const char* getName() const override;
+
+    Symbol* leave(Symbol* input, PassManager& manager) override;
+
+private:
+    static bool isKnown(const Symbol* symbol);
+};
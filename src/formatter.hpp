@@ -17,6 +17,21 @@ public:
 
     virtual std::string matrix(int rows, int cols, const std::vector<std::string>& elements) const = 0;
 
+    /**
+     * Formats a symmetric matrix from the rows of its upper triangle, with
+     * the diagonal. Unless overridden it is written out as a full matrix.
+     */
+    virtual std::string symmetric(int size, const std::vector<std::string>& upper) const {
+        std::vector<std::string> elements((std::size_t) size * size);
+        for (int i = 0, idx = 0; i < size; i++) {
+            for (int j = i; j < size; j++, idx++) {
+                elements[i * size + j] = upper[idx];
+                elements[j * size + i] = upper[idx];
+            }
+        }
+        return matrix(size, size, elements);
+    }
+
     virtual std::string unknown(const std::string &unknown) const = 0;
 
     virtual std::string paranthesis(const std::string &middle) const = 0;
@@ -33,6 +48,19 @@ public:
 
     virtual std::string negate(const std::string &unknown) const = 0;
 
+    virtual std::string transpose(const std::string &inner) const = 0;
+
+    /**
+     * Formats the given rows and columns of a matrix that is not known yet.
+     * The ranges are written like "0:3", ":" or "3".
+     */
+    virtual std::string slice(const std::string &inner, const std::string &rows,
+                              const std::string &cols) const {
+        return inner + "[" + rows + "," + cols + "]";
+    }
+
+    virtual std::string call(const std::string &function, const std::vector<std::string>& arguments) const = 0;
+
     virtual std::string assign(const std::string& name, const std::string& value) const = 0;
 };
 
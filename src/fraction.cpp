@@ -0,0 +1,120 @@
+#include "fraction.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include "constant.hpp"
+#include "variable.hpp"
+#include "invalid-expression.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+Fraction::Fraction(Symbol* numerator, Symbol* denominator) :
+    Symbol{}, mNumerator{numerator}, mDenominator{denominator} {}
+
+Fraction::~Fraction() {
+    delete mNumerator;
+    delete mDenominator;
+}
+
+const Symbol *Fraction::getNumerator() const {
+    return mNumerator;
+}
+
+const Symbol *Fraction::getDenominator() const {
+    return mDenominator;
+}
+
+Symbol *Fraction::copy() const {
+    Stats::symbolCopied();
+    return new Fraction(mNumerator->copy(), mDenominator->copy());
+}
+
+Symbol *Fraction::negate() {
+    mNumerator = mNumerator->negate();
+    return this;
+}
+
+Symbol *Fraction::operator+(Symbol *other) {
+    if (other->isZero()) {
+        delete other;
+        return this;
+    }
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *Fraction::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *Fraction::operator*(Symbol *other) {
+    if (!other->isScalar()) {
+        return *other * this; // Scalars commute with matrices
+    }
+    if (dynamic_cast<Constant*>(other)) {
+        mNumerator = *mNumerator * other;
+        return this;
+    }
+    return new Product(this, other);
+}
+
+Symbol *Fraction::operator/(Symbol *other) {
+    if (!other->isScalar()) throw InvalidExpression();
+    mDenominator = *mDenominator * other;
+    return this;
+}
+
+Symbol *Fraction::replace(const std::function<bool(const Symbol *)> &predicate,
+                          const std::function<Symbol *(Symbol *)> &mapper) {
+    if (predicate(mNumerator)) {
+        mNumerator = mapper(mNumerator);
+    }
+    if (predicate(mDenominator)) {
+        mDenominator = mapper(mDenominator);
+    }
+    return this;
+}
+
+std::string Fraction::format(const Formatter &formatter) const {
+    std::string bottom = mDenominator->format(formatter);
+
+    // Sums already have parenthesis around them
+    auto* variable = dynamic_cast<const Variable*>(mDenominator);
+    if (dynamic_cast<const Product*>(mDenominator) || dynamic_cast<const Fraction*>(mDenominator)
+    ||  (variable != nullptr && fabsf(variable->getQuantity() - 1.0f) >= FLT_EPSILON)) {
+        bottom = formatter.paranthesis(bottom);
+    }
+
+    return formatter.divide(mNumerator->format(formatter), bottom);
+}
+
+bool Fraction::isConstant() const {
+    return mNumerator->isConstant() && mDenominator->isConstant();
+}
+
+bool Fraction::isZero() const {
+    return mNumerator->isZero();
+}
+
+int Fraction::getColumns() const {
+    return 1;
+}
+
+int Fraction::getRows() const {
+    return 1;
+}
+
+std::set<std::string> Fraction::findUndefined() {
+    auto undefined = mNumerator->findUndefined();
+    for (auto& name : mDenominator->findUndefined()) {
+        undefined.insert(name);
+    }
+    return undefined;
+}
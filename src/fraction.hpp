@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include "symbol.hpp"
+
+/**
+ * A scalar divided by another scalar that it could not be simplified with.
+ */
+class Fraction : public Symbol {
+public:
+    explicit Fraction(Symbol* numerator, Symbol* denominator);
+
+    ~Fraction() override;
+
+    const Symbol* getNumerator() const;
+
+    const Symbol* getDenominator() const;
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    Symbol* mNumerator;
+    Symbol* mDenominator;
+};
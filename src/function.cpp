@@ -0,0 +1,295 @@
+#include "function.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include "constant.hpp"
+#include "derivative.hpp"
+#include "fraction.hpp"
+#include "invalid-expression.hpp"
+#include "matrix.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "sparse-matrix.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+namespace {
+    // The number of arguments that every function takes
+    const std::map<std::string, int>& arities() {
+        static const std::map<std::string, int> arities {
+            {"det", 1}, {"inv", 1}, {"solve", 2}, {"eye", 1},
+            {"times", 2}, {"rdivide", 2}, {"d", 2}, {"jacobian", 2}
+        };
+        return arities;
+    }
+
+    Matrix* asMatrix(Symbol* symbol) {
+        if (auto* matrix = dynamic_cast<Matrix*>(symbol)) return matrix;
+        if (auto* blocks = dynamic_cast<BlockMatrix*>(symbol)) {
+            if (blocks->isKnown()) return static_cast<Matrix*>(BlockMatrix::flatten(blocks));
+        }
+        if (auto* sparse = dynamic_cast<SparseMatrix*>(symbol)) {
+            Matrix* matrix = sparse->toMatrix();
+            delete sparse;
+            return matrix;
+        }
+        auto* matrix = Matrix::zero(1, 1);
+        matrix->set(0, 0, symbol);
+        return matrix;
+    }
+
+    // The size of a dimension where a size of one is repeated to the other
+    int broadcast(int left, int right) {
+        if (left == 1) return right;
+        if (right == 1) return left;
+        return left == Symbol::UNKNOWN ? right : left;
+    }
+}
+
+Function::Function(std::string name, std::vector<Symbol*> arguments) :
+    Symbol{}, mName{std::move(name)}, mArguments{std::move(arguments)} {}
+
+Function::~Function() {
+    for (auto* argument : mArguments) {
+        delete argument;
+    }
+}
+
+bool Function::exists(const std::string& name) {
+    return arities().count(name) > 0;
+}
+
+Symbol *Function::call(const std::string& name, std::vector<Symbol*> arguments) {
+    auto arity = arities().find(name);
+    if (arity == arities().end() || (int) arguments.size() != arity->second) {
+        for (auto* argument : arguments) delete argument;
+        if (arity == arities().end()) {
+            throw std::invalid_argument("Unknown function '" + name + "'.");
+        }
+        throw std::invalid_argument("Function '" + name + "' takes " +
+            std::to_string(arity->second) + " argument(s).");
+    }
+
+    // Element-wise operations with a scalar are ordinary ones
+    if (name == "times" && (arguments[0]->isScalar() || arguments[1]->isScalar())) {
+        return arguments[1]->isScalar() ? *arguments[0] * arguments[1]
+                                        : *arguments[1] * arguments[0];
+    } else if (name == "rdivide" && arguments[1]->isScalar()) {
+        return *arguments[0] / arguments[1];
+    }
+
+    auto* function = new Function(name, std::move(arguments));
+    return function->isKnown() ? function->apply() : function;
+}
+
+std::pair<int, int> Function::dimensions(const std::string& name,
+        const std::vector<std::pair<int, int>>& arguments) {
+    if (name == "inv") return arguments[0];
+    if (name == "solve") return {arguments[0].second, arguments[1].second};
+    if (name == "eye") return {Symbol::UNKNOWN, Symbol::UNKNOWN}; // Known once applied
+    if (name == "d") return arguments[0];
+    if (name == "jacobian") {
+        const auto& outputs = arguments[0];
+        const auto& names = arguments[1];
+        if (outputs.first == Symbol::UNKNOWN || outputs.second == Symbol::UNKNOWN
+        ||  names.first == Symbol::UNKNOWN || names.second == Symbol::UNKNOWN) {
+            return {Symbol::UNKNOWN, Symbol::UNKNOWN};
+        }
+        return {outputs.first * outputs.second, names.first * names.second};
+    }
+    if (name == "times" || name == "rdivide") {
+        return {broadcast(arguments[0].first, arguments[1].first),
+                broadcast(arguments[0].second, arguments[1].second)};
+    }
+    return {1, 1};
+}
+
+const std::string &Function::getName() const {
+    return mName;
+}
+
+int Function::getArguments() const {
+    return mArguments.size();
+}
+
+const Symbol *Function::get(int argument) const {
+    return mArguments[argument];
+}
+
+bool Function::isKnown() const {
+    // Derivatives wait for the defines to be substituted
+    if (mName == "d" || mName == "jacobian") return false;
+
+    for (auto* argument : mArguments) {
+        auto* blocks = dynamic_cast<BlockMatrix*>(argument);
+        if (blocks != nullptr && blocks->isKnown()) continue;
+        if (!dynamic_cast<Matrix*>(argument) && !dynamic_cast<Constant*>(argument)
+        &&  !dynamic_cast<SparseMatrix*>(argument)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Symbol *Function::apply() {
+    // Sparse systems are solved without ever making the matrix dense
+    auto* sparse = dynamic_cast<SparseMatrix*>(mArguments[0]);
+    if (sparse != nullptr && mName == "solve") {
+        Matrix* right = asMatrix(mArguments[1]);
+        mArguments.pop_back();
+        try {
+            Matrix* result = sparse->solve(right);
+            delete right;
+            delete this;
+            return result;
+        } catch (...) {
+            delete right;
+            delete this;
+            throw;
+        }
+    }
+
+    std::vector<Matrix*> matrices;
+    for (auto* argument : mArguments) {
+        matrices.push_back(asMatrix(argument));
+    }
+    mArguments.clear();
+
+    Symbol* result;
+    try {
+        if (mName == "det") {
+            result = matrices[0]->determinant();
+        } else if (mName == "inv") {
+            result = matrices[0]->inverse();
+        } else if (mName == "eye") {
+            auto* size = dynamic_cast<const Constant*>(matrices[0]->get(0, 0));
+            if (!matrices[0]->isScalar() || size == nullptr || size->getValue() < 1.0f
+            ||  floorf(size->getValue()) != size->getValue()) {
+                throw std::invalid_argument("The size of eye() must be a positive integer.");
+            }
+            result = Matrix::eye((int) size->getValue());
+        } else if (mName == "d") {
+            result = Derivative::of(matrices[0], matrices[1]);
+        } else if (mName == "jacobian") {
+            result = Derivative::jacobian(matrices[0], matrices[1]);
+        } else if (mName == "times") {
+            result = matrices[0]->multiplyElements(matrices[1]);
+        } else if (mName == "rdivide") {
+            result = matrices[0]->divideElements(matrices[1]);
+        } else {
+            result = matrices[0]->solve(matrices[1]);
+        }
+    } catch (...) {
+        for (auto* matrix : matrices) delete matrix;
+        delete this;
+        throw;
+    }
+
+    for (auto* matrix : matrices) delete matrix;
+    delete this;
+
+    // Functions of scalars are scalars
+    auto* matrix = dynamic_cast<Matrix*>(result);
+    if (matrix != nullptr && matrix->isScalar()) {
+        Symbol* element = matrix->get(0, 0)->copy();
+        delete matrix;
+        return element;
+    }
+
+    return result;
+}
+
+Symbol *Function::copy() const {
+    Stats::symbolCopied();
+    std::vector<Symbol*> arguments;
+    for (auto* argument : mArguments) {
+        arguments.push_back(argument->copy());
+    }
+    return new Function(mName, std::move(arguments));
+}
+
+Symbol *Function::negate() {
+    return new Product(new Constant{-1.0f}, this);
+}
+
+Symbol *Function::operator+(Symbol *other) {
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *Function::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *Function::operator*(Symbol *other) {
+    // The order is kept since the result may be a matrix
+    return new Product(this, other);
+}
+
+Symbol *Function::operator/(Symbol *other) {
+    if (!isScalar() || !other->isScalar()) throw InvalidExpression();
+    return new Fraction(this, other);
+}
+
+Symbol *Function::replace(const std::function<bool(const Symbol *)> &predicate,
+                          const std::function<Symbol *(Symbol *)> &mapper) {
+    for (auto& argument : mArguments) {
+        if (predicate(argument)) {
+            argument = mapper(argument);
+        }
+    }
+
+    return this;
+}
+
+std::string Function::format(const Formatter &formatter) const {
+    std::vector<std::string> arguments;
+    for (auto* argument : mArguments) {
+        arguments.push_back(argument->format(formatter));
+    }
+    return formatter.call(mName, arguments);
+}
+
+bool Function::isConstant() const {
+    for (auto* argument : mArguments) {
+        if (!argument->isConstant()) return false;
+    }
+    return true;
+}
+
+bool Function::isZero() const {
+    return false;
+}
+
+int Function::getColumns() const {
+    return size().second;
+}
+
+int Function::getRows() const {
+    return size().first;
+}
+
+std::pair<int, int> Function::size() const {
+    std::vector<std::pair<int, int>> arguments;
+    for (auto* argument : mArguments) {
+        arguments.emplace_back(argument->getRows(), argument->getColumns());
+    }
+    return dimensions(mName, arguments);
+}
+
+std::set<std::string> Function::findUndefined() {
+    std::set<std::string> undefined;
+    for (auto* argument : mArguments) {
+        for (auto& name : argument->findUndefined()) {
+            undefined.insert(name);
+        }
+    }
+    return undefined;
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "symbol.hpp"
+
+/**
+ * A call to one of the built-in matrix functions:
+ *
+ *   det(A)        the determinant of A
+ *   inv(A)        the inverse of A
+ *   solve(A, B)   the solution X to A*X = B, also written A \ B
+ *   eye(n)        the n x n identity matrix
+ *   times(A, B)   the element-wise product of A and B, also written A .* B
+ *   rdivide(A, B) the element-wise quotient of A and B, also written A ./ B
+ *   d(A, x)       the derivative of every element of A with respect to x
+ *   jacobian(f, [x, y, ...])
+ *                 the derivatives of the vector f with respect to each name
+ *
+ * The element-wise functions repeat a single row, column or element of one
+ * side across the other side, and are plain products and quotients if a
+ * side is a scalar.
+ *
+ * The arguments are usually names that are substituted later on, so the
+ * call is kept until the defines have been substituted, unless the
+ * arguments are already matrices or numbers when it is parsed. Derivatives
+ * are always kept until then, since a name in the expression may still be
+ * substituted.
+ */
+class Function : public Symbol {
+public:
+    static bool exists(const std::string& name);
+
+    /**
+     * Calls the function with the given arguments, consuming them. Returns
+     * the result right away if the arguments are known.
+     */
+    static Symbol* call(const std::string& name, std::vector<Symbol*> arguments);
+
+    /**
+     * The dimensions of the result of the function, given the dimensions of
+     * the arguments.
+     */
+    static std::pair<int, int> dimensions(const std::string& name,
+        const std::vector<std::pair<int, int>>& arguments);
+
+    ~Function() override;
+
+    const std::string& getName() const;
+
+    int getArguments() const;
+
+    const Symbol* get(int argument) const;
+
+    /**
+     * Computes the function, treating arguments that are not matrices as
+     * scalars. Consumes this.
+     */
+    Symbol* apply();
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    explicit Function(std::string name, std::vector<Symbol*> arguments);
+
+    bool isKnown() const;
+
+    std::pair<int, int> size() const;
+
+    const std::string mName;
+    std::vector<Symbol*> mArguments;
+};
@@ -82,6 +82,24 @@ std::string GlmFormatter::negate(const std::string &unknown) const {
     return "-" + unknown;
 }
 
+std::string GlmFormatter::transpose(const std::string &inner) const {
+    return "transpose(" + inner + ")";
+}
+
+std::string GlmFormatter::call(const std::string &function,
+                               const std::vector<std::string> &arguments) const {
+    if (function == "det") return "determinant(" + arguments[0] + ")";
+    if (function == "inv") return "inverse(" + arguments[0] + ")";
+    if (function == "solve") return "inverse(" + arguments[0] + ") * " + arguments[1];
+
+    std::string result = function + "(";
+    for (std::vector<std::string>::size_type i = 0; i < arguments.size(); i++) {
+        if (i > 0) result += ", ";
+        result += arguments[i];
+    }
+    return result + ")";
+}
+
 std::string
 GlmFormatter::assign(const std::string& name, const std::string& value) const {
     throw std::invalid_argument("Not implemented yet.");
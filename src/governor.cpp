@@ -0,0 +1,100 @@
+#include "governor.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <chrono>
+#include "resource-limit-exceeded.hpp"
+#include "stats.hpp"
+
+namespace {
+    // Reading the clock is much slower than the other checks, so the time
+    // is only looked at every this many checks.
+    const int TIME_CHECK_INTERVAL = 1024;
+
+    struct Limits {
+        long maxLiveNodes = 0;
+        long maxTerms = 0;
+        double maxSeconds = 0.0;
+        std::chrono::steady_clock::time_point start;
+        int countdown = TIME_CHECK_INTERVAL;
+        std::string define;
+    };
+
+    Limits& limits() {
+        static Limits instance;
+        return instance;
+    }
+}
+
+Governor::Define::Define(const std::string& name) :
+    mPrevious{limits().define} {
+    limits().define = name;
+}
+
+Governor::Define::~Define() {
+    limits().define = mPrevious;
+}
+
+void Governor::setMaxLiveNodes(long nodes) {
+    limits().maxLiveNodes = nodes;
+    update();
+}
+
+void Governor::setMaxTerms(long terms) {
+    limits().maxTerms = terms;
+    update();
+}
+
+void Governor::setTimeLimit(double seconds) {
+    auto& l = limits();
+    l.maxSeconds = seconds;
+    l.start = std::chrono::steady_clock::now();
+    update();
+}
+
+void Governor::reset() {
+    auto& l = limits();
+    l.maxLiveNodes = 0;
+    l.maxTerms = 0;
+    l.maxSeconds = 0.0;
+    update();
+}
+
+const std::string& Governor::getDefine() {
+    return limits().define;
+}
+
+void Governor::checkLimits() {
+    auto& l = limits();
+
+    if (l.maxLiveNodes > 0) {
+        const long live = Stats::getLiveSymbols();
+        if (live > l.maxLiveNodes) {
+            throw ResourceLimitExceeded("live nodes", live, l.maxLiveNodes, l.define);
+        }
+    }
+
+    if (l.maxSeconds > 0.0 && --l.countdown <= 0) {
+        l.countdown = TIME_CHECK_INTERVAL;
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - l.start).count();
+        if (seconds > l.maxSeconds) {
+            throw ResourceLimitExceeded("wall time in seconds", seconds, l.maxSeconds, l.define);
+        }
+    }
+}
+
+void Governor::checkTermLimit(std::size_t terms) {
+    auto& l = limits();
+    if (l.maxTerms > 0 && (long) terms > l.maxTerms) {
+        throw ResourceLimitExceeded("terms", (double) terms, l.maxTerms, l.define);
+    }
+    checkLimits();
+}
+
+void Governor::update() {
+    auto& l = limits();
+    sEnabled = l.maxLiveNodes > 0 || l.maxTerms > 0 || l.maxSeconds > 0.0;
+}
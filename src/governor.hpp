@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Enforces the limits on live nodes, terms per sum and wall time. The
+ * arithmetic operators and the optimizer call check() as they go, which
+ * throws a ResourceLimitExceeded naming the current define as soon as a
+ * limit is hit. Without any limits, a check only costs a check of a global
+ * flag.
+ */
+class Governor {
+public:
+    /**
+     * Names the define that is being computed until it goes out of scope.
+     */
+    class Define {
+    public:
+        explicit Define(const std::string& name);
+
+        ~Define();
+
+    private:
+        std::string mPrevious;
+    };
+
+    static void setMaxLiveNodes(long nodes);
+
+    static void setMaxTerms(long terms);
+
+    /**
+     * Limits the wall time, counted from this call.
+     */
+    static void setTimeLimit(double seconds);
+
+    /**
+     * Removes all limits.
+     */
+    static void reset();
+
+    static void check() {
+        if (sEnabled) checkLimits();
+    }
+
+    static void checkTerms(std::size_t terms) {
+        if (sEnabled) checkTermLimit(terms);
+    }
+
+    static const std::string& getDefine();
+
+private:
+    static void checkLimits();
+
+    static void checkTermLimit(std::size_t terms);
+
+    static void update();
+
+    static inline bool sEnabled = false;
+};
@@ -64,6 +64,24 @@ std::string LatexFormatter::negate(const std::string &unknown) const {
     return "-" + unknown;
 }
 
+std::string LatexFormatter::transpose(const std::string &inner) const {
+    return inner + "^{T}";
+}
+
+std::string LatexFormatter::call(const std::string &function,
+                                 const std::vector<std::string> &arguments) const {
+    if (function == "det") return "\\det" + paranthesis(arguments[0]);
+    if (function == "inv") return arguments[0] + "^{-1}";
+    if (function == "solve") return arguments[0] + "^{-1} " + arguments[1];
+
+    std::string result;
+    for (std::vector<std::string>::size_type i = 0; i < arguments.size(); i++) {
+        if (i > 0) result += ", ";
+        result += arguments[i];
+    }
+    return "\\operatorname{" + function + "}" + paranthesis(result);
+}
+
 std::string LatexFormatter::matrix(int rows, int cols, const std::vector<std::string> &elements) const {
     std::string result = "\\left[\\begin{matrix}";
 
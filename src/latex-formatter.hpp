@@ -31,5 +31,9 @@ public:
 
     std::string negate(const std::string &unknown) const override;
 
+    std::string transpose(const std::string &inner) const override;
+
+    std::string call(const std::string &function, const std::vector<std::string> &arguments) const override;
+
     std::string assign(const std::string& name, const std::string& value) const override;
 };
@@ -0,0 +1,392 @@
+#include "lazy-evaluator.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include "symbol.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "matrix.hpp"
+#include "matrix-symbol.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "transpose.hpp"
+#include "slice.hpp"
+#include "sparse-matrix.hpp"
+#include "function.hpp"
+#include "optimizer.hpp"
+#include "invalid-expression.hpp"
+#include "governor.hpp"
+
+LazyEvaluator::LazyEvaluator(const std::map<std::string, Symbol*>& defines,
+                             Optimizer& optimizer) :
+    mDefines{defines}, mOptimizer{optimizer}, mElements{}, mRows{},
+    mColumns{}, mColumnMajor{false}, mValues{}, mSubstituted{}, mDimensions{} {}
+
+LazyEvaluator::~LazyEvaluator() {
+    for (auto& entry : mElements) delete entry.second;
+    for (auto& entry : mRows) {
+        for (auto* element : entry.second) delete element;
+    }
+    for (auto& entry : mColumns) {
+        for (auto* element : entry.second) delete element;
+    }
+    for (auto& entry : mValues) delete entry.second;
+    for (auto& entry : mSubstituted) delete entry.second;
+}
+
+Symbol *LazyEvaluator::element(const Symbol* symbol, int row, int col) {
+    // Leaves are cheaper to copy than to remember, and matrices, transposes
+    // and plain names only forward to another symbol.
+    if (dynamic_cast<const Constant*>(symbol)) {
+        return symbol->copy();
+    } else if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        const Symbol* define = findDefine(variable);
+        if (define == nullptr) return symbol->copy();
+        if (fabsf(variable->getExponent() - 1.0f) < FLT_EPSILON
+        &&  fabsf(variable->getQuantity() - 1.0f) < FLT_EPSILON) {
+            return isScalar(define) ? element(define, 0, 0) : element(define, row, col);
+        }
+    } else if (auto* name = dynamic_cast<const MatrixSymbol*>(symbol)) {
+        const Symbol* define = findDefine(name);
+        if (define != nullptr && fabsf(name->getExponent() - 1.0f) < FLT_EPSILON) {
+            return isScalar(define) ? element(define, 0, 0) : element(define, row, col);
+        }
+    } else if (auto* matrix = dynamic_cast<const Matrix*>(symbol)) {
+        return element(matrix->get(row, col), 0, 0);
+    } else if (auto* transpose = dynamic_cast<const Transpose*>(symbol)) {
+        return element(transpose->getInner(), col, row);
+    } else if (auto* slice = dynamic_cast<const Slice*>(symbol)) {
+        return element(slice->getInner(), row + slice->getFirstRow(), col + slice->getFirstColumn());
+    } else if (auto* sparse = dynamic_cast<const SparseMatrix*>(symbol)) {
+        return new Constant{(float) sparse->getValues().get(row, col)};
+    }
+
+    const Key key {symbol, row, col};
+    auto found = mElements.find(key);
+    if (found != mElements.end()) return found->second->copy();
+
+    Symbol* result = compute(symbol, row, col);
+    mElements.emplace(key, result);
+    return result->copy();
+}
+
+Symbol *LazyEvaluator::evaluate(const Symbol* symbol) {
+    return value(symbol)->copy();
+}
+
+void LazyEvaluator::setColumnMajor(bool columnMajor) {
+    mColumnMajor = columnMajor;
+}
+
+int LazyEvaluator::getRows(const Symbol* symbol) {
+    return dimensions(symbol).first;
+}
+
+int LazyEvaluator::getColumns(const Symbol* symbol) {
+    return dimensions(symbol).second;
+}
+
+Symbol *LazyEvaluator::compute(const Symbol* symbol, int row, int col) {
+    if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        const Symbol* define = findDefine(variable);
+        const bool unitExponent = fabsf(variable->getExponent() - 1.0f) < FLT_EPSILON;
+        const bool scalar = isScalar(define);
+
+        // Powers of matrices are evaluated in full below
+        if (scalar || unitExponent) {
+            Symbol* result = scalar ? element(define, 0, 0) : element(define, row, col);
+            if (!unitExponent) {
+                result = result->pow(variable->getExponent());
+            }
+            if (fabsf(variable->getQuantity() - 1.0f) >= FLT_EPSILON) {
+                result = *result * variable->getQuantity();
+            }
+            return result;
+        }
+    } else if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        Symbol* result = nullptr;
+        for (int i = 0; i < sum->getTerms(); i++) {
+            const Symbol* term = sum->get(i);
+            Symbol* value = isScalar(term)
+                ? element(term, 0, 0)
+                : element(term, row, col);
+            result = result == nullptr ? value : *result + value;
+        }
+        return result;
+    } else if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        return productElement(product, row, col);
+    } else if (auto* function = dynamic_cast<const Function*>(symbol)) {
+        // Only the elements that are asked for are multiplied or divided
+        const bool times = function->getName() == "times";
+        if (times || function->getName() == "rdivide") {
+            const Symbol* left = function->get(0);
+            const Symbol* right = function->get(1);
+            Symbol* a = element(left, getRows(left) == 1 ? 0 : row, getColumns(left) == 1 ? 0 : col);
+            Symbol* b = element(right, getRows(right) == 1 ? 0 : row, getColumns(right) == 1 ? 0 : col);
+            return times ? *a * b : *a / b;
+        }
+    }
+
+    const Symbol* evaluated = value(symbol);
+    if (auto* matrix = dynamic_cast<const Matrix*>(evaluated)) {
+        return matrix->get(row, col)->copy();
+    } else if (evaluated->isScalar()) {
+        return evaluated->copy();
+    }
+
+    throw InvalidExpression();
+}
+
+Symbol *LazyEvaluator::productElement(const Product* product, int row, int col) {
+    // Scalars commute with matrices, so they can be multiplied in last
+    Symbol* scale = new Constant{1.0f};
+    std::vector<const Symbol*> matrices;
+    for (int i = 0; i < product->getFactors(); i++) {
+        const Symbol* factor = product->get(i);
+        if (isScalar(factor)) {
+            scale = *scale * element(factor, 0, 0);
+        } else {
+            matrices.push_back(factor);
+        }
+    }
+
+    if (matrices.empty()) return scale;
+
+    Symbol* result;
+    if (matrices.size() == 1) {
+        result = element(matrices[0], row, col);
+    } else if (mColumnMajor) {
+        result = dot(matrices.front(), row, productColumn(product, matrices, col));
+    } else {
+        result = dot(productRow(product, matrices, row), matrices.back(), col);
+    }
+
+    auto* constant = dynamic_cast<Constant*>(scale);
+    if (constant != nullptr && constant->isOne()) {
+        delete scale;
+        return result;
+    }
+
+    return *result * scale;
+}
+
+const std::vector<Symbol*>& LazyEvaluator::productRow(
+        const Product* product, const std::vector<const Symbol*>& matrices, int row) {
+
+    const std::pair<const Symbol*, int> key {product, row};
+    auto found = mRows.find(key);
+    if (found != mRows.end()) return found->second;
+
+    // Multiply the row through the chain from the left, so that every step
+    // is a vector-matrix product instead of a matrix-matrix product.
+    std::vector<Symbol*> current;
+    for (int k = 0; k < getColumns(matrices[0]); k++) {
+        current.push_back(element(matrices[0], row, k));
+    }
+
+    for (std::vector<const Symbol*>::size_type i = 1; i + 1 < matrices.size(); i++) {
+        std::vector<Symbol*> next;
+        for (int j = 0; j < getColumns(matrices[i]); j++) {
+            next.push_back(dot(current, matrices[i], j));
+        }
+        for (auto* element : current) delete element;
+        current = std::move(next);
+    }
+
+    return mRows.emplace(key, std::move(current)).first->second;
+}
+
+const std::vector<Symbol*>& LazyEvaluator::productColumn(
+        const Product* product, const std::vector<const Symbol*>& matrices, int col) {
+
+    const std::pair<const Symbol*, int> key {product, col};
+    auto found = mColumns.find(key);
+    if (found != mColumns.end()) return found->second;
+
+    const auto last = matrices.size() - 1;
+    std::vector<Symbol*> current;
+    for (int k = 0; k < getRows(matrices[last]); k++) {
+        current.push_back(element(matrices[last], k, col));
+    }
+
+    for (auto i = last - 1; i > 0; i--) {
+        std::vector<Symbol*> next;
+        for (int j = 0; j < getRows(matrices[i]); j++) {
+            next.push_back(dot(matrices[i], j, current));
+        }
+        for (auto* element : current) delete element;
+        current = std::move(next);
+    }
+
+    return mColumns.emplace(key, std::move(current)).first->second;
+}
+
+Symbol *LazyEvaluator::dot(const std::vector<Symbol*>& row, const Symbol* matrix, int col) {
+    if ((int) row.size() != getRows(matrix)) {
+        throw InvalidExpression(); // Dimensions does not match
+    }
+
+    Symbol* result = new Constant{0.0f};
+    for (std::vector<Symbol*>::size_type k = 0; k < row.size(); k++) {
+        if (row[k]->isZero()) continue;
+
+        Symbol* right = element(matrix, (int) k, col);
+        if (right->isZero()) {
+            delete right;
+            continue;
+        }
+
+        Governor::check();
+        result = *result + (*row[k]->copy() * right);
+    }
+    return result;
+}
+
+Symbol *LazyEvaluator::dot(const Symbol* matrix, int row, const std::vector<Symbol*>& col) {
+    if ((int) col.size() != getColumns(matrix)) {
+        throw InvalidExpression(); // Dimensions does not match
+    }
+
+    Symbol* result = new Constant{0.0f};
+    for (std::vector<Symbol*>::size_type k = 0; k < col.size(); k++) {
+        if (col[k]->isZero()) continue;
+
+        Symbol* left = element(matrix, row, (int) k);
+        if (left->isZero()) {
+            delete left;
+            continue;
+        }
+
+        Governor::check();
+        result = *result + (*left * col[k]->copy());
+    }
+    return result;
+}
+
+const Symbol *LazyEvaluator::value(const Symbol* symbol) {
+    auto found = mValues.find(symbol);
+    if (found != mValues.end()) return found->second;
+
+    Symbol* result = BlockMatrix::flatten(mOptimizer.optimize(substitute(symbol->copy())));
+    mValues.emplace(symbol, result);
+    return result;
+}
+
+Symbol *LazyEvaluator::substitute(Symbol* symbol) {
+    if (auto* variable = dynamic_cast<Variable*>(symbol)) {
+        const Symbol* define = findDefine(variable);
+        if (define == nullptr) return symbol;
+
+        Symbol* result = substituted(define)->copy();
+        if (fabsf(variable->getExponent() - 1.0f) >= FLT_EPSILON) {
+            result = result->pow(variable->getExponent());
+        }
+        if (fabsf(variable->getQuantity() - 1.0f) >= FLT_EPSILON) {
+            result = *result * variable->getQuantity();
+        }
+
+        delete symbol;
+        return result;
+    }
+
+    if (auto* name = dynamic_cast<MatrixSymbol*>(symbol)) {
+        const Symbol* define = findDefine(name);
+        if (define == nullptr) return symbol;
+
+        Symbol* result = substituted(define)->copy();
+        if (fabsf(name->getExponent() - 1.0f) >= FLT_EPSILON) {
+            result = result->pow(name->getExponent());
+        }
+
+        delete symbol;
+        return result;
+    }
+
+    return symbol->replace(
+        [](const Symbol*) -> bool { return true; },
+        [this](Symbol* child) -> Symbol* { return substitute(child); });
+}
+
+const Symbol *LazyEvaluator::substituted(const Symbol* define) {
+    auto found = mSubstituted.find(define);
+    if (found != mSubstituted.end()) return found->second;
+
+    Symbol* result = substitute(define->copy());
+    mSubstituted.emplace(define, result);
+    return result;
+}
+
+const Symbol *LazyEvaluator::findDefine(const Symbol* symbol) const {
+    const std::string* name = nullptr;
+    if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        name = &variable->getName();
+    } else if (auto* matrix = dynamic_cast<const MatrixSymbol*>(symbol)) {
+        name = &matrix->getName();
+    }
+    if (name == nullptr) return nullptr;
+
+    auto define = mDefines.find(*name);
+    return define == mDefines.end() ? nullptr : define->second;
+}
+
+const std::pair<int, int>& LazyEvaluator::dimensions(const Symbol* symbol) {
+    auto found = mDimensions.find(symbol);
+    if (found != mDimensions.end()) return found->second;
+
+    std::pair<int, int> result {1, 1};
+    if (dynamic_cast<const Variable*>(symbol)) {
+        if (const Symbol* define = findDefine(symbol)) {
+            result = dimensions(define);
+        }
+    } else if (dynamic_cast<const MatrixSymbol*>(symbol)) {
+        const Symbol* define = findDefine(symbol);
+        result = define != nullptr ? dimensions(define)
+                                   : std::make_pair(symbol->getRows(), symbol->getColumns());
+    } else if (auto* transpose = dynamic_cast<const Transpose*>(symbol)) {
+        const auto& inner = dimensions(transpose->getInner());
+        result = {inner.second, inner.first};
+    } else if (auto* slice = dynamic_cast<const Slice*>(symbol)) {
+        const auto& inner = dimensions(slice->getInner());
+        const int lastRow = slice->getLastRow() == Slice::END ? inner.first : slice->getLastRow();
+        const int lastCol = slice->getLastColumn() == Slice::END ? inner.second : slice->getLastColumn();
+        result = {lastRow - slice->getFirstRow(), lastCol - slice->getFirstColumn()};
+    } else if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        for (int i = 0; i < sum->getTerms(); i++) {
+            if (!isScalar(sum->get(i))) {
+                result = dimensions(sum->get(i));
+                break;
+            }
+        }
+    } else if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        for (int i = 0; i < product->getFactors(); i++) {
+            const auto& factor = dimensions(product->get(i));
+            if (result.first == 1 && result.second == 1) {
+                result = factor;
+            } else if (factor.first == 1 && factor.second == 1) {
+                // Scalars does not change the dimensions
+            } else if (result.second == factor.first) {
+                result.second = factor.second;
+            } else throw InvalidExpression(); // Dimensions does not match.
+        }
+    } else if (auto* function = dynamic_cast<const Function*>(symbol)) {
+        std::vector<std::pair<int, int>> arguments;
+        for (int i = 0; i < function->getArguments(); i++) {
+            arguments.push_back(dimensions(function->get(i)));
+        }
+        result = Function::dimensions(function->getName(), arguments);
+    } else {
+        result = {symbol->getRows(), symbol->getColumns()};
+    }
+
+    return mDimensions.emplace(symbol, result).first->second;
+}
+
+bool LazyEvaluator::isScalar(const Symbol* symbol) {
+    const auto& size = dimensions(symbol);
+    return size.first == 1 && size.second == 1;
+}
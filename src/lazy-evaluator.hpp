@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+class Symbol;
+class Product;
+class Optimizer;
+
+/**
+ * Computes single elements of defines that have been parsed but not yet
+ * substituted, so that only the dot products needed for those elements are
+ * computed through a chain of matrices. Intermediate results are remembered
+ * for as long as the evaluator lives, so asking for a whole row only
+ * multiplies the chain up to the last factor once.
+ */
+class LazyEvaluator {
+public:
+    explicit LazyEvaluator(const std::map<std::string, Symbol*>& defines,
+                           Optimizer& optimizer);
+
+    ~LazyEvaluator();
+
+    /**
+     * Returns a new symbol with the element at the given row and column of
+     * the symbol. Scalars only have the element at (0, 0).
+     */
+    Symbol* element(const Symbol* symbol, int row, int col);
+
+    /**
+     * Returns a new symbol with every define substituted and optimized.
+     */
+    Symbol* evaluate(const Symbol* symbol);
+
+    /**
+     * If set, products are multiplied a column at a time from the right
+     * instead of a row at a time from the left, which is cheaper when many
+     * rows of the same column are needed.
+     */
+    void setColumnMajor(bool columnMajor);
+
+    int getRows(const Symbol* symbol);
+
+    int getColumns(const Symbol* symbol);
+
+private:
+    typedef std::tuple<const Symbol*, int, int> Key;
+
+    Symbol* compute(const Symbol* symbol, int row, int col);
+
+    Symbol* productElement(const Product* product, int row, int col);
+
+    /**
+     * The given row of the product of all but the last of the matrices.
+     */
+    const std::vector<Symbol*>& productRow(const Product* product,
+                                           const std::vector<const Symbol*>& matrices,
+                                           int row);
+
+    /**
+     * The given column of the product of all but the first of the matrices.
+     */
+    const std::vector<Symbol*>& productColumn(const Product* product,
+                                              const std::vector<const Symbol*>& matrices,
+                                              int col);
+
+    Symbol* dot(const std::vector<Symbol*>& row, const Symbol* matrix, int col);
+
+    Symbol* dot(const Symbol* matrix, int row, const std::vector<Symbol*>& col);
+
+    /**
+     * The symbol with every define substituted and optimized.
+     */
+    const Symbol* value(const Symbol* symbol);
+
+    /**
+     * Replaces the names of defines with their substituted values, the same
+     * way as the parser does before optimizing.
+     */
+    Symbol* substitute(Symbol* symbol);
+
+    const Symbol* substituted(const Symbol* define);
+
+    const Symbol* findDefine(const Symbol* symbol) const;
+
+    const std::pair<int, int>& dimensions(const Symbol* symbol);
+
+    bool isScalar(const Symbol* symbol);
+
+    const std::map<std::string, Symbol*>& mDefines;
+    Optimizer& mOptimizer;
+    std::map<Key, Symbol*> mElements;
+    std::map<std::pair<const Symbol*, int>, std::vector<Symbol*>> mRows;
+    std::map<std::pair<const Symbol*, int>, std::vector<Symbol*>> mColumns;
+    bool mColumnMajor;
+    std::map<const Symbol*, Symbol*> mValues;
+    std::map<const Symbol*, Symbol*> mSubstituted;
+    std::map<const Symbol*, std::pair<int, int>> mDimensions;
+};
@@ -12,23 +12,60 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <unistd.h>
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <vector>
 #include "parser.hpp"
 #include "symbol.hpp"
 #include "default-formatter.hpp"
+#include "governor.hpp"
+#include "resource-limit-exceeded.hpp"
+#include "result-cache.hpp"
+#include "snapshot.hpp"
+#include "sparse-matrix.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 const char* executableName;
 
+enum LongOnlyOption {
+    OPTION_LOAD_SNAPSHOT = 256,
+    OPTION_SAVE_SNAPSHOT,
+    OPTION_TIME_BUDGET,
+    OPTION_STATS,
+    OPTION_TRACE,
+    OPTION_MAX_NODES,
+    OPTION_MAX_TERMS,
+    OPTION_TIME_LIMIT,
+    OPTION_MATRIX,
+    OPTION_TOLERANCE,
+    OPTION_UPPERCASE_MATRICES
+};
+
 void printHelp(FILE* stream, int exitCode) {
     fprintf(stream, "Usage: %s options [ equation ... ]\n", executableName);
     fprintf(stream,
         " -h --help Display this usage information.\n"
         " -s --src filename to read input from.\n"
         " -d --dest filename to write the results to.\n"
-        " -f --find name of the symbol to find the value of.\n"
+        " -f --find name of the symbol to find the value of, or name[row,col]\n"
+        "    for a single element. Use ':' as row or col for a whole column or row.\n"
         " -p --pretty add spaces and new-lines to make output more pretty.\n"
+        " -c --cache directory to cache optimized results in between runs.\n"
+        " -O level of optimization, -O0, -O1 or -O2 (default).\n"
+        "    --budget seconds to spend on expensive optimizations.\n"
+        "    --load-snapshot file to load optimized defines from.\n"
+        "    --save-snapshot file to save all optimized defines to.\n"
+        "    --stats[=json] print timings and symbol counts to stderr.\n"
+        "    --trace file to write a Chrome trace-event timeline to.\n"
+        "    --max-nodes count of symbols that may be alive at once.\n"
+        "    --max-terms count of terms that a single sum may have.\n"
+        "    --time-limit seconds the whole run may take.\n"
+        "    --matrix name=filename of a binary sparse matrix to define as name.\n"
+        "    --tolerance residual at which iterative solvers stop (default 1e-10).\n"
+        "    --uppercase-matrices treat undefined uppercase names, like X, as matrices.\n"
         " -v --verbose Print verbose debug information.\n"
     );
     exit(exitCode);
@@ -37,7 +74,7 @@ void printHelp(FILE* stream, int exitCode) {
 int main(int argc, char* argv[]) {
     int nextOption;
 
-    const char* const shortOptions = "hsdf:v";
+    const char* const shortOptions = "hs:d:f:c:O:pv";
     const struct option longOptions[] = {
         {"help", 0, nullptr, 'h'},
         {"src",  1, nullptr, 's'},
@@ -45,14 +82,36 @@ int main(int argc, char* argv[]) {
         {"find", 1, nullptr, 'f'},
         {"verbose", 0, nullptr, 'v'},
         {"pretty", 0, nullptr, 'p'},
+        {"cache", 1, nullptr, 'c'},
+        {"load-snapshot", 1, nullptr, OPTION_LOAD_SNAPSHOT},
+        {"save-snapshot", 1, nullptr, OPTION_SAVE_SNAPSHOT},
+        {"budget", 1, nullptr, OPTION_TIME_BUDGET},
+        {"stats", 2, nullptr, OPTION_STATS},
+        {"trace", 1, nullptr, OPTION_TRACE},
+        {"max-nodes", 1, nullptr, OPTION_MAX_NODES},
+        {"max-terms", 1, nullptr, OPTION_MAX_TERMS},
+        {"time-limit", 1, nullptr, OPTION_TIME_LIMIT},
+        {"matrix", 1, nullptr, OPTION_MATRIX},
+        {"tolerance", 1, nullptr, OPTION_TOLERANCE},
+        {"uppercase-matrices", 0, nullptr, OPTION_UPPERCASE_MATRICES},
         {nullptr, 0, nullptr, 0}
     };
 
     const char* srcFilename = nullptr;
     const char* destFilename = nullptr;
     const char* findSymbolName = nullptr;
+    const char* cacheDirectory = nullptr;
+    const char* loadSnapshotFilename = nullptr;
+    const char* saveSnapshotFilename = nullptr;
+    int optimizationLevel = Optimizer::DEFAULT_LEVEL;
+    double timeBudget = 0.0;
+    bool stats = false;
+    bool statsAsJson = false;
+    const char* traceFilename = nullptr;
     bool verbose = false;
     bool pretty = false;
+    bool uppercaseMatrices = false;
+    std::vector<std::string> matrixFiles;
 
     executableName = argv[0];
     do {
@@ -76,6 +135,50 @@ int main(int argc, char* argv[]) {
             case 'p':
                 pretty = true;
                 break;
+            case 'c':
+                cacheDirectory = optarg;
+                break;
+            case OPTION_LOAD_SNAPSHOT:
+                loadSnapshotFilename = optarg;
+                break;
+            case OPTION_SAVE_SNAPSHOT:
+                saveSnapshotFilename = optarg;
+                break;
+            case 'O':
+                if (optarg[0] < '0' || optarg[0] > '2' || optarg[1] != '\0') {
+                    fprintf(stderr, "Unknown optimization level '%s'.\n", optarg);
+                    printHelp(stderr, 1);
+                }
+                optimizationLevel = optarg[0] - '0';
+                break;
+            case OPTION_TIME_BUDGET:
+                timeBudget = atof(optarg);
+                break;
+            case OPTION_TRACE:
+                traceFilename = optarg;
+                break;
+            case OPTION_MAX_NODES:
+                Governor::setMaxLiveNodes(atol(optarg));
+                break;
+            case OPTION_MAX_TERMS:
+                Governor::setMaxTerms(atol(optarg));
+                break;
+            case OPTION_TIME_LIMIT:
+                Governor::setTimeLimit(atof(optarg));
+                break;
+            case OPTION_MATRIX:
+                matrixFiles.emplace_back(optarg);
+                break;
+            case OPTION_TOLERANCE:
+                Sparse::setTolerance(atof(optarg));
+                break;
+            case OPTION_UPPERCASE_MATRICES:
+                uppercaseMatrices = true;
+                break;
+            case OPTION_STATS:
+                stats = true;
+                statsAsJson = optarg != nullptr && std::string(optarg) == "json";
+                break;
             case '?':
                 printHelp(stderr, 1);
             case -1:
@@ -85,6 +188,16 @@ int main(int argc, char* argv[]) {
         }
     } while (nextOption != -1);
 
+    if (stats) Stats::enable();
+    if (traceFilename != nullptr) {
+        try {
+            Trace::open(traceFilename);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     if (verbose) {
         for (int i = 0; i < argc; i++) {
             printf("Argument %d: %s\n", i, argv[i]);
@@ -94,27 +207,117 @@ int main(int argc, char* argv[]) {
     std::stringstream buffer {};
     Formatter* formatter {new DefaultFormatter{pretty}};
     Parser parser {};
+    parser.getOptimizer().setLevel(optimizationLevel);
+    parser.setUppercaseMatrices(uppercaseMatrices);
+    parser.getOptimizer().setTimeBudget(timeBudget);
+    parser.getOptimizer().setTiming(verbose);
+
+    // Only what is needed for the answer is computed, unless every define
+    // is saved to a snapshot.
+    parser.setLazy(findSymbolName != nullptr && saveSnapshotFilename == nullptr);
+
+    ResultCache* cache = nullptr;
+    if (cacheDirectory != nullptr) {
+        cache = new ResultCache{cacheDirectory};
+        parser.setCache(cache);
+    }
 
-    if (srcFilename == nullptr) {
-        int lines = 0;
-        std::string line;
-        while (std::getline(std::cin, line))
-        {
-            buffer << line << std::endl;
-            lines++;
+    if (loadSnapshotFilename != nullptr) {
+        try {
+            Snapshot::load(parser, loadSnapshotFilename);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            Trace::close();
+            return 1;
         }
 
         if (verbose) {
-            std::cout << lines << " lines read from input stream." << std::endl;
+            std::cout << parser.getDefines().size() <<
+                " defines loaded from snapshot." << std::endl;
         }
-    } else {
-        std::ifstream t(srcFilename);
-        std::string str((std::istreambuf_iterator<char>(t)),
-                        std::istreambuf_iterator<char>());
-        buffer << str;
     }
 
-    parser.parse(buffer);
+    for (auto& argument : matrixFiles) {
+        const auto separator = argument.find('=');
+        if (separator == std::string::npos) {
+            std::cerr << executableName << ": Expected name=filename after --matrix." << std::endl;
+            Trace::close();
+            return 1;
+        }
+
+        try {
+            Sparse values = Sparse::load(argument.substr(separator + 1));
+            parser.define(argument.substr(0, separator), new SparseMatrix(std::move(values)));
+        } catch (const std::invalid_argument& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            Trace::close();
+            return 1;
+        }
+    }
+
+    {
+        Stats::Phase phase {"reading"};
+
+        // When a snapshot is loaded, additional input is only read if something
+        // is actually piped to the program.
+        if (srcFilename == nullptr
+        && (loadSnapshotFilename == nullptr || !isatty(STDIN_FILENO))) {
+            int lines = 0;
+            std::string line;
+            while (std::getline(std::cin, line))
+            {
+                buffer << line << std::endl;
+                lines++;
+            }
+
+            if (verbose) {
+                std::cout << lines << " lines read from input stream." << std::endl;
+            }
+        } else if (srcFilename != nullptr) {
+            std::ifstream t(srcFilename);
+            std::string str((std::istreambuf_iterator<char>(t)),
+                            std::istreambuf_iterator<char>());
+            buffer << str;
+        }
+    }
+
+    try {
+        parser.parse(buffer);
+    } catch (const ResourceLimitExceeded& e) {
+        std::cerr << executableName << ": " << e.what() << std::endl;
+        if (stats) Stats::report(std::cerr, statsAsJson);
+        Trace::close();
+        return 2;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << executableName << ": " << e.what() << std::endl;
+        Trace::close();
+        return 1;
+    }
+
+    if (saveSnapshotFilename != nullptr) {
+        try {
+            Snapshot::save(parser, saveSnapshotFilename);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            Trace::close();
+            return 1;
+        }
+    }
+
+    if (verbose) {
+        parser.getOptimizer().report(std::cout);
+
+        const int hits = parser.getOptimizer().getMemoHits();
+        const int lookups = hits + parser.getOptimizer().getMemoMisses();
+        std::cout << hits << " of " << lookups << " subexpressions reused by the optimizer";
+        if (lookups > 0) std::cout << " (" << (100 * hits / lookups) << "% hit rate)";
+        std::cout << "." << std::endl;
+    }
+
+    if (verbose && cache != nullptr) {
+        std::cout << cache->getHits() << " cache hits, " <<
+                  cache->getMisses() << " cache misses." << std::endl;
+    }
 
     if (verbose) {
         std::cout << "--- Input Begin ---" <<
@@ -122,9 +325,32 @@ int main(int argc, char* argv[]) {
                   "--- Input End ---" << std::endl;
     }
 
-    std::string result = findSymbolName == nullptr
-        ? parser.format(*formatter)
-        : parser.get(findSymbolName)->format(*formatter);
+    Symbol* found = nullptr;
+    if (findSymbolName != nullptr) {
+        try {
+            found = parser.find(findSymbolName);
+        } catch (const ResourceLimitExceeded& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            if (stats) Stats::report(std::cerr, statsAsJson);
+            Trace::close();
+            return 2;
+        } catch (const std::invalid_argument& e) {
+            std::cerr << executableName << ": " << e.what() << std::endl;
+            Trace::close();
+            return 1;
+        }
+    }
+
+    std::string result;
+    {
+        Stats::Phase phase {"formatting"};
+        Trace::Span span {"format"};
+        result = found == nullptr
+            ? parser.format(*formatter)
+            : found->format(*formatter);
+        delete found;
+    }
+
     if (destFilename == nullptr) {
         std::cout << result;
     } else {
@@ -133,10 +359,19 @@ int main(int argc, char* argv[]) {
         out.close();
     }
 
+    if (stats) Stats::report(std::cerr, statsAsJson);
+
+    int status = 0;
+    if (!Trace::close()) {
+        std::cerr << executableName << ": Could not write trace '" << traceFilename << "'." << std::endl;
+        status = 1;
+    }
+
     if (verbose) std::cout << "Finished!" << std::endl;
 
+    delete cache;
     delete formatter;
-    return 0;
+    return status;
 //
 //
 //
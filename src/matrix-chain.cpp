@@ -0,0 +1,166 @@
+#include "matrix-chain.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <limits>
+#include "symbol.hpp"
+#include "matrix.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+Symbol* MatrixChain::multiply(std::vector<Symbol*>& factors) {
+    if (factors.empty()) return nullptr;
+    if (factors.size() <= 2) {
+        Symbol* result = factors[0];
+        if (factors.size() == 2) result = *result * factors[1];
+        return result;
+    }
+
+    // Factors of an unknown size can not be planned for, so they are kept
+    // in the order they were written
+    for (auto* factor : factors) {
+        if (factor->getRows() == Symbol::UNKNOWN || factor->getColumns() == Symbol::UNKNOWN) {
+            Symbol* result = factors[0];
+            for (std::vector<Symbol*>::size_type i = 1; i < factors.size(); i++) {
+                result = *result * factors[i];
+            }
+            return result;
+        }
+    }
+
+    Trace::Span span {"matrix-chain"};
+    span.arg("factors", (long) factors.size());
+
+    const Plan chosen = plan(factors);
+    return multiply(factors, chosen, 0, chosen.count - 1);
+}
+
+std::string MatrixChain::describe(const std::vector<Symbol*>& factors) {
+    if (factors.empty()) return "";
+    const Plan chosen = plan(factors);
+    return describe(chosen, 0, chosen.count - 1);
+}
+
+double MatrixChain::estimateCost(const std::vector<Symbol*>& factors) {
+    if (factors.empty()) return 0.0;
+    const Plan chosen = plan(factors);
+    return chosen.cost[chosen.count - 1];
+}
+
+MatrixChain::Estimate MatrixChain::estimate(const Symbol* factor) {
+    Estimate result {factor->getRows(), factor->getColumns(), {}, {}};
+    const int size = result.rows * result.cols;
+
+    if (auto* matrix = dynamic_cast<const Matrix*>(factor)) {
+        result.nodes.reserve(size);
+        result.constant.reserve(size);
+        for (int i = 0; i < result.rows; i++) {
+            for (int j = 0; j < result.cols; j++) {
+                const Symbol* element = matrix->get(i, j);
+                result.nodes.push_back(element->isZero() ? 0.0 : Stats::countNodes(element));
+                result.constant.push_back(element->isConstant());
+            }
+        }
+    } else {
+        // Not multiplied out yet, so assume it is dense
+        const double nodes = (double) Stats::countNodes(factor) / size;
+        result.nodes.assign(size, nodes < 1.0 ? 1.0 : nodes);
+        result.constant.assign(size, false);
+    }
+
+    return result;
+}
+
+MatrixChain::Estimate MatrixChain::product(const Estimate& left, const Estimate& right,
+                                           double& cost) {
+    Estimate result {left.rows, right.cols, {}, {}};
+    result.nodes.reserve(result.rows * result.cols);
+    result.constant.reserve(result.rows * result.cols);
+
+    for (int i = 0; i < left.rows; i++) {
+        for (int j = 0; j < right.cols; j++) {
+            double nodes = 0.0;
+            bool constant = true;
+
+            for (int k = 0; k < left.cols; k++) {
+                const int leftIdx = i * left.cols + k;
+                const int rightIdx = k * right.cols + j;
+                if (left.nodes[leftIdx] == 0.0 || right.nodes[rightIdx] == 0.0) continue;
+
+                if (left.constant[leftIdx] && right.constant[rightIdx]) {
+                    // Numbers are folded right away
+                    cost += 1.0;
+                    nodes += 1.0;
+                } else {
+                    // Both elements are copied and joined by a product node
+                    const double term = left.nodes[leftIdx] + right.nodes[rightIdx] + 1.0;
+                    cost += term;
+                    nodes += term;
+                    constant = false;
+                }
+            }
+
+            // A sum of numbers is just a number
+            if (constant && nodes > 0.0) nodes = 1.0;
+            result.nodes.push_back(nodes);
+            result.constant.push_back(constant);
+        }
+    }
+
+    return result;
+}
+
+MatrixChain::Plan MatrixChain::plan(const std::vector<Symbol*>& factors) {
+    const int n = (int) factors.size();
+    Plan result {n, std::vector<double>(n * n, 0.0), std::vector<int>(n * n, 0)};
+
+    // The estimated result of the cheapest way to compute every sub-chain
+    std::vector<Estimate> estimates(n * n);
+    for (int i = 0; i < n; i++) {
+        estimates[i * n + i] = estimate(factors[i]);
+    }
+
+    for (int length = 2; length <= n; length++) {
+        for (int first = 0; first + length - 1 < n; first++) {
+            const int last = first + length - 1;
+            double best = std::numeric_limits<double>::infinity();
+
+            for (int split = first; split < last; split++) {
+                double cost = result.cost[first * n + split]
+                            + result.cost[(split + 1) * n + last];
+                if (cost >= best) continue;
+
+                Estimate estimate = product(
+                    estimates[first * n + split],
+                    estimates[(split + 1) * n + last], cost);
+
+                if (cost < best) {
+                    best = cost;
+                    result.split[first * n + last] = split;
+                    estimates[first * n + last] = std::move(estimate);
+                }
+            }
+
+            result.cost[first * n + last] = best;
+        }
+    }
+
+    return result;
+}
+
+Symbol* MatrixChain::multiply(std::vector<Symbol*>& factors, const Plan& plan,
+                              int first, int last) {
+    if (first == last) return factors[first];
+    const int split = plan.split[first * plan.count + last];
+    Symbol* left = multiply(factors, plan, first, split);
+    Symbol* right = multiply(factors, plan, split + 1, last);
+    return *left * right;
+}
+
+std::string MatrixChain::describe(const Plan& plan, int first, int last) {
+    if (first == last) return std::to_string(first);
+    const int split = plan.split[first * plan.count + last];
+    return "(" + describe(plan, first, split) + "*" + describe(plan, split + 1, last) + ")";
+}
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Symbol;
+
+/**
+ * Multiplies a chain of matrices in the order that is estimated to be the
+ * cheapest, using the classic dynamic-programming matrix-chain algorithm.
+ *
+ * The cost model does not only look at the dimensions. It follows which
+ * elements are structurally zero and how many nodes every element has
+ * through each candidate product, since multiplying large symbolic elements
+ * costs much more than multiplying numbers, and zeros cost nothing.
+ */
+class MatrixChain {
+public:
+    /**
+     * Multiplies the factors, which must all be matrix-valued with matching
+     * dimensions. Takes ownership of the factors.
+     */
+    static Symbol* multiply(std::vector<Symbol*>& factors);
+
+    /**
+     * Describes the chosen order, like "((0*1)*2)" where the numbers are the
+     * indices of the factors.
+     */
+    static std::string describe(const std::vector<Symbol*>& factors);
+
+    /**
+     * The estimated cost of multiplying the factors in the chosen order.
+     */
+    static double estimateCost(const std::vector<Symbol*>& factors);
+
+private:
+    struct Estimate {
+        int rows, cols;
+
+        // Expected number of nodes of every element, with 0 for elements
+        // that are structurally zero.
+        std::vector<double> nodes;
+        std::vector<bool> constant;
+    };
+
+    struct Plan {
+        int count;
+        std::vector<double> cost;
+        std::vector<int> split;
+    };
+
+    static Estimate estimate(const Symbol* factor);
+
+    static Estimate product(const Estimate& left, const Estimate& right, double& cost);
+
+    static Plan plan(const std::vector<Symbol*>& factors);
+
+    static Symbol* multiply(std::vector<Symbol*>& factors, const Plan& plan, int first, int last);
+
+    static std::string describe(const Plan& plan, int first, int last);
+};
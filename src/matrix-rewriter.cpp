@@ -0,0 +1,242 @@
+#include "matrix-rewriter.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include "serializer.hpp"
+#include "constant.hpp"
+#include "matrix.hpp"
+#include "sparse-matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "transpose.hpp"
+#include "function.hpp"
+#include "governor.hpp"
+
+namespace {
+    // The operand of inv(), or nullptr if the symbol is something else
+    const Symbol* inverted(const Symbol* symbol) {
+        auto* function = dynamic_cast<const Function*>(symbol);
+        if (function == nullptr || function->getName() != "inv") return nullptr;
+        return function->get(0);
+    }
+
+    bool isSame(const Symbol* a, const Symbol* b) {
+        std::string first, second;
+        Serializer::encode(first, a);
+        Serializer::encode(second, b);
+        return first == second;
+    }
+
+    bool isIdentity(const Symbol* symbol) {
+        auto* matrix = dynamic_cast<const Matrix*>(symbol);
+        return matrix != nullptr && matrix->getStructure() == Matrix::IDENTITY;
+    }
+}
+
+Symbol* MatrixRewriter::rewrite(Symbol* input) {
+    static const Rule rules[] = {
+        transposeOfTranspose, transposeOfProduct, inverseFactors,
+        identityFactors, zeroFactor, cancelTerms
+    };
+
+    // The elements of matrices are scalars that none of the rules are for
+    if (dynamic_cast<Matrix*>(input) || dynamic_cast<SparseMatrix*>(input)) {
+        return input;
+    }
+
+    input = input->replace(
+        [](const Symbol*) -> bool { return true; },
+        [](Symbol* child) -> Symbol* { return rewrite(child); });
+
+    // The result of a rule can have new nodes that other rules apply to,
+    // like the transposed factors of a product
+    for (Rule rule : rules) {
+        if (Symbol* result = rule(input)) {
+            Governor::check();
+            return rewrite(result);
+        }
+    }
+
+    return input;
+}
+
+Symbol* MatrixRewriter::transposeOfTranspose(Symbol* input) {
+    auto* transpose = dynamic_cast<Transpose*>(input);
+    if (transpose == nullptr || !dynamic_cast<const Transpose*>(transpose->getInner())) {
+        return nullptr;
+    }
+
+    Symbol* result = static_cast<const Transpose*>(transpose->getInner())->getInner()->copy();
+    delete input;
+    return result;
+}
+
+Symbol* MatrixRewriter::transposeOfProduct(Symbol* input) {
+    auto* transpose = dynamic_cast<Transpose*>(input);
+    if (transpose == nullptr) return nullptr;
+
+    auto* product = dynamic_cast<const Product*>(transpose->getInner());
+    if (product == nullptr) return nullptr;
+
+    // Scalars are their own transposes
+    std::vector<Symbol*> factors;
+    for (int i = product->getFactors() - 1; i >= 0; i--) {
+        Symbol* factor = product->get(i)->copy();
+        factors.push_back(factor->isScalar() ? factor : Transpose::of(factor));
+    }
+
+    delete input;
+    return productOf(factors);
+}
+
+Symbol* MatrixRewriter::inverseFactors(Symbol* input) {
+    auto* product = dynamic_cast<Product*>(input);
+    if (product == nullptr) return nullptr;
+
+    for (int i = 0; i + 1 < product->getFactors(); i++) {
+        const Symbol* left = product->get(i);
+        const Symbol* right = product->get(i + 1);
+        const Symbol* operand = inverted(left) ? inverted(left) : inverted(right);
+        const Symbol* other = inverted(left) ? right : left;
+        if (operand == nullptr || !isSame(operand, other)) continue;
+
+        // The identity needs a size, unless there is something else to
+        // multiply with
+        bool alone = true;
+        for (int j = 0; j < product->getFactors(); j++) {
+            if (j != i && j != i + 1 && !product->get(j)->isScalar()) alone = false;
+        }
+        const int size = other->getRows();
+        if (size == Symbol::UNKNOWN && alone) continue;
+
+        std::vector<Symbol*> factors;
+        for (int j = 0; j < product->getFactors(); j++) {
+            if (j == i && size != Symbol::UNKNOWN) factors.push_back(Matrix::eye(size));
+            if (j != i && j != i + 1) factors.push_back(product->get(j)->copy());
+        }
+
+        delete input;
+        return productOf(factors);
+    }
+
+    return nullptr;
+}
+
+Symbol* MatrixRewriter::identityFactors(Symbol* input) {
+    auto* product = dynamic_cast<Product*>(input);
+    if (product == nullptr) return nullptr;
+
+    // An identity is only dropped if there is another matrix to keep
+    bool found = false, other = false;
+    for (int i = 0; i < product->getFactors(); i++) {
+        if (isIdentity(product->get(i))) found = true;
+        else if (!product->get(i)->isScalar()) other = true;
+    }
+    if (!found || !other) return nullptr;
+
+    std::vector<Symbol*> factors;
+    for (int i = 0; i < product->getFactors(); i++) {
+        if (!isIdentity(product->get(i))) factors.push_back(product->get(i)->copy());
+    }
+
+    delete input;
+    return productOf(factors);
+}
+
+Symbol* MatrixRewriter::zeroFactor(Symbol* input) {
+    auto* product = dynamic_cast<Product*>(input);
+    if (product == nullptr) return nullptr;
+
+    for (int i = 0; i < product->getFactors(); i++) {
+        auto* matrix = dynamic_cast<const Matrix*>(product->get(i));
+        if (matrix == nullptr || !matrix->isZero()) continue;
+
+        if (input->getRows() == Symbol::UNKNOWN || input->getColumns() == Symbol::UNKNOWN) {
+            return nullptr;
+        }
+
+        Symbol* result = zeroOf(input);
+        delete input;
+        return result;
+    }
+
+    return nullptr;
+}
+
+Symbol* MatrixRewriter::cancelTerms(Symbol* input) {
+    auto* sum = dynamic_cast<Sum*>(input);
+    if (sum == nullptr) return nullptr;
+
+    // Terms are told apart by everything but their numeric factors, which
+    // are added up. Sums of scalars are left to the optimizer.
+    std::vector<std::string> keys;
+    std::map<std::string, float> coefficients;
+    for (int i = 0; i < sum->getTerms(); i++) {
+        const Symbol* term = sum->get(i);
+        std::string key;
+        float coefficient = 1.0f;
+        if (term->isScalar()) {
+            // Never cancelled
+        } else if (auto* product = dynamic_cast<const Product*>(term)) {
+            for (int j = 0; j < product->getFactors(); j++) {
+                auto* constant = dynamic_cast<const Constant*>(product->get(j));
+                if (constant != nullptr) coefficient *= constant->getValue();
+                else Serializer::encode(key, product->get(j));
+            }
+        } else {
+            Serializer::encode(key, term);
+        }
+        if (!key.empty()) coefficients[key] += coefficient;
+        keys.push_back(std::move(key));
+    }
+
+    std::vector<Symbol*> terms;
+    for (int i = 0; i < sum->getTerms(); i++) {
+        if (keys[i].empty() || fabsf(coefficients[keys[i]]) >= FLT_EPSILON) {
+            terms.push_back(sum->get(i)->copy());
+        }
+    }
+    if ((int) terms.size() == sum->getTerms()) {
+        for (auto* term : terms) delete term;
+        return nullptr;
+    }
+
+    Symbol* result;
+    if (terms.empty()) {
+        result = zeroOf(input);
+    } else if (terms.size() == 1) {
+        result = terms[0];
+    } else {
+        auto* remaining = new Sum(terms[0], terms[1]);
+        for (std::vector<Symbol*>::size_type i = 2; i < terms.size(); i++) {
+            remaining->setTerm((int) i, terms[i]);
+        }
+        result = remaining;
+    }
+
+    delete input;
+    return result;
+}
+
+Symbol* MatrixRewriter::productOf(std::vector<Symbol*>& factors) {
+    if (factors.size() == 1) return factors[0];
+
+    auto* product = new Product(factors[0], factors[1]);
+    for (std::vector<Symbol*>::size_type i = 2; i < factors.size(); i++) {
+        product->setFactor((int) i, factors[i]);
+    }
+    return product;
+}
+
+Symbol* MatrixRewriter::zeroOf(const Symbol* symbol) {
+    const int rows = symbol->getRows(), cols = symbol->getColumns();
+    if (rows == Symbol::UNKNOWN || cols == Symbol::UNKNOWN || (rows == 1 && cols == 1)) {
+        return new Constant{0.0f};
+    }
+    return Matrix::zero(rows, cols);
+}
@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Symbol;
+
+/**
+ * Simplifies whole-matrix expressions before they are multiplied out into
+ * elements, by applying algebraic rules until none of them applies:
+ *
+ *   (A')'      = A
+ *   (A*B)'     = B'*A'
+ *   A*inv(A)   = inv(A)*A = I
+ *   A*I        = I*A = A
+ *   A*0        = 0*A = 0, if the size of the product is known
+ *   A - A      = 0, and other terms that cancel out
+ *
+ * It runs on the defines as they were parsed, where the names of matrices
+ * are still names, so every rule that applies saves the element work of
+ * the expression that it removes.
+ */
+class MatrixRewriter {
+public:
+    /**
+     * Rewrites the symbol and everything in it, consuming it.
+     */
+    static Symbol* rewrite(Symbol* input);
+
+private:
+    /**
+     * A rule returns a replacement for the input, which it then consumes,
+     * or nullptr if it does not apply.
+     */
+    typedef Symbol* (*Rule)(Symbol* input);
+
+    static Symbol* transposeOfTranspose(Symbol* input);
+
+    static Symbol* transposeOfProduct(Symbol* input);
+
+    static Symbol* inverseFactors(Symbol* input);
+
+    static Symbol* identityFactors(Symbol* input);
+
+    static Symbol* zeroFactor(Symbol* input);
+
+    static Symbol* cancelTerms(Symbol* input);
+
+    /**
+     * Returns a product of the factors, or the factor if there is only one.
+     */
+    static Symbol* productOf(std::vector<Symbol*>& factors);
+
+    static Symbol* zeroOf(const Symbol* symbol);
+};
@@ -0,0 +1,135 @@
+#include "matrix-symbol.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include "constant.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+MatrixSymbol::MatrixSymbol(std::string name, int rows, int cols) :
+    Symbol{}, mName{std::move(name)}, mRows{rows}, mCols{cols}, mExponent{1.0f} {}
+
+MatrixSymbol::~MatrixSymbol() = default;
+
+const std::string &MatrixSymbol::getName() const {
+    return mName;
+}
+
+void MatrixSymbol::setExponent(Symbol::value_t exponent) {
+    mExponent = exponent;
+}
+
+Symbol::value_t MatrixSymbol::getExponent() const {
+    return mExponent;
+}
+
+Symbol *MatrixSymbol::copy() const {
+    Stats::symbolCopied();
+    auto* copy = new MatrixSymbol{mName, mRows, mCols};
+    copy->mExponent = mExponent;
+    return copy;
+}
+
+Symbol *MatrixSymbol::negate() {
+    return new Product(new Constant{-1.0f}, this);
+}
+
+Symbol *MatrixSymbol::operator+(Symbol *other) {
+    assertSameDimensions(other);
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *MatrixSymbol::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *MatrixSymbol::operator*(Symbol *other) {
+    // A*A = A^2, as long as they are next to each other
+    auto* otherSymbol = dynamic_cast<MatrixSymbol*>(other);
+    if (otherSymbol != nullptr && otherSymbol->mName == mName) {
+        mExponent += otherSymbol->mExponent;
+        delete other;
+        return this;
+    }
+
+    if (!other->isScalar() && !isSameSize(mCols, other->getRows())) {
+        throw dimensionMismatch("multiply", other);
+    }
+
+    // The order is kept since both may be matrices
+    return new Product(this, other);
+}
+
+Symbol *MatrixSymbol::operator/(Symbol *other) {
+    auto* constant = dynamic_cast<Constant*>(other);
+    if (constant == nullptr || constant->isZero()) {
+        throw std::invalid_argument("The matrix " + mName + " can only be divided by a number other than zero.");
+    }
+
+    const value_t inverse = 1.0f / constant->getValue();
+    delete other;
+    return new Product(this, new Constant{inverse});
+}
+
+Symbol *MatrixSymbol::pow(Symbol::value_t exponent) {
+    std::string message;
+    if (floorf(exponent) != exponent) {
+        message = "Can't raise " + mName + " to the power of " + std::to_string(exponent)
+            + ", only integer powers are supported.";
+    } else if (!isSameSize(mRows, mCols)) {
+        message = "Can't raise the non-square matrix " + mName + " to a power.";
+    }
+    if (!message.empty()) {
+        delete this;
+        throw std::invalid_argument(message);
+    }
+
+    // Negative powers are kept until the matrix is substituted, which
+    // inverts it
+    mExponent *= exponent;
+    return this;
+}
+
+Symbol *MatrixSymbol::replace(const std::function<bool(const Symbol *)> &,
+                              const std::function<Symbol *(Symbol *)> &) {
+    return this;
+}
+
+std::string MatrixSymbol::format(const Formatter &formatter) const {
+    if (fabsf(mExponent - 1.0f) < FLT_EPSILON) {
+        return formatter.unknown(mName);
+    }
+
+    Constant exponent {mExponent};
+    return formatter.power(formatter.unknown(mName), formatter.constant(&exponent));
+}
+
+bool MatrixSymbol::isConstant() const {
+    return false;
+}
+
+bool MatrixSymbol::isZero() const {
+    return false;
+}
+
+int MatrixSymbol::getColumns() const {
+    return mCols;
+}
+
+int MatrixSymbol::getRows() const {
+    return mRows;
+}
+
+std::set<std::string> MatrixSymbol::findUndefined() {
+    return {mName};
+}
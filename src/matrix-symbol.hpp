@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include "symbol.hpp"
+
+/**
+ * A name that stands for a whole matrix, like a define of a matrix or an
+ * undefined name that starts with an uppercase letter. Unlike variables,
+ * which are scalars, it keeps its place in products. The size is UNKNOWN
+ * for names that are not defined before they are used, and undefined names
+ * stay opaque all the way to the output.
+ */
+class MatrixSymbol : public Symbol {
+public:
+    explicit MatrixSymbol(std::string name, int rows = UNKNOWN, int cols = UNKNOWN);
+
+    ~MatrixSymbol() override;
+
+    const std::string& getName() const;
+
+    void setExponent(value_t exponent);
+
+    value_t getExponent() const;
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    /**
+     * Powers are kept on the name, so that they are still computed with
+     * repeated squaring once the name is substituted.
+     */
+    Symbol* pow(value_t exponent) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    const std::string mName;
+    int mRows, mCols;
+    value_t mExponent;
+};
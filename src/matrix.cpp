@@ -1,103 +1,240 @@
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+#include <utility>
 #include "matrix.hpp"
 
 //
 // Copyright (c) 2020 Emil Forslund. All rights reserved.
 //
 
+#include "bareiss.hpp"
+#include "dense.hpp"
+#include "sparse.hpp"
+#include "serializer.hpp"
 #include "constant.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
 #include "invalid-expression.hpp"
-
-Matrix::Matrix(int rows, int cols) :
-    Symbol{}, mRows{rows}, mCols{cols}, mElements{} {
-    for (int i = 0; i < mRows; i++) {
-        for (int j = 0; j < mCols; j++) {
-            mElements.push_back(new Constant{0.0f});
+#include "governor.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+namespace {
+    /**
+     * True if both elements are known to have the same value. Numbers are
+     * compared directly and other symbols by their trees, one node at a
+     * time.
+     */
+    bool isSameElement(const Symbol* a, const Symbol* b) {
+        if (a == b) return true;
+
+        auto* left = dynamic_cast<const Constant*>(a);
+        auto* right = dynamic_cast<const Constant*>(b);
+        if (left != nullptr || right != nullptr) {
+            return left != nullptr && right != nullptr
+                && left->getValue() == right->getValue();
         }
+
+        return Serializer::isSame(a, b);
     }
 }
 
-Matrix::Matrix(const Matrix &prototype) :
-    Symbol{}, mRows{prototype.mRows}, mCols{prototype.mCols}, mElements{} {
-    for (int i = 0; i < mRows; i++) {
-        for (int j = 0; j < mCols; j++) {
-            int idx = i * mCols + j;
-            mElements.push_back(prototype.mElements[idx]->copy());
-        }
+Matrix::Storage::Storage(int size) :
+    size{size}, elements{inlined}, inlined{}, allocated{} {
+    if (size > INLINE_SIZE) {
+        allocated = std::make_unique<Symbol*[]>(size);
+        elements = allocated.get();
     }
 }
 
-Matrix::~Matrix() {
-    for (int i = 0; i < mRows; i++) {
-        for (int j = 0; j < mCols; j++) {
-            delete mElements[i * mCols + j];
-        }
+Matrix::Storage::~Storage() {
+    for (auto* element : *this) {
+        delete element;
+    }
+}
+
+Matrix::Matrix(int rows, int cols) :
+    Symbol{}, mRows{rows}, mCols{cols},
+    mStorage{std::make_shared<Storage>(rows * cols)},
+    mOffset{0}, mRowStride{cols}, mColStride{1}, mStructure{-1} {
+    for (auto& element : *mStorage) {
+        element = new Constant{0.0f};
     }
 }
 
+Matrix::Matrix(const Matrix &prototype) :
+    Symbol{}, mRows{prototype.mRows}, mCols{prototype.mCols},
+    mStorage{prototype.mStorage}, mOffset{prototype.mOffset},
+    mRowStride{prototype.mRowStride}, mColStride{prototype.mColStride},
+    mStructure{prototype.mStructure} {}
+
+Matrix::~Matrix() = default;
+
 Symbol *Matrix::copy() const {
+    Stats::symbolCopied();
     return new Matrix(*this);
 }
 
 Symbol *Matrix::get(int row, int col) const {
-    return mElements[row * mCols + col];
+    return mStorage->elements[mOffset + row * mRowStride + col * mColStride];
 }
 
-void Matrix::set(int row, int col, Symbol *element) {
-    delete mElements[row * mCols + col];
-    mElements[row * mCols + col] = element;
+Symbol *&Matrix::element(int row, int col) {
+    return mStorage->elements[mOffset + row * mRowStride + col * mColStride];
 }
 
-Symbol *Matrix::negate() {
+void Matrix::detach() {
+    if (mStorage.use_count() == 1 && mStorage->size == mRows * mCols) return;
+
+    auto storage = std::make_shared<Storage>(mRows * mCols);
     for (int i = 0; i < mRows; i++) {
         for (int j = 0; j < mCols; j++) {
-            int idx = i * mCols + j;
-            mElements[idx]->negate();
+            storage->elements[i * mCols + j] = get(i, j)->copy();
         }
     }
+
+    mStorage = std::move(storage);
+    mOffset = 0;
+    mRowStride = mCols;
+    mColStride = 1;
+}
+
+bool Matrix::isShared() const {
+    return mStorage.use_count() > 1;
+}
+
+void Matrix::set(int row, int col, Symbol *element) {
+    detach();
+    modified();
+    Symbol*& target = this->element(row, col);
+    delete target;
+    target = element;
+}
+
+Symbol *Matrix::negate() {
+    detach();
+    modified();
+    for (auto& element : *mStorage) {
+        element = element->negate();
+    }
     return this;
 }
 
 Matrix* Matrix::transpose() {
-    auto* transposed = new Matrix{mCols, mRows};
-    for (int i = 0; i < mRows; i++) {
-        for (int j = i; j < mCols; j++) {
-            const int idx = i * mCols + j;
-            transposed->set(j, i, mElements[idx]->copy());
+    std::swap(mRows, mCols);
+    std::swap(mRowStride, mColStride);
+
+    // The triangles trade places, and only a diagonal stays affine
+    if (mStructure >= 0) {
+        const unsigned structure = mStructure;
+        mStructure = (int) ((structure & (PERMUTATION | SYMMETRIC))
+                 | ((structure & UPPER) ? LOWER : 0u)
+                 | ((structure & LOWER) ? UPPER : 0u)
+                 | ((structure & DIAGONAL) == DIAGONAL ? (structure & AFFINE) : 0u));
+    }
+    return this;
+}
+
+Matrix* Matrix::slice(int row, int col, int rows, int cols) {
+    mOffset += row * mRowStride + col * mColStride;
+    if (row != 0 || col != 0 || rows != mRows || cols != mCols) modified();
+    mRows = rows;
+    mCols = cols;
+    return this;
+}
+
+unsigned Matrix::getStructure() const {
+    if (mStructure < 0) mStructure = (int) findStructure();
+    return (unsigned) mStructure;
+}
+
+unsigned Matrix::findStructure() const {
+    if (mRows != mCols) return GENERAL;
+
+    const int n = mRows;
+    unsigned structure = UPPER | LOWER | AFFINE | PERMUTATION;
+    std::vector<int> onesInColumn(n, 0);
+
+    for (int i = 0; i < n; i++) {
+        int onesInRow = 0;
+        for (int j = 0; j < n; j++) {
+            const Symbol* element = get(i, j);
+            if (element->isZero()) {
+                if (i == n - 1 && j == n - 1) structure &= ~AFFINE;
+                continue;
+            }
+
+            if (j < i) structure &= ~UPPER;
+            if (j > i) structure &= ~LOWER;
+            if (i == n - 1 && j < n - 1) structure &= ~AFFINE;
+
+            auto* constant = dynamic_cast<const Constant*>(element);
+            if (constant != nullptr && constant->isOne()) {
+                onesInRow++;
+                onesInColumn[j]++;
+            } else {
+                structure &= ~PERMUTATION;
+                if (i == n - 1 && j == n - 1) structure &= ~AFFINE;
+            }
+        }
+        if (onesInRow != 1) structure &= ~PERMUTATION;
+    }
+
+    for (int ones : onesInColumn) {
+        if (ones != 1) structure &= ~PERMUTATION;
+    }
+
+    // A diagonal is symmetric, while a triangle with anything outside the
+    // diagonal is not. Otherwise the comparison stops at the first mismatch.
+    if ((structure & DIAGONAL) == DIAGONAL) return structure | SYMMETRIC;
+    if (structure & DIAGONAL) return structure;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (!isSameElement(get(i, j), get(j, i))) return structure;
         }
     }
-    delete this;
-    return transposed;
+    return structure | SYMMETRIC;
+}
+
+void Matrix::modified() {
+    mStructure = -1;
 }
 
 Symbol *Matrix::operator+(Symbol *other) {
+    modified();
     if (other->isScalar()) {
-        for (int i = 0; i < mRows; i++) {
-            for (int j = 0; j < mCols; j++) {
-                int idx = i * mCols + j;
-                mElements[idx] = *mElements[idx] + other->copy();
-            }
-        }
-        delete other;
+        applyScalar(other, '+');
         return this;
     }
 
-    if (other->getRows() != mRows || other->getColumns() != mCols) {
-        throw InvalidExpression(); // Dimensions does not match
+    // Blocks are only kept while both sides are blocks
+    other = BlockMatrix::flatten(other);
+
+    if (!isSameSize(other->getRows(), mRows) || !isSameSize(other->getColumns(), mCols)) {
+        throw dimensionMismatch("add", other);
     }
 
     if (auto* otherMatrix = dynamic_cast<Matrix*>(other)) {
+        if (addSmall(otherMatrix)) {
+            delete other;
+            return this;
+        }
+
+        detach();
         for (int i = 0; i < mRows; i++) {
             for (int j = 0; j < mCols; j++) {
-                int idx = i * mCols + j;
-                mElements[idx] = *mElements[idx] + otherMatrix->mElements[idx]->copy();
+                Symbol*& target = element(i, j);
+                target = *target + otherMatrix->get(i, j)->copy();
             }
         }
         delete other;
         return this;
     }
 
-    throw InvalidExpression();
+    // Kept as it is until the other side becomes a matrix too
+    return new Sum(this, other);
 }
 
 Symbol *Matrix::operator-(Symbol *other) {
@@ -106,18 +243,15 @@ Symbol *Matrix::operator-(Symbol *other) {
 
 Symbol *Matrix::operator*(Symbol *other) {
     if (other->isScalar()) {
-        for (int i = 0; i < mRows; i++) {
-            for (int j = 0; j < mCols; j++) {
-                int idx = i * mCols + j;
-                mElements[idx] = *mElements[idx] * other->copy();
-            }
-        }
-        delete other;
+        modified();
+        applyScalar(other, '*');
         return this;
     }
 
-    if (other->getRows() != mCols) {
-        throw InvalidExpression(); // Dimensions does not match
+    other = BlockMatrix::flatten(other);
+
+    if (!isSameSize(other->getRows(), mCols)) {
+        throw dimensionMismatch("multiply", other);
     }
 
     if (auto* otherMatrix = dynamic_cast<Matrix*>(other)) {
@@ -130,44 +264,428 @@ Symbol *Matrix::operator*(Symbol *other) {
                 std::to_string(otherMatrix->mCols) + "] matrices.");
         }
 
-        auto* result = new Matrix(mRows, other->getColumns());
+        // A known identity is dropped without looking at any element
+        if (mStructure == (int) IDENTITY) {
+            delete this;
+            return other;
+        } else if (otherMatrix->mStructure == (int) IDENTITY) {
+            delete other;
+            return this;
+        }
+
+        const bool symmetric = isSymmetricProduct(otherMatrix);
+
+        // Structure is looked at first, so that small transforms that are
+        // permutations or scalings never reach the unrolled kernels
+        if (Matrix* result = multiplyStructured(otherMatrix)) {
+            delete this;
+            delete other;
+            return result;
+        }
+
+        if (Matrix* result = multiplySmall(otherMatrix, symmetric)) {
+            delete this;
+            delete other;
+            return result;
+        }
+
+        Trace::Span span {"multiply",
+            (long) mRows * mCols * other->getColumns() >= Trace::SIZE_THRESHOLD};
+        span.arg("rows", mRows).arg("inner", mCols).arg("columns", other->getColumns());
+
+        const int cols = other->getColumns();
+        auto* result = new Matrix(mRows, cols);
 
+        // Which elements are zero is looked up once instead of once for
+        // every product that they are part of.
+        std::vector<char> leftZero((std::size_t) mRows * mCols);
+        std::vector<char> rightZero((std::size_t) mCols * cols);
         for (int i = 0; i < mRows; i++) {
-            for (int j = 0; j < other->getColumns(); j++) {
-                int resIdx = i * other->getColumns() + j;
+            for (int k = 0; k < mCols; k++) leftZero[i * mCols + k] = get(i, k)->isZero();
+        }
+        for (int k = 0; k < mCols; k++) {
+            for (int j = 0; j < cols; j++) rightZero[k * cols + j] = otherMatrix->get(k, j)->isZero();
+        }
+
+        // A product of triangles only has to sum over where both triangles
+        // overlap. The last row of a product of affine matrices is known.
+        const unsigned left = getStructure(), right = otherMatrix->getStructure();
+        const bool affine = (left & right & AFFINE) != 0;
+        const int rows = affine ? mRows - 1 : mRows;
+        if (affine) {
+            Symbol*& corner = result->element(mRows - 1, cols - 1);
+            delete corner;
+            corner = new Constant{1.0f};
+        }
 
-                for (int k = 0; k < mCols; k++) {
-                    int leftIdx = i * mCols + k;
-                    int rightIdx = k * other->getColumns() + j;
+        // Both operands are read through their strides, so a transposed view
+        // is consumed as it is without materializing it first. Of a symmetric
+        // product only the upper triangle is computed.
+        for (int i = 0; i < rows; i++) {
+            for (int j = symmetric ? i : 0; j < cols; j++) {
+                Symbol*& target = result->element(i, j);
 
-                    Symbol* left = mElements[leftIdx];
-                    Symbol* right = otherMatrix->mElements[rightIdx];
+                const int from = std::max((left & UPPER) ? i : 0, (right & LOWER) ? j : 0);
+                const int to = std::min((left & LOWER) ? i : mCols - 1, (right & UPPER) ? j : mCols - 1);
+                for (int k = from; k <= to; k++) {
+                    if (leftZero[i * mCols + k] || rightZero[k * cols + j]) continue;
 
-                    if (left->isZero() || right->isZero()) continue;
+                    Governor::check();
 
-                    result->mElements[resIdx] = *result->mElements[resIdx] +
-                        (*left->copy() * right->copy());
+                    target = *target + (*get(i, k)->copy() * otherMatrix->get(k, j)->copy());
                 }
             }
         }
 
+        result->mStructure = (int) (left & right & (DIAGONAL | AFFINE));
+        if (symmetric) {
+            result->mirrorUpper();
+            result->mStructure |= (int) SYMMETRIC;
+        }
+
         delete this;
         delete other;
         return result;
     }
 
-    throw InvalidExpression();
+    // The order is kept until the other side becomes a matrix too
+    return new Product(this, other);
 }
 
-Symbol *Matrix::operator/(Symbol *other) {
-    if (other->isScalar()) {
+bool Matrix::isSymmetricProduct(const Matrix* other) const {
+    if (mRows != other->mCols || mRows < 2) return false;
+
+    // The transpose of a view shares the storage with swapped strides
+    if (mStorage == other->mStorage && mOffset == other->mOffset) {
+        if (mRowStride == other->mColStride && mColStride == other->mRowStride) {
+            return true;
+        }
+        if (mRowStride == other->mRowStride && mColStride == other->mColStride) {
+            return (getStructure() & SYMMETRIC) != 0; // Since S * S = S * S'
+        }
+    }
+
+    // Otherwise the elements are compared, which usually stops at the first
+    for (int i = 0; i < mRows; i++) {
+        for (int k = 0; k < mCols; k++) {
+            if (!isSameElement(get(i, k), other->get(k, i))) return false;
+        }
+    }
+    return true;
+}
+
+void Matrix::mirrorUpper() {
+    for (int i = 1; i < mRows; i++) {
+        for (int j = 0; j < i; j++) {
+            Symbol*& target = element(i, j);
+            delete target;
+            target = get(j, i)->copy();
+        }
+    }
+}
+
+Matrix *Matrix::multiplyStructured(const Matrix* other) const {
+    const unsigned left = getStructure(), right = other->getStructure();
+    const int cols = other->getColumns();
+
+    if (left == IDENTITY) return dynamic_cast<Matrix*>(other->copy());
+    if (right == IDENTITY) return dynamic_cast<Matrix*>(copy());
+
+    const bool leftScales = (left & DIAGONAL) == DIAGONAL;
+    const bool rightScales = (right & DIAGONAL) == DIAGONAL;
+    if (!(left & PERMUTATION) && !(right & PERMUTATION) && !leftScales && !rightScales) {
+        return nullptr;
+    }
+
+    auto* result = new Matrix(mRows, cols);
+
+    if (left & PERMUTATION) {
+        // Every row of the result is a row of the right matrix
         for (int i = 0; i < mRows; i++) {
-            for (int j = 0; j < mCols; j++) {
-                int idx = i * mCols + j;
-                mElements[idx] = *mElements[idx] / other->copy();
+            int k = 0;
+            while (get(i, k)->isZero()) k++;
+            for (int j = 0; j < cols; j++) {
+                result->set(i, j, other->get(k, j)->copy());
             }
         }
-        delete other;
+    } else if (right & PERMUTATION) {
+        // Every column of the result is a column of the left matrix
+        for (int j = 0; j < cols; j++) {
+            int k = 0;
+            while (other->get(k, j)->isZero()) k++;
+            for (int i = 0; i < mRows; i++) {
+                result->set(i, j, get(i, k)->copy());
+            }
+        }
+    } else {
+        // Scaling the rows or columns of the other matrix
+        for (int i = 0; i < mRows; i++) {
+            for (int j = 0; j < cols; j++) {
+                const Symbol* scale = leftScales ? get(i, i) : other->get(j, j);
+                const Symbol* element = leftScales ? other->get(i, j) : get(i, j);
+                if (scale->isZero() || element->isZero()) continue;
+
+                Governor::check();
+                Symbol* product = leftScales
+                    ? *scale->copy() * element->copy()
+                    : *element->copy() * scale->copy();
+                result->set(i, j, product);
+            }
+        }
+        // Scaling keeps the triangles of the other matrix, and its affine
+        // last row if the scaling leaves the last row alone
+        const unsigned scaled = leftScales ? right : left;
+        result->mStructure = (int) ((scaled & DIAGONAL) | (left & right & AFFINE));
+        if (leftScales && rightScales) result->mStructure |= (int) SYMMETRIC;
+    }
+
+    return result;
+}
+
+Matrix *Matrix::multiplySmall(const Matrix* other, bool symmetric) const {
+    if (mRows != mCols || mRows < 2 || mRows > 4) return nullptr;
+
+    // Square transforms, and transforms of a single vector
+    const int cols = other->getColumns();
+    if (cols != mRows && cols != 1) return nullptr;
+
+    switch (mRows * 10 + cols) {
+        case 22: return multiplyUnrolled<2, 2, 2>(other, symmetric);
+        case 21: return multiplyUnrolled<2, 2, 1>(other, symmetric);
+        case 33: return multiplyUnrolled<3, 3, 3>(other, symmetric);
+        case 31: return multiplyUnrolled<3, 3, 1>(other, symmetric);
+        case 44: return multiplyUnrolled<4, 4, 4>(other, symmetric);
+        case 41: return multiplyUnrolled<4, 4, 1>(other, symmetric);
+        default: return nullptr;
+    }
+}
+
+template <int R, int K, int C>
+Matrix *Matrix::multiplyUnrolled(const Matrix* other, bool symmetric) const {
+    Symbol* left[R][K];
+    Symbol* right[K][C];
+    bool numeric = true;
+    for (int i = 0; i < R; i++) {
+        for (int k = 0; k < K; k++) {
+            left[i][k] = get(i, k);
+            numeric = numeric && dynamic_cast<Constant*>(left[i][k]);
+        }
+    }
+    for (int k = 0; k < K; k++) {
+        for (int j = 0; j < C; j++) {
+            right[k][j] = other->get(k, j);
+            numeric = numeric && dynamic_cast<Constant*>(right[k][j]);
+        }
+    }
+
+    // The same triangle and affine bounds as the general product
+    const unsigned leftStructure = getStructure(), rightStructure = other->getStructure();
+    const bool affine = (leftStructure & rightStructure & AFFINE) != 0;
+    const int rows = affine ? R - 1 : R;
+    int from[R][C], to[R][C];
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            from[i][j] = std::max((leftStructure & UPPER) ? i : 0, (rightStructure & LOWER) ? j : 0);
+            to[i][j] = std::min((leftStructure & LOWER) ? i : K - 1, (rightStructure & UPPER) ? j : K - 1);
+        }
+    }
+
+    auto* result = new Matrix(R, C);
+    if (affine) *static_cast<Constant*>(result->element(R - 1, C - 1)) = 1.0f;
+
+    if (numeric) {
+        // The zeros of the result are reused, so nothing is allocated
+        for (int i = 0; i < rows; i++) {
+            for (int j = symmetric ? i : 0; j < C; j++) {
+                value_t sum = 0.0f;
+                for (int k = from[i][j]; k <= to[i][j]; k++) {
+                    const value_t a = static_cast<Constant*>(left[i][k])->getValue();
+                    const value_t b = static_cast<Constant*>(right[k][j])->getValue();
+                    if (a == 0.0f || b == 0.0f) continue;
+                    sum += a * b;
+                }
+                *static_cast<Constant*>(result->element(i, j)) = sum;
+                if (symmetric) *static_cast<Constant*>(result->element(j, i)) = sum;
+            }
+        }
+    } else {
+        bool leftZero[R][K], rightZero[K][C];
+        for (int i = 0; i < R; i++) {
+            for (int k = 0; k < K; k++) leftZero[i][k] = left[i][k]->isZero();
+        }
+        for (int k = 0; k < K; k++) {
+            for (int j = 0; j < C; j++) rightZero[k][j] = right[k][j]->isZero();
+        }
+
+        for (int i = 0; i < rows; i++) {
+            for (int j = symmetric ? i : 0; j < C; j++) {
+                Governor::check();
+                Symbol*& target = result->element(i, j);
+                for (int k = from[i][j]; k <= to[i][j]; k++) {
+                    if (leftZero[i][k] || rightZero[k][j]) continue;
+                    target = *target + (*left[i][k]->copy() * right[k][j]->copy());
+                }
+            }
+        }
+        if (symmetric) result->mirrorUpper();
+    }
+
+    result->mStructure = (int) (leftStructure & rightStructure & (DIAGONAL | AFFINE));
+    if (symmetric) result->mStructure |= (int) SYMMETRIC;
+    return result;
+}
+
+void Matrix::applyScalar(Symbol* scalar, char operation) {
+    detach();
+    auto* number = dynamic_cast<const Constant*>(scalar);
+    for (auto& element : *mStorage) {
+        auto* constant = dynamic_cast<Constant*>(element);
+        if (number != nullptr && constant != nullptr) {
+            const value_t value = constant->getValue();
+            switch (operation) {
+                case '+': *constant = value + number->getValue(); break;
+                case '*': *constant = value * number->getValue(); break;
+                default:  if (!constant->isZero()) *constant = value / number->getValue();
+            }
+            continue;
+        }
+
+        switch (operation) {
+            case '+': element = *element + scalar->copy(); break;
+            case '*': element = *element * scalar->copy(); break;
+            default:  element = *element / scalar->copy();
+        }
+    }
+    delete scalar;
+}
+
+Matrix* Matrix::multiplyElements(const Matrix* other) const {
+    return elementwise(other, false);
+}
+
+Matrix* Matrix::divideElements(const Matrix* other) const {
+    return elementwise(other, true);
+}
+
+Matrix* Matrix::elementwise(const Matrix* other, bool divide) const {
+    // A side with a single row or column is repeated across the other side
+    const int rows = mRows == 1 ? other->mRows : mRows;
+    const int cols = mCols == 1 ? other->mCols : mCols;
+    if ((mRows != rows && mRows != 1) || (other->mRows != rows && other->mRows != 1)
+    ||  (mCols != cols && mCols != 1) || (other->mCols != cols && other->mCols != 1)) {
+        throw std::invalid_argument(
+            "Can't compute element-wise " + std::string(divide ? "division" : "product") +
+            " between [" + std::to_string(mRows) + ", " + std::to_string(mCols) + "] and [" +
+            std::to_string(other->mRows) + ", " + std::to_string(other->mCols) + "] matrices.");
+    }
+
+    if (Dense::accepts(this) && Dense::accepts(other)) {
+        return Dense::elementwise(this, other, divide);
+    }
+
+    auto* result = Matrix::zero(rows, cols);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            const Symbol* left = get(mRows == 1 ? 0 : i, mCols == 1 ? 0 : j);
+            const Symbol* right = other->get(other->mRows == 1 ? 0 : i, other->mCols == 1 ? 0 : j);
+            if (divide && right->isZero()) {
+                delete result;
+                throw std::invalid_argument("Division by zero.");
+            }
+            if (left->isZero() || (!divide && right->isZero())) continue;
+
+            Governor::check();
+            result->set(i, j, divide ? *left->copy() / right->copy()
+                                     : *left->copy() * right->copy());
+        }
+    }
+    return result;
+}
+
+bool Matrix::addSmall(const Matrix* other) {
+    switch (mRows * 10 + mCols) {
+        case 22: return addUnrolled<2, 2>(other);
+        case 21: return addUnrolled<2, 1>(other);
+        case 33: return addUnrolled<3, 3>(other);
+        case 31: return addUnrolled<3, 1>(other);
+        case 44: return addUnrolled<4, 4>(other);
+        case 41: return addUnrolled<4, 1>(other);
+        default: return false;
+    }
+}
+
+template <int R, int C>
+bool Matrix::addUnrolled(const Matrix* other) {
+    const Constant* right[R][C];
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            right[i][j] = dynamic_cast<const Constant*>(other->get(i, j));
+            if (right[i][j] == nullptr) return false;
+        }
+    }
+
+    Constant* left[R][C];
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            left[i][j] = dynamic_cast<Constant*>(get(i, j));
+            if (left[i][j] == nullptr) return false;
+        }
+    }
+
+    // A shared storage is copied, which moves the elements
+    if (isShared()) {
+        detach();
+        for (int i = 0; i < R; i++) {
+            for (int j = 0; j < C; j++) {
+                left[i][j] = static_cast<Constant*>(get(i, j));
+            }
+        }
+    }
+
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            *left[i][j] = left[i][j]->getValue() + right[i][j]->getValue();
+        }
+    }
+    return true;
+}
+
+Symbol *Matrix::pow(Symbol::value_t exponent) {
+    if (mRows != mCols) {
+        const std::string message = "Can't raise a non-square [" + std::to_string(mRows)
+            + ", " + std::to_string(mCols) + "] matrix to a power.";
+        delete this;
+        throw std::invalid_argument(message);
+    }
+
+    return Symbol::pow(exponent);
+}
+
+Symbol *Matrix::determinant() const {
+    if (Dense::accepts(this)) return Dense::determinant(this);
+    return Bareiss::determinant(this);
+}
+
+Matrix *Matrix::inverse() const {
+    if (Dense::accepts(this)) return Dense::inverse(this);
+    return Bareiss::inverse(this);
+}
+
+Matrix *Matrix::solve(const Matrix* right) const {
+    if (Dense::accepts(this) && Dense::accepts(right)) {
+        if (Sparse::suits(this)) {
+            // Falls back to factorizing if the iterations do not converge
+            if (Matrix* result = Sparse::of(this).trySolve(right)) return result;
+        }
+        return Dense::solve(this, right);
+    }
+    return Bareiss::solve(this, right);
+}
+
+Symbol *Matrix::operator/(Symbol *other) {
+    if (other->isScalar()) {
+        modified();
+        applyScalar(other, '/');
         return this;
     }
 
@@ -177,6 +695,17 @@ Symbol *Matrix::operator/(Symbol *other) {
 std::string Matrix::format(const Formatter &formatter) const {
     std::vector<std::string> elements;
 
+    // Every mirrored pair of a matrix that is already known to be symmetric
+    // is only formatted once. Finding out would cost more than it saves.
+    if (mRows == mCols && mRows > 1 && mStructure >= 0 && (mStructure & SYMMETRIC)) {
+        for (int i = 0; i < mRows; i++) {
+            for (int j = i; j < mCols; j++) {
+                elements.push_back(get(i, j)->format(formatter));
+            }
+        }
+        return formatter.symmetric(mRows, elements);
+    }
+
     for (int i = 0; i < mRows; i++) {
         for (int j = 0; j < mCols; j++) {
             elements.push_back(get(i, j)->format(formatter));
@@ -234,6 +763,7 @@ Matrix* Matrix::eye(int size) {
         matrix->set(i, i, new Constant{1.0f});
     }
 
+    matrix->mStructure = IDENTITY;
     return matrix;
 }
 
@@ -251,7 +781,6 @@ Matrix* Matrix::square(std::initializer_list<Symbol::value_t> elements) {
     auto it = elements.begin();
     for (int i = 0; i < size; i++) {
         for (int j = 0; j < size; j++) {
-            int idx = i * size + j;
             matrix->set(i, j, new Constant{*it});
             it++;
         }
@@ -268,7 +797,6 @@ Matrix* Matrix::square(std::initializer_list<Symbol*> elements) {
     auto it = elements.begin();
     for (int i = 0; i < size; i++) {
         for (int j = 0; j < size; j++) {
-            int idx = i * size + j;
             matrix->set(i, j, *it);
             it++;
         }
@@ -282,12 +810,11 @@ Matrix* Matrix::square(std::initializer_list<Symbol*> elements) {
 Symbol *Matrix::replace(const std::function<bool(const Symbol*)> &predicate,
                         const std::function<Symbol*(Symbol*)> &mapper) {
 
-    for (int i = 0; i < mRows; i++) {
-        for (int j = 0; j < mCols; j++) {
-            const int idx = i * mCols + j;
-            if (predicate(mElements[idx])) {
-                mElements[idx] = mapper(mElements[idx]);
-            }
+    detach();
+    modified();
+    for (auto& element : *mStorage) {
+        if (predicate(element)) {
+            element = mapper(element);
         }
     }
 
@@ -5,10 +5,32 @@
 #pragma once
 
 #include "symbol.hpp"
+#include <memory>
 #include <vector>
 
+/**
+ * A matrix of symbols. The elements are kept in a storage that is shared
+ * between copies and addressed with an offset and a stride per dimension,
+ * so copying and transposing never touch the elements. The storage is only
+ * copied when a matrix that shares it is about to be modified.
+ */
 class Matrix : public Symbol {
 public:
+    /**
+     * Patterns of zeros and ones that multiplication uses to skip work. A
+     * matrix can have several of them at once, like the identity.
+     */
+    enum Structure : unsigned {
+        GENERAL     = 0,
+        UPPER       = 1u << 0, // Only zeros below the diagonal
+        LOWER       = 1u << 1, // Only zeros above the diagonal
+        DIAGONAL    = UPPER | LOWER,
+        AFFINE      = 1u << 2, // The last row is zeros followed by a one
+        PERMUTATION = 1u << 3, // A single one in every row and column
+        SYMMETRIC   = 1u << 4, // Equal to its own transpose
+        IDENTITY    = DIAGONAL | AFFINE | PERMUTATION | SYMMETRIC
+    };
+
     static Matrix* eye(int size);
 
     static Matrix* zero(int size);
@@ -29,8 +51,29 @@ public:
 
     Symbol* negate() override;
 
+    /**
+     * Transposes this matrix in place by swapping the strides.
+     */
     Matrix* transpose();
 
+    /**
+     * Narrows this matrix in place to a view of the given rows and columns,
+     * by moving the offset. The elements outside of the view are kept in
+     * the storage until no matrix refers to it.
+     */
+    Matrix* slice(int row, int col, int rows, int cols);
+
+    /**
+     * True if the element storage is shared with another matrix.
+     */
+    bool isShared() const;
+
+    /**
+     * The structures that this matrix has, which are only looked for once
+     * until the matrix is modified. Only square matrices have structure.
+     */
+    unsigned getStructure() const;
+
     Symbol* operator+(Symbol* other) override;
 
     Symbol* operator-(Symbol* other) override;
@@ -39,6 +82,41 @@ public:
 
     Symbol* operator/(Symbol* other) override;
 
+    Symbol* pow(value_t exponent) override;
+
+    /**
+     * Returns a new symbol with the determinant of this square matrix.
+     * Numeric matrices are factorized numerically, and symbolic matrices
+     * with fraction-free elimination.
+     */
+    Symbol* determinant() const;
+
+    /**
+     * Returns a new matrix with the inverse of this square matrix. Elements
+     * that are not polynomials are divided by the determinant.
+     */
+    Matrix* inverse() const;
+
+    /**
+     * Returns a new matrix X such that this * X = right, like this \ right.
+     */
+    Matrix* solve(const Matrix* right) const;
+
+    /**
+     * Returns a new matrix with the elements of this multiplied by the
+     * elements of other, like this .* other. A single row, column or element
+     * of either side is repeated to the size of the other side. Throws
+     * std::invalid_argument if the sizes can't be made to match.
+     */
+    Matrix* multiplyElements(const Matrix* other) const;
+
+    /**
+     * Returns a new matrix with the elements of this divided by the elements
+     * of other, like this ./ other, repeated the same way as in
+     * multiplyElements.
+     */
+    Matrix* divideElements(const Matrix* other) const;
+
     Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
                     const std::function<Symbol *(Symbol *)> &mapper) override;
 
@@ -55,11 +133,101 @@ public:
     std::set<std::string> findUndefined() override;
 
 private:
+    /**
+     * The elements of matrices of up to 4x4 are kept inline, so that the
+     * transforms that most inputs are made of need a single allocation.
+     */
+    struct Storage {
+        static const int INLINE_SIZE = 16;
+
+        explicit Storage(int size);
+
+        ~Storage();
+
+        Symbol** begin() { return elements; }
+
+        Symbol** end() { return elements + size; }
+
+        int size;
+        Symbol** elements;
+        Symbol* inlined[INLINE_SIZE];
+        std::unique_ptr<Symbol*[]> allocated;
+    };
+
     explicit Matrix(int rows, int cols);
 
     Matrix(const Matrix& prototype);
 
-    const int mRows;
-    const int mCols;
-    std::vector<Symbol*> mElements;
+    unsigned findStructure() const;
+
+    /**
+     * Forgets the structure, which has to be done when an element changes.
+     */
+    void modified();
+
+    /**
+     * Returns the product of this and other if either is the identity, a
+     * permutation or diagonal, or nullptr otherwise. Consumes nothing.
+     */
+    Matrix* multiplyStructured(const Matrix* other) const;
+
+    /**
+     * True if the product of this and other is known to be symmetric, which
+     * it is if other is the transpose of this, like in A * A' and A' * A.
+     */
+    bool isSymmetricProduct(const Matrix* other) const;
+
+    /**
+     * Returns the product of this and other if both have one of the sizes
+     * that are unrolled, or nullptr otherwise. Consumes nothing.
+     */
+    Matrix* multiplySmall(const Matrix* other, bool symmetric) const;
+
+    /**
+     * Multiplies an R x K matrix with a K x C matrix with all loops fully
+     * unrolled. Numeric operands are multiplied as plain numbers, without a
+     * symbol for every partial product. If the product is symmetric, only
+     * the upper triangle is computed.
+     */
+    template <int R, int K, int C>
+    Matrix* multiplyUnrolled(const Matrix* other, bool symmetric) const;
+
+    /**
+     * Fills the lower triangle of this square matrix with copies of the
+     * upper triangle.
+     */
+    void mirrorUpper();
+
+    /**
+     * Adds the elements of other to the elements of this, if both are
+     * numeric. Returns false without changing anything otherwise.
+     */
+    bool addSmall(const Matrix* other);
+
+    template <int R, int C>
+    bool addUnrolled(const Matrix* other);
+
+    Matrix* elementwise(const Matrix* other, bool divide) const;
+
+    /**
+     * Adds, multiplies or divides every element with the scalar, which is
+     * consumed. Numbers are combined in place, so a numeric scalar is not
+     * copied for every numeric element.
+     */
+    void applyScalar(Symbol* scalar, char operation);
+
+    Symbol*& element(int row, int col);
+
+    /**
+     * Gives this matrix its own copy of the elements if they are shared, or
+     * if it is a slice of a larger storage, so that they can be modified
+     * and iterated over.
+     */
+    void detach();
+
+    int mRows;
+    int mCols;
+    std::shared_ptr<Storage> mStorage;
+    int mOffset, mRowStride, mColStride;
+    mutable int mStructure;
 };
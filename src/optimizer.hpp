@@ -4,29 +4,46 @@
 // Copyright (c) 2020 Emil Forslund. All rights reserved.
 //
 
-class Symbol;
-class Constant;
-class Variable;
-class Matrix;
-class Product;
-class Sum;
+#include <ostream>
+#include "pass-manager.hpp"
 
+class Symbol;
+class SubexpressionPass;
+
+/**
+ * Runs the optimization passes selected by the optimization level:
+ *
+ *   0: none, expressions are left as they were parsed, except that products
+ *      and sums of known matrices are always computed
+ *   1: constant-folding and product-flattening
+ *   2: as 1 plus sum-normalization and common-subexpressions (default)
+ */
 class Optimizer {
 public:
-    explicit Optimizer();
+    static const int DEFAULT_LEVEL = 2;
+
+    explicit Optimizer(int level = DEFAULT_LEVEL);
 
     virtual ~Optimizer();
 
-    Symbol* optimize(Symbol* input) const;
+    Symbol* optimize(Symbol* input);
 
-private:
-    Symbol* optimizeConstant(Constant* input) const;
+    void setLevel(int level);
 
-    Symbol* optimizeVariable(Variable* input) const;
+    int getLevel() const;
 
-    Symbol* optimizeMatrix(Matrix* input) const;
+    void setTiming(bool timing);
 
-    Symbol* optimizeProduct(Product* input) const;
+    void setTimeBudget(double seconds);
 
-    Symbol* optimizeSum(Sum* input) const;
+    void report(std::ostream& out) const;
+
+    int getMemoHits() const;
+
+    int getMemoMisses() const;
+
+private:
+    int mLevel;
+    PassManager mPasses;
+    SubexpressionPass* mSubexpressions;
 };
@@ -0,0 +1,147 @@
+#include "parallel.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    /**
+     * Threads that are started once and then wait for work, so that a loop
+     * does not pay for starting and joining threads every time. Only one
+     * loop at a time is handed to the pool. Loops started while it is busy,
+     * or from inside a loop, run on the calling thread instead.
+     */
+    class Pool {
+    public:
+        static Pool& instance() {
+            static Pool pool;
+            return pool;
+        }
+
+        ~Pool() {
+            {
+                std::lock_guard<std::mutex> lock {mMutex};
+                mStopping = true;
+            }
+            mWake.notify_all();
+            for (auto& worker : mWorkers) worker.join();
+        }
+
+        /**
+         * Runs work on the calling thread and on up to helpers workers, and
+         * returns once all of them are done. The work has to stop by itself
+         * once there is nothing left to do. Returns false without running
+         * anything if the pool is busy.
+         */
+        bool run(int helpers, const std::function<void()>& work) {
+            if (sInside) return false;
+            std::unique_lock<std::mutex> job {mJob, std::try_to_lock};
+            if (!job) return false;
+
+            {
+                std::lock_guard<std::mutex> lock {mMutex};
+                while ((int) mWorkers.size() < helpers) {
+                    mWorkers.emplace_back([this] { loop(); });
+                }
+                mWork = &work;
+                mWanted = helpers;
+            }
+            mWake.notify_all();
+
+            sInside = true;
+            work();
+            sInside = false;
+
+            // Every part of the work has been taken once the calling thread
+            // is done, so workers that have not woken up yet are not needed
+            std::unique_lock<std::mutex> lock {mMutex};
+            mWanted = 0;
+            mDone.wait(lock, [this] { return mActive == 0; });
+            mWork = nullptr;
+            return true;
+        }
+
+    private:
+        Pool() = default;
+
+        void loop() {
+            sInside = true;
+            std::unique_lock<std::mutex> lock {mMutex};
+            while (true) {
+                mWake.wait(lock, [this] { return mStopping || mWanted > 0; });
+                if (mStopping) return;
+
+                mWanted--;
+                mActive++;
+                const std::function<void()>* work = mWork;
+                lock.unlock();
+                (*work)();
+                lock.lock();
+                if (--mActive == 0) mDone.notify_all();
+            }
+        }
+
+        static inline thread_local bool sInside = false;
+
+        std::mutex mJob;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mDone;
+        std::vector<std::thread> mWorkers;
+        const std::function<void()>* mWork = nullptr;
+        int mWanted = 0;
+        int mActive = 0;
+        bool mStopping = false;
+    };
+}
+
+void Parallel::forRange(int begin, int end, int grain,
+                        const std::function<void(int, int)>& body) {
+    if (end <= begin) return;
+    grain = std::max(grain, 1);
+
+    const int chunks = (end - begin + grain - 1) / grain;
+    const int threads = std::min(getThreads(), chunks);
+    if (threads <= 1) {
+        body(begin, end);
+        return;
+    }
+
+    std::atomic<int> next {begin};
+    std::exception_ptr error = nullptr;
+    std::mutex errorMutex;
+
+    const std::function<void()> work = [&] {
+        try {
+            for (int from = next.fetch_add(grain); from < end; from = next.fetch_add(grain)) {
+                body(from, std::min(from + grain, end));
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock {errorMutex};
+            if (error == nullptr) error = std::current_exception();
+            next = end;
+        }
+    };
+
+    // The calling thread takes chunks too instead of only waiting
+    if (!Pool::instance().run(threads - 1, work)) work();
+
+    if (error != nullptr) std::rethrow_exception(error);
+}
+
+int Parallel::getThreads() {
+    if (sThreads > 0) return sThreads;
+    return std::max(1, (int) std::thread::hardware_concurrency());
+}
+
+void Parallel::setThreads(int threads) {
+    sThreads = threads;
+}
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <functional>
+
+/**
+ * Splits loops over independent indices between threads. The threads are
+ * started the first time they are needed and then kept waiting for the
+ * next loop. Ranges that are smaller than the grain run on the calling
+ * thread, so small inputs never wake any threads.
+ */
+class Parallel {
+public:
+    /**
+     * Calls body(begin, end) for consecutive chunks covering [begin, end)
+     * and returns once every chunk is done. Chunks are handed out as threads
+     * become free, so rows of uneven cost are still balanced. The body runs
+     * on other threads, so it may not create symbols or allocate memory,
+     * which would race on the counters of Stats.
+     */
+    static void forRange(int begin, int end, int grain,
+                         const std::function<void(int, int)>& body);
+
+    /**
+     * The number of threads to use. Defaults to the number of cores.
+     */
+    static int getThreads();
+
+    /**
+     * Sets the number of threads to use, where 1 disables threading.
+     */
+    static void setThreads(int threads);
+
+private:
+    static inline int sThreads = 0;
+};
@@ -4,15 +4,34 @@
 // Copyright (c) 2020 Emil Forslund. All rights reserved.
 //
 
+#include <cfloat>
+#include <cmath>
+#include <new>
+#include <stdexcept>
 #include <vector>
 #include <sstream>
 #include "symbol.hpp"
 #include "variable.hpp"
 #include "matrix.hpp"
+#include "matrix-chain.hpp"
+#include "matrix-rewriter.hpp"
+#include "matrix-symbol.hpp"
+#include "block-matrix.hpp"
 #include "constant.hpp"
 #include "optimizer.hpp"
-
-Parser::Parser() : mDefines{}, mLine{0}, mCol{0}, mDone{false} {}
+#include "result-cache.hpp"
+#include "serializer.hpp"
+#include "governor.hpp"
+#include "lazy-evaluator.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "transpose.hpp"
+#include "slice.hpp"
+#include "function.hpp"
+#include "invalid-expression.hpp"
+
+Parser::Parser() : mDefines{}, mSources{}, mResolved{}, mStatement{}, mCache{nullptr},
+    mLazy{false}, mUppercaseMatrices{false}, mOptimizer{}, mLine{0}, mCol{0}, mDone{false} {}
 
 Parser::~Parser() {
     for (auto& define : mDefines) {
@@ -31,11 +50,52 @@ std::string Parser::format(const Formatter& formatter) const {
 }
 
 bool Parser::parse(std::istream &input) {
+    {
+        Stats::Phase phase {"parsing"};
+        parseStatements(input);
+    }
+
+    // Defines that are found in the cache (or that were loaded from a
+    // snapshot) are already substituted and optimized, so they can skip the
+    // remaining steps.
+    std::map<std::string, uint64_t> keys;
+    if (mCache != nullptr) {
+        Stats::Phase phase {"cache"};
+        loadCached(keys);
+    }
+
+    // Whole-matrix identities are simplified before anything is multiplied
+    // out, unless expressions are to be left as they were parsed
+    if (mOptimizer.getLevel() >= 1) {
+        Stats::Phase phase {"rewriting"};
+        rewrite();
+    }
+
+    if (mLazy) return true; // Computed on demand by find()
+
+    {
+        Stats::Phase phase {"substitution"};
+        substitute();
+    }
+
+    {
+        Stats::Phase phase {"optimization"};
+        optimize(keys);
+    }
+
+    return true; // Parsing was successful
+}
+
+void Parser::parseStatements(std::istream& input) {
     while (!mDone) {
         char c;
         if (nextNonWhitespace(input, c)) {
+            Trace::Span span {"parse"};
+            mStatement = c;
             char nameTerminated;
             auto name = expectName(input, nameTerminated, c);
+            span.arg("define", name);
+            Governor::Define define {name};
 
             if (nameTerminated != '=')
                 throw unexpectedCharacter(nameTerminated);
@@ -46,33 +106,216 @@ bool Parser::parse(std::istream &input) {
 
             auto* symbol = expectSymbolsUntil(input, ';');
             mDefines[name] = symbol;
+            mSources[name] = mStatement;
         } else {
             mDone = true;
         }
     }
+}
+
+void Parser::loadCached(std::map<std::string, uint64_t>& keys) {
+    std::set<std::string> visiting;
+    for (auto& pair : mDefines) {
+        if (mResolved.count(pair.first)) continue;
+        const uint64_t key = closureKey(pair.first, keys, visiting);
+        if (auto* symbol = mCache->load(key)) {
+            delete pair.second;
+            pair.second = symbol;
+            mResolved.insert(pair.first);
+        }
+    }
+}
 
+void Parser::rewrite() {
     for (auto& pair : mDefines) {
+        if (mResolved.count(pair.first)) continue;
+
+        Trace::Span span {"rewrite"};
+        span.arg("define", pair.first);
+        try {
+            pair.second = MatrixRewriter::rewrite(pair.second);
+        } catch (...) {
+            pair.second = nullptr; // Partially consumed by the rewriter
+            throw;
+        }
+    }
+}
+
+void Parser::substitute() {
+    // The names each define refers to, so that only the defines that
+    // actually use a name have to be searched for it.
+    std::map<std::string, std::set<std::string>> references;
+    for (auto& pair : mDefines) {
+        if (mResolved.count(pair.first)) continue;
+        references[pair.first] = pair.second->findUndefined();
+    }
+
+    for (auto& pair : mDefines) {
+        Trace::Span span {"substitute"};
+        span.arg("define", pair.first);
+
         for (auto& inner : mDefines) {
             if (inner.first == pair.first) continue;
-            inner.second = inner.second->replace(
-                [pair](const Symbol* symbol) -> bool {
-                    if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
-                        return variable->getName() == pair.first;
-                    } else return false;
-                }, [pair](Symbol* symbol) -> Symbol* {
-                    delete symbol;
-                    return pair.second->copy();
-                }
-            );
+            if (mResolved.count(inner.first)) continue;
+
+            auto& names = references[inner.first];
+            if (names.erase(pair.first) == 0) continue;
+
+            Governor::Define define {inner.first};
+            inner.second = replaceVariable(inner.second, pair.first, pair.second);
+
+            auto used = references.find(pair.first);
+            if (used != references.end()) {
+                names.insert(used->second.begin(), used->second.end());
+            }
         }
     }
+}
+
+Symbol *Parser::replaceVariable(Symbol* symbol, const std::string& name, const Symbol* value) {
+    if (auto* variable = dynamic_cast<Variable*>(symbol)) {
+        if (variable->getName() != name) return symbol;
+
+        // The parser merges repeated names, so A*A is a variable A^2
+        Symbol* result = value->copy();
+        if (fabsf(variable->getExponent() - 1.0f) >= FLT_EPSILON) {
+            result = result->pow(variable->getExponent());
+        }
+        if (fabsf(variable->getQuantity() - 1.0f) >= FLT_EPSILON) {
+            result = *result * variable->getQuantity();
+        }
+
+        delete symbol;
+        return result;
+    }
+
+    if (auto* matrix = dynamic_cast<MatrixSymbol*>(symbol)) {
+        if (matrix->getName() != name) return symbol;
+
+        Symbol* result = value->copy();
+        if (fabsf(matrix->getExponent() - 1.0f) >= FLT_EPSILON) {
+            result = result->pow(matrix->getExponent());
+        }
+
+        delete symbol;
+        return result;
+    }
 
-    Optimizer optimizer {};
+    return symbol->replace(
+        [](const Symbol*) -> bool { return true; },
+        [&name, value](Symbol* child) -> Symbol* {
+            return replaceVariable(child, name, value);
+        });
+}
+
+void Parser::optimize(std::map<std::string, uint64_t>& keys) {
     for (auto& pair : mDefines) {
-        pair.second = optimizer.optimize(pair.second);
+        if (mResolved.count(pair.first)) continue;
+
+        Trace::Span span {"define"};
+        span.arg("define", pair.first);
+        Governor::Define define {pair.first};
+
+        Stats::Allocations allocations {};
+        const long before = Stats::isEnabled() ? Stats::countNodes(pair.second) : 0;
+        try {
+            pair.second = BlockMatrix::flatten(mOptimizer.optimize(pair.second));
+        } catch (const std::bad_alloc&) {
+            pair.second = nullptr;
+            throw std::runtime_error("Out of memory while optimizing '" +
+                pair.first + "' (" + std::to_string(allocations.getPeakBytes()) +
+                " bytes live).");
+        } catch (...) {
+            pair.second = nullptr; // Partially consumed by the optimizer
+            throw;
+        }
+        allocations.close();
+        if (Stats::isEnabled()) {
+            Stats::recordDefine(pair.first, before,
+                Stats::countNodes(pair.second), allocations);
+        }
+
+        if (mCache != nullptr) {
+            mCache->store(keys[pair.first], pair.second);
+        }
+        mResolved.insert(pair.first);
     }
+}
 
-    return true; // Parsing was successful
+void Parser::setCache(ResultCache* cache) {
+    mCache = cache;
+}
+
+void Parser::define(const std::string& name, Symbol* symbol) {
+    auto existing = mDefines.find(name);
+    if (existing != mDefines.end()) {
+        delete symbol;
+        throw std::invalid_argument("Variable '" + name + "' already defined.");
+    }
+
+    mDefines[name] = symbol;
+    mResolved.insert(name);
+}
+
+const std::map<std::string, Symbol*>& Parser::getDefines() const {
+    return mDefines;
+}
+
+Optimizer& Parser::getOptimizer() {
+    return mOptimizer;
+}
+
+const Optimizer& Parser::getOptimizer() const {
+    return mOptimizer;
+}
+
+uint64_t Parser::closureKey(const std::string& name,
+                            std::map<std::string, uint64_t>& keys,
+                            std::set<std::string>& visiting) {
+    auto known = keys.find(name);
+    if (known != keys.end()) return known->second;
+
+    if (!visiting.insert(name).second) {
+        throw std::invalid_argument("Define '" + name + "' depends on itself.");
+    }
+
+    // Defines without source text were loaded already optimized, so they are
+    // identified by their encoded value instead.
+    auto source = mSources.find(name);
+    if (source == mSources.end()) {
+        std::string encoded;
+        Serializer::encode(encoded, mDefines[name]);
+        visiting.erase(name);
+        return keys[name] = ResultCache::hash(encoded);
+    }
+
+    // The key covers the normalized source of this define as well as the
+    // keys of every define it depends on, so that a change anywhere in the
+    // closure invalidates the entry. Results differ between optimization
+    // levels and with uppercase matrices, so those are included too.
+    std::string normalized = "O" + std::to_string(mOptimizer.getLevel())
+        + (mUppercaseMatrices ? "M:" : ":");
+    for (char c : source->second) {
+        switch (c) {
+            case ' ': case '\n': case '\t': case '\r': continue;
+            default: normalized.push_back(c);
+        }
+    }
+
+    uint64_t key = ResultCache::hash(normalized);
+    for (auto& dependency : mDefines[name]->findUndefined()) {
+        if (dependency == name || mDefines.find(dependency) == mDefines.end()) {
+            continue;
+        }
+        const uint64_t dependencyKey = closureKey(dependency, keys, visiting);
+        key = ResultCache::hash(std::string(
+            reinterpret_cast<const char*>(&dependencyKey),
+            sizeof(dependencyKey)), key);
+    }
+
+    visiting.erase(name);
+    keys[name] = key;
+    return key;
 }
 
 Symbol *Parser::get(const std::string &key) const {
@@ -83,6 +326,85 @@ Symbol *Parser::get(const std::string &key) const {
     return define->second;
 }
 
+Symbol *Parser::find(const std::string &query) {
+    const auto bracket = query.find('[');
+    const std::string name = query.substr(0, bracket);
+    const Symbol* define = get(name);
+
+    Stats::Phase phase {"evaluation"};
+    Trace::Span span {"find"};
+    span.arg("define", name);
+    LazyEvaluator evaluator {mDefines, mOptimizer};
+
+    if (bracket == std::string::npos) {
+        return mLazy ? evaluator.evaluate(define) : define->copy();
+    }
+
+    // Parse the indices, where ':' selects every row or column
+    const int rows = evaluator.getRows(define);
+    const int cols = evaluator.getColumns(define);
+    int first, last, firstCol, lastCol;
+    {
+        std::istringstream indices {query.substr(bracket + 1)};
+        auto expectIndex = [&indices, &query](int size, char separator,
+                                              int& from, int& to) {
+            char c;
+            if (indices >> c && c == ':') {
+                from = 0;
+                to = size - 1;
+            } else {
+                indices.putback(c);
+                if (!(indices >> from)) {
+                    throw std::invalid_argument("Expected an index in '" + query + "'.");
+                }
+                if (from < 0 || from >= size) {
+                    throw std::invalid_argument("Index " + std::to_string(from) +
+                        " in '" + query + "' is outside of the matrix.");
+                }
+                to = from;
+            }
+            if (!(indices >> c) || c != separator) {
+                throw std::invalid_argument("Expected '" + std::string(1, separator) +
+                    "' in '" + query + "'.");
+            }
+        };
+        expectIndex(rows, ',', first, last);
+        expectIndex(cols, ']', firstCol, lastCol);
+    }
+
+    evaluator.setColumnMajor(last > first && firstCol == lastCol);
+
+    Matrix* result = Matrix::zero(last - first + 1, lastCol - firstCol + 1);
+    try {
+        for (int i = first; i <= last; i++) {
+            for (int j = firstCol; j <= lastCol; j++) {
+                Symbol* element = evaluator.element(define, i, j);
+                if (mLazy) element = mOptimizer.optimize(element);
+                result->set(i - first, j - firstCol, element);
+            }
+        }
+    } catch (...) {
+        delete result;
+        throw;
+    }
+
+    if (result->isScalar()) {
+        Symbol* element = result->get(0, 0)->copy();
+        delete result;
+        return element;
+    }
+
+    return result;
+}
+
+void Parser::setLazy(bool lazy) {
+    mLazy = lazy;
+}
+
+void Parser::setUppercaseMatrices(bool enabled) {
+    mUppercaseMatrices = enabled;
+}
+
 bool Parser::nextChar(std::istream &input, char &c) {
     int i = input.get();
     switch (i) {
@@ -96,6 +418,7 @@ bool Parser::nextChar(std::istream &input, char &c) {
     }
 
     c = (char) i;
+    mStatement.push_back(c);
     return true;
 }
 
@@ -153,6 +476,7 @@ Symbol *Parser::expectOneSymbol(std::istream &input, char &terminatedBy) {
 
     char c;
     while (nextNonWhitespace(input, c)) {
+        Symbol* symbol;
         switch (c) {
             case '-': {
                 if (negative) throw unexpectedCharacter(c);
@@ -160,37 +484,176 @@ Symbol *Parser::expectOneSymbol(std::istream &input, char &terminatedBy) {
                 continue;
             }
             case '[': {
-                Symbol* symbol = expectMatrix(input);
-                if (nextNonWhitespace(input, terminatedBy))
-                    return negative ? symbol->negate() : symbol;
-                throw unexpectedEndOfFile();
+                symbol = expectMatrix(input);
+                if (!nextNonWhitespace(input, terminatedBy))
+                    throw unexpectedEndOfFile();
+                break;
             }
             case '(': {
-                Symbol* symbol = expectSymbolsUntil(input, ')');
-                if (nextNonWhitespace(input, terminatedBy))
-                    return negative ? symbol->negate() : symbol;
-                throw unexpectedEndOfFile();
+                symbol = expectSymbolsUntil(input, ')');
+                if (!nextNonWhitespace(input, terminatedBy))
+                    throw unexpectedEndOfFile();
+                break;
             }
             case '.': {
                 const float decimal = expectDecimalPart(input, terminatedBy);
-                Symbol* symbol = new Constant{decimal};
-                return negative ? symbol->negate() : symbol;
+                symbol = new Constant{decimal};
+                break;
             }
             CASE_0_TO_9 {
-                Symbol* symbol = expectConstant(input, terminatedBy, c);
-                return negative ? symbol->negate() : symbol;
+                symbol = expectConstant(input, terminatedBy, c);
+                break;
             }
             CASE_ALPHABETIC {
-                Symbol* symbol = expectVariable(input, terminatedBy, c);
-                return negative ? symbol->negate() : symbol;
+                auto* variable = expectVariable(input, terminatedBy, c);
+                if (terminatedBy == '(' && Function::exists(variable->getName())) {
+                    const std::string name = variable->getName();
+                    delete variable;
+                    symbol = expectCall(input, name, terminatedBy);
+                } else {
+                    symbol = resolveName(variable);
+                }
+                break;
             }
             default: throw unexpectedCharacter(c);
         }
+
+        // Slices and transposes bind tightest, so A'^2 is (A')^2 and
+        // A[0:3,0:3]' is the transpose of the slice
+        while (terminatedBy == '\'' || terminatedBy == '[') {
+            symbol = terminatedBy == '['
+                ? expectSlice(input, symbol, terminatedBy)
+                : Transpose::of(symbol);
+            if (!nextNonWhitespace(input, terminatedBy))
+                throw unexpectedEndOfFile();
+        }
+
+        // Powers bind tighter than the sign, so -x^2 is -(x^2)
+        symbol = expectPower(input, symbol, terminatedBy);
+        return negative ? symbol->negate() : symbol;
     }
 
     throw unexpectedEndOfFile();
 }
 
+Symbol *Parser::expectPower(std::istream &input, Symbol* base, char &terminatedBy) {
+    if (terminatedBy != '^') return base;
+
+    // The exponent is parsed the same way, which makes ^ right-associative
+    Symbol* exponent = expectOneSymbol(input, terminatedBy);
+    Symbol::value_t value;
+    if (auto* constant = dynamic_cast<Constant*>(exponent)) {
+        value = constant->getValue();
+    } else if (auto* variable = dynamic_cast<Variable*>(exponent)) {
+        // A name is resolved right away if it is defined as a number
+        auto define = mDefines.find(variable->getName());
+        auto* known = define == mDefines.end() ? nullptr : dynamic_cast<const Constant*>(define->second);
+        if (known == nullptr || fabsf(variable->getExponent() - 1.0f) >= FLT_EPSILON) {
+            const std::string name = variable->getName();
+            delete exponent;
+            delete base;
+            throw parseError("Expected the exponent to be a number or a name defined as one, but '"
+                + name + "' is not.");
+        }
+        value = variable->getQuantity() * known->getValue();
+    } else {
+        delete exponent;
+        delete base;
+        throw parseError("Expected the exponent to be a number or a name defined as one.");
+    }
+
+    delete exponent;
+    try {
+        return base->pow(value);
+    } catch (const std::invalid_argument& e) {
+        throw parseError(e.what());
+    }
+}
+
+Symbol *Parser::expectSlice(std::istream &input, Symbol* symbol, char &terminatedBy) {
+    int firstRow, lastRow, firstCol, lastCol;
+    try {
+        expectRange(input, firstRow, lastRow, terminatedBy);
+        if (terminatedBy != ',') throw unexpectedCharacter(terminatedBy);
+        expectRange(input, firstCol, lastCol, terminatedBy);
+        if (terminatedBy != ']') throw unexpectedCharacter(terminatedBy);
+    } catch (...) {
+        delete symbol;
+        throw;
+    }
+
+    try {
+        return Slice::of(symbol, firstRow, lastRow, firstCol, lastCol);
+    } catch (const std::invalid_argument& e) {
+        throw parseError(e.what());
+    }
+}
+
+void Parser::expectRange(std::istream &input, int &first, int &last, char &terminatedBy) {
+    char c;
+    if (!nextNonWhitespace(input, c)) throw unexpectedEndOfFile();
+
+    first = 0;
+    last = Slice::END;
+    if (c != ':') {
+        first = expectIndex(input, c, terminatedBy);
+        if (terminatedBy != ':') {
+            last = first + 1;
+            return;
+        }
+    }
+
+    if (!nextNonWhitespace(input, c)) throw unexpectedEndOfFile();
+    switch (c) {
+        CASE_0_TO_9 {
+            last = expectIndex(input, c, terminatedBy);
+            break;
+        }
+        default: terminatedBy = c;
+    }
+}
+
+int Parser::expectIndex(std::istream &input, char firstDigit, char &terminatedBy) {
+    switch (firstDigit) {
+        CASE_0_TO_9 break;
+        default: throw parseError("Expected an index but found '" + std::string(1, firstDigit) + "'.");
+    }
+
+    Constant* index = expectConstant(input, terminatedBy, firstDigit);
+    const float value = index->getValue();
+    delete index;
+    if (value != (float) (int) value) {
+        throw parseError("Expected an index to be a whole number.");
+    }
+    return (int) value;
+}
+
+Symbol *Parser::expectCall(std::istream &input, const std::string& name, char &terminatedBy) {
+    std::vector<Symbol*> arguments;
+    char argumentEndedWith;
+    do {
+        try {
+            arguments.push_back(expectSymbolsUntilAny(input, [](char c) -> bool {
+                return c == ',' || c == ')';
+            }, argumentEndedWith));
+        } catch (...) {
+            for (auto* argument : arguments) delete argument;
+            throw;
+        }
+    } while (argumentEndedWith == ',');
+
+    Symbol* result;
+    try {
+        result = Function::call(name, std::move(arguments));
+    } catch (const std::invalid_argument& e) {
+        throw parseError(e.what());
+    }
+
+    if (!nextNonWhitespace(input, terminatedBy))
+        throw unexpectedEndOfFile();
+    return result;
+}
+
 Symbol *Parser::expectSymbolsUntil(std::istream &input, char termination) {
     char _;
     return expectSymbolsUntilAny(input,
@@ -204,7 +667,7 @@ Symbol *Parser::expectSymbolsUntilAny(std::istream &input,
                                       char &terminatedBy) {
     auto* symbol = expectOneSymbol(input, terminatedBy);
     while (!predicate(terminatedBy)) {
-        switch (terminatedBy) { // TODO: Add more operators, like power
+        switch (terminatedBy) { // TODO: Add more operators
             case '+': {
                 Symbol* right = expectSymbolsUntilAny(input, predicate, terminatedBy);
                 symbol = *symbol + right;
@@ -217,7 +680,11 @@ Symbol *Parser::expectSymbolsUntilAny(std::istream &input,
             }
             case '*': {
                 Symbol* right = expectOneSymbol(input, terminatedBy);
-                symbol = *symbol * right;
+                if (dynamic_cast<Matrix*>(symbol) && dynamic_cast<Matrix*>(right)) {
+                    symbol = expectMatrixChain(input, symbol, right, terminatedBy);
+                } else {
+                    symbol = *symbol * right;
+                }
                 continue;
             }
             case '(': {
@@ -230,13 +697,20 @@ Symbol *Parser::expectSymbolsUntilAny(std::istream &input,
                 symbol = *symbol / right;
                 continue;
             }
-            case '\'': {
-                if (auto* leftMatrix = dynamic_cast<Matrix*>(symbol)) {
-                    symbol = leftMatrix->transpose();
-                    break;
-                } else {
-                    throw unexpectedCharacter('\'');
-                }
+            case '\\': {
+                // A \ B solves A*X = B for X
+                Symbol* right = expectOneSymbol(input, terminatedBy);
+                symbol = Function::call("solve", {symbol, right});
+                continue;
+            }
+            case '.': {
+                // A .* B and A ./ B work on one element at a time
+                char operation;
+                if (!nextChar(input, operation)) throw unexpectedEndOfFile();
+                if (operation != '*' && operation != '/') throw unexpectedCharacter(operation);
+                Symbol* right = expectOneSymbol(input, terminatedBy);
+                symbol = Function::call(operation == '*' ? "times" : "rdivide", {symbol, right});
+                continue;
             }
             default: throw unexpectedCharacter(terminatedBy);
         }
@@ -247,7 +721,23 @@ Symbol *Parser::expectSymbolsUntilAny(std::istream &input,
     return symbol;
 }
 
-Matrix *Parser::expectMatrix(std::istream &input) {
+Symbol *Parser::expectMatrixChain(std::istream &input, Symbol* first,
+                                  Symbol* second, char &terminatedBy) {
+    // Collect all the matrices that follow so that they can be multiplied
+    // in the cheapest order instead of from left to right.
+    std::vector<Symbol*> chain {first, second};
+    while (terminatedBy == '*') {
+        Symbol* next = expectOneSymbol(input, terminatedBy);
+        if (!dynamic_cast<Matrix*>(next)) {
+            return *MatrixChain::multiply(chain) * next;
+        }
+        chain.push_back(next);
+    }
+
+    return MatrixChain::multiply(chain);
+}
+
+Symbol *Parser::expectMatrix(std::istream &input) {
     std::vector<Symbol*> row {};
 
     char elementEndedWith;
@@ -262,13 +752,7 @@ Matrix *Parser::expectMatrix(std::istream &input) {
     } while (elementEndedWith == ',');
 
     switch (elementEndedWith) {
-        case ']': {
-            Matrix* matrix = Matrix::zero(1, row.size());
-            for (int i = 0; i < row.size(); i++) {
-                matrix->set(0, i, row[i]);
-            }
-            return matrix;
-        }
+        case ']': return matrixOf({row});
         case ';': {
             std::vector<std::vector<Symbol*>> rows{};
             rows.push_back(row);
@@ -281,13 +765,7 @@ Matrix *Parser::expectMatrix(std::istream &input) {
                 throw unexpectedCharacter(elementEndedWith);
             }
 
-            Matrix* matrix = Matrix::zero(rows.size(), row.size());
-            for (int i = 0; i < rows.size(); i++) {
-                for (int j = 0; j < row.size(); j++) {
-                    matrix->set(i, j, rows[i][j]);
-                }
-            }
-            return matrix;
+            return matrixOf(rows);
         }
         default: throw unexpectedCharacter(elementEndedWith);
     }
@@ -295,6 +773,35 @@ Matrix *Parser::expectMatrix(std::istream &input) {
     throw unexpectedEndOfFile();
 }
 
+Symbol *Parser::matrixOf(const std::vector<std::vector<Symbol*>>& rows) {
+    const int cols = (int) rows[0].size();
+
+    // Elements that are matrices themselves make it a matrix of blocks
+    std::vector<Symbol*> elements;
+    bool blocks = false;
+    for (auto& row : rows) {
+        for (auto* element : row) {
+            blocks = blocks || !element->isScalar();
+            elements.push_back(element);
+        }
+    }
+    if (blocks) {
+        try {
+            return BlockMatrix::of((int) rows.size(), cols, std::move(elements));
+        } catch (const InvalidExpression&) {
+            throw parseError("The blocks in every row and column of a matrix must have the same size.");
+        }
+    }
+
+    Matrix* matrix = Matrix::zero(rows.size(), cols);
+    for (int i = 0; i < (int) rows.size(); i++) {
+        for (int j = 0; j < cols; j++) {
+            matrix->set(i, j, rows[i][j]);
+        }
+    }
+    return matrix;
+}
+
 std::vector<Symbol*> Parser::expectMatrixRow(std::istream &input, int columns, char &terminatedBy) {
     std::vector<Symbol*> row {};
 
@@ -310,7 +817,7 @@ std::vector<Symbol*> Parser::expectMatrixRow(std::istream &input, int columns, c
     } while (elementEndedWith == ',');
 
     terminatedBy = elementEndedWith;
-    if (row.size() != columns) {
+    if ((int) row.size() != columns) {
         throw parseError("Expected row to have " + std::to_string(columns) +
             " columns but it only had " + std::to_string(row.size()));
     }
@@ -318,6 +825,29 @@ std::vector<Symbol*> Parser::expectMatrixRow(std::istream &input, int columns, c
     return row;
 }
 
+Symbol *Parser::resolveName(Variable* variable) const {
+    // Matrices have to keep their place in products, which scalars do not.
+    // Names that are not defined yet are only matrices if they are
+    // uppercase and that has been enabled.
+    const std::string name = variable->getName();
+    int rows = Symbol::UNKNOWN, cols = Symbol::UNKNOWN;
+    auto define = mDefines.find(name);
+    if (define != mDefines.end()) {
+        try {
+            rows = define->second->getRows();
+            cols = define->second->getColumns();
+        } catch (const InvalidExpression&) {
+            rows = cols = Symbol::UNKNOWN;
+        }
+        if (rows == 1 && cols == 1) return variable;
+    } else if (!mUppercaseMatrices || name[0] < 'A' || name[0] > 'Z') {
+        return variable;
+    }
+
+    delete variable;
+    return new MatrixSymbol{name, rows, cols};
+}
+
 Variable *Parser::expectVariable(std::istream &input, char &terminatedBy, char firstLetter) {
     std::string name = expectName(input, terminatedBy, firstLetter);
     return new Variable{name};
@@ -9,9 +9,12 @@
 #include <functional>
 #include <vector>
 #include <map>
+#include <set>
 #include "formatter.hpp"
+#include "optimizer.hpp"
 
 class Symbol;
+class ResultCache;
 class Matrix;
 class Variable;
 class Constant;
@@ -26,12 +29,66 @@ public:
 
     Symbol* get(const std::string& key) const;
 
+    /**
+     * Returns a new symbol with the value of a define, or of a single
+     * element, row or column of it, like "A[1,2]", "A[1,:]" or "A[:,2]".
+     * Rows and columns are counted from zero. If the parser is lazy, only
+     * what is needed for the answer is computed.
+     */
+    Symbol* find(const std::string& query);
+
+    /**
+     * If lazy, parse() only reads the statements and leaves the defines as
+     * they were written until they are asked for with find().
+     */
+    void setLazy(bool lazy);
+
+    /**
+     * If enabled, names that are not defined and start with an uppercase
+     * letter, like X, are matrices of unknown size instead of scalars. They
+     * keep their place in products and do not combine with other names.
+     */
+    void setUppercaseMatrices(bool enabled);
+
     std::string format(const Formatter& formatter) const;
 
+    void setCache(ResultCache* cache);
+
+    void define(const std::string& name, Symbol* symbol);
+
+    const std::map<std::string, Symbol*>& getDefines() const;
+
+    Optimizer& getOptimizer();
+
+    const Optimizer& getOptimizer() const;
+
 private:
     std::map<std::string, Symbol*> mDefines;
+    std::map<std::string, std::string> mSources;
+    std::set<std::string> mResolved;
+    std::string mStatement;
+    ResultCache* mCache;
+    bool mLazy;
+    bool mUppercaseMatrices;
+    Optimizer mOptimizer;
     uint32_t mLine, mCol; bool mDone;
 
+    void parseStatements(std::istream& input);
+
+    void loadCached(std::map<std::string, uint64_t>& keys);
+
+    void rewrite();
+
+    void substitute();
+
+    static Symbol* replaceVariable(Symbol* symbol, const std::string& name, const Symbol* value);
+
+    void optimize(std::map<std::string, uint64_t>& keys);
+
+    uint64_t closureKey(const std::string& name,
+                        std::map<std::string, uint64_t>& keys,
+                        std::set<std::string>& visiting);
+
     bool nextChar(std::istream& input, char& c);
 
     bool nextNonWhitespace(std::istream& input, char& c);
@@ -40,16 +97,48 @@ private:
 
     Symbol* expectOneSymbol(std::istream &input, char &terminatedBy);
 
+    Symbol* expectPower(std::istream &input, Symbol* base, char &terminatedBy);
+
+    /**
+     * Parses the rows and columns to take of a symbol, like [0:3, 3], after
+     * the opening bracket.
+     */
+    Symbol* expectSlice(std::istream &input, Symbol* symbol, char &terminatedBy);
+
+    /**
+     * Parses a range like "0:3", "1:", ":" or "3" into the first index and
+     * the index after the last, which is Slice::END for the rest.
+     */
+    void expectRange(std::istream &input, int &first, int &last, char &terminatedBy);
+
+    int expectIndex(std::istream &input, char firstDigit, char &terminatedBy);
+
+    Symbol* expectCall(std::istream &input, const std::string& name, char &terminatedBy);
+
     Symbol* expectSymbolsUntil(std::istream& input, char termination);
 
     Symbol* expectSymbolsUntilAny(std::istream& input, const std::function<bool(char)>& predicate, char &terminatedBy);
 
-    Matrix* expectMatrix(std::istream& input);
+    Symbol* expectMatrixChain(std::istream& input, Symbol* first, Symbol* second, char &terminatedBy);
+
+    Symbol* expectMatrix(std::istream& input);
+
+    /**
+     * A matrix of the parsed elements, or a block matrix if some of them
+     * are matrices.
+     */
+    Symbol* matrixOf(const std::vector<std::vector<Symbol*>>& rows);
 
     std::vector<Symbol*> expectMatrixRow(std::istream& input, int columns, char &terminatedBy);
 
     Variable* expectVariable(std::istream &input, char &terminatedBy, char firstLetter);
 
+    /**
+     * Returns a matrix symbol in place of the variable if the name stands
+     * for a matrix, or the variable as it is otherwise.
+     */
+    Symbol* resolveName(Variable* variable) const;
+
     Constant* expectConstant(std::istream &input, char &terminatedBy, char zeroToNine);
 
     float expectDecimalPart(std::istream& input, char& terminatedBy);
@@ -0,0 +1,131 @@
+#include "pass-manager.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <iomanip>
+#include "governor.hpp"
+#include "pass.hpp"
+#include "symbol.hpp"
+
+PassManager::PassManager() : mPasses{}, mTiming{false}, mBudget{0.0},
+    mStarted{false}, mStart{}, mAttributed{0.0} {}
+
+PassManager::~PassManager() {
+    clear();
+}
+
+void PassManager::add(Pass* pass) {
+    mPasses.push_back(Entry{pass, 0.0, 0, 0});
+}
+
+void PassManager::clear() {
+    for (auto& entry : mPasses) {
+        delete entry.pass;
+    }
+    mPasses.clear();
+}
+
+bool PassManager::isEmpty() const {
+    return mPasses.empty();
+}
+
+void PassManager::setTiming(bool timing) {
+    mTiming = timing;
+}
+
+void PassManager::setTimeBudget(double seconds) {
+    mBudget = seconds;
+}
+
+bool PassManager::isOverBudget() const {
+    return mStarted && mBudget > 0.0 && elapsedSince(mStart) > mBudget;
+}
+
+Symbol* PassManager::run(Symbol* input) {
+    if (mPasses.empty()) return input;
+
+    // The budget covers everything optimized by this manager, starting with
+    // the first expression.
+    if (!mStarted) {
+        mStart = Clock::now();
+        mStarted = true;
+    }
+
+    Governor::check();
+
+    // Decided once per node so that every pass sees both enter and leave.
+    const bool skipExpensive = isOverBudget();
+
+    for (auto& entry : mPasses) {
+        if (skipExpensive && entry.pass->isExpensive()) continue;
+        if (Symbol* replacement = enter(entry, input)) {
+            return replacement;
+        }
+    }
+
+    input = input->replace(
+        [](const Symbol*) -> bool { return true; },
+        [this](Symbol* child) -> Symbol* { return run(child); });
+
+    for (auto& entry : mPasses) {
+        if (skipExpensive && entry.pass->isExpensive()) {
+            entry.skipped++;
+            continue;
+        }
+        input = leave(entry, input);
+    }
+
+    return input;
+}
+
+void PassManager::report(std::ostream& out) const {
+    out << std::left << std::setw(24) << "Pass"
+        << std::right << std::setw(12) << "Calls"
+        << std::setw(12) << "Skipped"
+        << std::setw(14) << "Time (ms)" << std::endl;
+
+    double total = 0.0;
+    for (auto& entry : mPasses) {
+        out << std::left << std::setw(24) << entry.pass->getName()
+            << std::right << std::setw(12) << entry.calls
+            << std::setw(12) << entry.skipped
+            << std::setw(14) << std::fixed << std::setprecision(3)
+            << (entry.seconds * 1000.0) << std::endl;
+        total += entry.seconds;
+    }
+
+    out << std::left << std::setw(48) << "Total"
+        << std::right << std::setw(14) << std::fixed << std::setprecision(3)
+        << (total * 1000.0) << std::endl;
+}
+
+Symbol* PassManager::enter(Entry& entry, Symbol* input) {
+    entry.calls++;
+    if (!mTiming) return entry.pass->enter(input);
+
+    const auto begin = Clock::now();
+    const double attributedBefore = mAttributed;
+    Symbol* result = entry.pass->enter(input);
+    const double exclusive = elapsedSince(begin) - (mAttributed - attributedBefore);
+    entry.seconds += exclusive;
+    mAttributed += exclusive;
+    return result;
+}
+
+Symbol* PassManager::leave(Entry& entry, Symbol* input) {
+    if (!mTiming) return entry.pass->leave(input, *this);
+
+    const auto begin = Clock::now();
+    const double attributedBefore = mAttributed;
+    Symbol* result = entry.pass->leave(input, *this);
+    const double exclusive = elapsedSince(begin) - (mAttributed - attributedBefore);
+    entry.seconds += exclusive;
+    mAttributed += exclusive;
+    return result;
+}
+
+double PassManager::elapsedSince(Clock::time_point begin) const {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+class Symbol;
+class Pass;
+
+class PassManager {
+public:
+    explicit PassManager();
+
+    ~PassManager();
+
+    void add(Pass* pass);
+
+    void clear();
+
+    bool isEmpty() const;
+
+    void setTiming(bool timing);
+
+    void setTimeBudget(double seconds);
+
+    bool isOverBudget() const;
+
+    Symbol* run(Symbol* input);
+
+    void report(std::ostream& out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        Pass* pass;
+        double seconds;
+        long calls;
+        long skipped;
+    };
+
+    Symbol* enter(Entry& entry, Symbol* input);
+
+    Symbol* leave(Entry& entry, Symbol* input);
+
+    double elapsedSince(Clock::time_point begin) const;
+
+    std::vector<Entry> mPasses;
+    bool mTiming;
+    double mBudget;
+    bool mStarted;
+    Clock::time_point mStart;
+
+    // Total time attributed to passes so far. Used to subtract the time
+    // spent in nested runs (started from within a pass) from the outer pass.
+    double mAttributed;
+};
@@ -0,0 +1,19 @@
+#include "pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+Pass::~Pass() = default;
+
+bool Pass::isExpensive() const {
+    return false;
+}
+
+Symbol* Pass::enter(Symbol*) {
+    return nullptr;
+}
+
+Symbol* Pass::leave(Symbol* input, PassManager&) {
+    return input;
+}
@@ -0,0 +1,34 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+class Symbol;
+class PassManager;
+
+/**
+ * A named step of the optimizer. The pass manager walks each expression
+ * bottom-up and gives every pass a chance to rewrite a node both before its
+ * children are optimized (enter) and after (leave).
+ */
+class Pass {
+public:
+    virtual ~Pass();
+
+    virtual const char* getName() const = 0;
+
+    /**
+     * Expensive passes are skipped once the time budget of the pass manager
+     * has been used up.
+     */
+    virtual bool isExpensive() const;
+
+    /**
+     * Returns a replacement for the node (deleting the input) to skip any
+     * further optimization of it, or nullptr to continue as usual.
+     */
+    virtual Symbol* enter(Symbol* input);
+
+    virtual Symbol* leave(Symbol* input, PassManager& manager);
+};
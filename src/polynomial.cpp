@@ -0,0 +1,229 @@
+#include "polynomial.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "symbol.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+
+namespace {
+    // Coefficients that cancel out to this fraction of the largest operand
+    // are rounding errors and are removed.
+    const double CANCELLATION = 1e-9;
+}
+
+bool Polynomial::Monomial::operator<(const Monomial& other) const {
+    auto a = powers.begin(), b = other.powers.begin();
+    while (a != powers.end() && b != other.powers.end()) {
+        if (a->first != b->first) {
+            // The earlier name is only present in one of them
+            return a->first > b->first;
+        }
+        if (a->second != b->second) return a->second < b->second;
+        ++a; ++b;
+    }
+    return a == powers.end() && b != other.powers.end();
+}
+
+bool Polynomial::Monomial::divides(const Monomial& other) const {
+    for (auto& power : powers) {
+        auto found = other.powers.find(power.first);
+        if (found == other.powers.end() || found->second < power.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Polynomial::Polynomial(double constant) : mTerms{} {
+    add(Monomial{}, constant);
+}
+
+Polynomial::Polynomial(const Monomial& monomial, double coefficient) : mTerms{} {
+    add(monomial, coefficient);
+}
+
+Polynomial Polynomial::of(const Symbol* symbol) {
+    if (auto* constant = dynamic_cast<const Constant*>(symbol)) {
+        return Polynomial{constant->getValue()};
+    }
+
+    if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        const float exponent = roundf(variable->getExponent());
+        if (exponent < 0.0f || fabsf(exponent - variable->getExponent()) > 1e-6f) {
+            throw std::invalid_argument("Can't use '" + variable->getName() +
+                "' with a negative or fractional power as a polynomial.");
+        }
+
+        Monomial monomial {};
+        if (exponent > 0.0f) monomial.powers[variable->getName()] = (int) exponent;
+        Polynomial result {};
+        result.add(monomial, variable->getQuantity());
+        return result;
+    }
+
+    if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        Polynomial result {};
+        for (int i = 0; i < sum->getTerms(); i++) {
+            result = result + of(sum->get(i));
+        }
+        return result;
+    }
+
+    if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        Polynomial result {1.0};
+        for (int i = 0; i < product->getFactors(); i++) {
+            result = result * of(product->get(i));
+        }
+        return result;
+    }
+
+    auto* matrix = dynamic_cast<const Matrix*>(symbol);
+    if (matrix != nullptr && matrix->isScalar()) {
+        return of(matrix->get(0, 0));
+    }
+
+    throw std::invalid_argument("Expression is not a polynomial.");
+}
+
+Symbol *Polynomial::toSymbol() const {
+    Symbol* result = nullptr;
+
+    for (auto term = mTerms.rbegin(); term != mTerms.rend(); ++term) {
+        Symbol* symbol = new Constant{(float) term->second};
+        for (auto& power : term->first.powers) {
+            auto* variable = new Variable{power.first};
+            variable->setExponent((float) power.second);
+            symbol = *symbol * variable;
+        }
+        result = result == nullptr ? symbol : *result + symbol;
+    }
+
+    return result == nullptr ? new Constant{0.0f} : result;
+}
+
+bool Polynomial::isZero() const {
+    return mTerms.empty();
+}
+
+Polynomial::Monomial Polynomial::getCommonFactor() const {
+    if (mTerms.empty()) return Monomial{};
+
+    Monomial common {mTerms.begin()->first};
+    for (auto& term : mTerms) {
+        for (auto power = common.powers.begin(); power != common.powers.end();) {
+            auto found = term.first.powers.find(power->first);
+            if (found == term.first.powers.end()) {
+                power = common.powers.erase(power);
+            } else {
+                power->second = std::min(power->second, found->second);
+                ++power;
+            }
+        }
+    }
+    return common;
+}
+
+bool Polynomial::isConstant() const {
+    return mTerms.empty() || (mTerms.size() == 1 && mTerms.begin()->first.powers.empty());
+}
+
+double Polynomial::getConstant() const {
+    auto found = mTerms.find(Monomial{});
+    return found == mTerms.end() ? 0.0 : found->second;
+}
+
+Polynomial Polynomial::operator+(const Polynomial& other) const {
+    Polynomial result {*this};
+    for (auto& term : other.mTerms) {
+        result.add(term.first, term.second);
+    }
+    return result;
+}
+
+Polynomial Polynomial::operator-(const Polynomial& other) const {
+    Polynomial result {*this};
+    for (auto& term : other.mTerms) {
+        result.add(term.first, -term.second);
+    }
+    return result;
+}
+
+Polynomial Polynomial::operator*(const Polynomial& other) const {
+    Polynomial result {};
+    for (auto& left : mTerms) {
+        for (auto& right : other.mTerms) {
+            Monomial monomial {left.first};
+            for (auto& power : right.first.powers) {
+                monomial.powers[power.first] += power.second;
+            }
+            result.add(monomial, left.second * right.second);
+        }
+    }
+    return result;
+}
+
+Polynomial Polynomial::operator-() const {
+    Polynomial result {*this};
+    for (auto& term : result.mTerms) {
+        term.second = -term.second;
+    }
+    return result;
+}
+
+bool Polynomial::divide(const Polynomial& divisor, Polynomial& quotient) const {
+    if (divisor.isZero()) {
+        throw std::invalid_argument("Division by zero.");
+    }
+
+    const auto leading = *divisor.mTerms.rbegin();
+    Polynomial remainder {*this};
+    quotient = Polynomial{};
+
+    // If the division is exact, the leading term of the remainder is always
+    // divisible by the leading term of the divisor.
+    while (!remainder.isZero()) {
+        const auto top = *remainder.mTerms.rbegin();
+        if (!leading.first.divides(top.first)) return false;
+
+        Monomial monomial {top.first};
+        for (auto& power : leading.first.powers) {
+            if ((monomial.powers[power.first] -= power.second) == 0) {
+                monomial.powers.erase(power.first);
+            }
+        }
+
+        Polynomial term {};
+        term.add(monomial, top.second / leading.second);
+        quotient = quotient + term;
+        remainder = remainder - term * divisor;
+        remainder.mTerms.erase(top.first); // Even if rounding left something
+    }
+
+    return true;
+}
+
+void Polynomial::add(const Monomial& monomial, double coefficient) {
+    if (coefficient == 0.0) return;
+
+    auto found = mTerms.find(monomial);
+    if (found == mTerms.end()) {
+        mTerms.emplace(monomial, coefficient);
+        return;
+    }
+
+    const double sum = found->second + coefficient;
+    if (std::fabs(sum) <= CANCELLATION * std::max(std::fabs(found->second), std::fabs(coefficient))) {
+        mTerms.erase(found);
+    } else {
+        found->second = sum;
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+
+class Symbol;
+
+/**
+ * A multivariate polynomial with numeric coefficients. Used where symbols
+ * have to be divided exactly, which the symbols themselves can not do.
+ */
+class Polynomial {
+public:
+    /**
+     * A product of names raised to positive integer powers. Monomials are
+     * ordered lexicographically, with names earlier in the alphabet having
+     * precedence, which makes the largest term the leading term.
+     */
+    struct Monomial {
+        std::map<std::string, int> powers;
+
+        bool operator<(const Monomial& other) const;
+
+        bool divides(const Monomial& other) const;
+    };
+
+    explicit Polynomial(double constant = 0.0);
+
+    explicit Polynomial(const Monomial& monomial, double coefficient = 1.0);
+
+    /**
+     * Converts a symbol to a polynomial. Throws std::invalid_argument if the
+     * symbol is not a polynomial, like a matrix or a negative power.
+     */
+    static Polynomial of(const Symbol* symbol);
+
+    /**
+     * Returns a new symbol with the same value as this polynomial.
+     */
+    Symbol* toSymbol() const;
+
+    bool isZero() const;
+
+    /**
+     * The largest monomial that divides every term.
+     */
+    Monomial getCommonFactor() const;
+
+    bool isConstant() const;
+
+    double getConstant() const;
+
+    Polynomial operator+(const Polynomial& other) const;
+
+    Polynomial operator-(const Polynomial& other) const;
+
+    Polynomial operator*(const Polynomial& other) const;
+
+    Polynomial operator-() const;
+
+    /**
+     * Divides this polynomial by the divisor. Returns true and sets the
+     * quotient if the division is exact, or false if there is a remainder.
+     */
+    bool divide(const Polynomial& divisor, Polynomial& quotient) const;
+
+private:
+    void add(const Monomial& monomial, double coefficient);
+
+    std::map<Monomial, double> mTerms;
+};
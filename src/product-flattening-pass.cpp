@@ -0,0 +1,161 @@
+#include "product-flattening-pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "pass-manager.hpp"
+#include "matrix-chain.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+
+const char* ProductFlatteningPass::getName() const {
+    return "product-flattening";
+}
+
+bool ProductFlatteningPass::isExpensive() const {
+    return true;
+}
+
+Symbol* ProductFlatteningPass::leave(Symbol* input, PassManager& manager) {
+    auto* product = dynamic_cast<Product*>(input);
+    if (product == nullptr) return input;
+
+    // Collapse hierarchies of factors
+    std::vector<Symbol*> factors;
+    flatten(product, factors);
+    delete input;
+
+    // Extract all the constant factors into one number
+    float coefficient = 1.0f;
+    std::vector<Symbol*> scalars, matrices;
+    for (auto* factor : factors) {
+        if (auto* constant = dynamic_cast<Constant*>(factor)) {
+            coefficient *= constant->getValue();
+            delete factor;
+        } else if (auto* variable = dynamic_cast<Variable*>(factor)) {
+            coefficient *= variable->getQuantity();
+            variable->setQuantity(1.0f);
+            scalars.push_back(factor);
+        } else if (factor->isScalar()) {
+            scalars.push_back(factor);
+        } else {
+            matrices.push_back(factor);
+        }
+    }
+
+    if (fabsf(coefficient) < FLT_EPSILON) {
+        for (auto* factor : scalars) delete factor;
+        for (auto* factor : matrices) delete factor;
+        return new Constant{0.0f};
+    }
+
+    if (matrices.empty()) {
+        return multiplyScalars(scalars, coefficient, manager);
+    }
+
+    // Scalars commute with matrices, so the matrices can be multiplied
+    // together first and then scaled.
+    Symbol* result = MatrixChain::multiply(matrices);
+
+    for (auto* scalar : scalars) {
+        result = *result * scalar;
+    }
+
+    if (fabsf(coefficient - 1.0f) >= FLT_EPSILON) {
+        result = *result * new Constant{coefficient};
+    }
+
+    // The elements of the result are new expressions
+    if (dynamic_cast<Product*>(result)) return result;
+    return manager.run(result);
+}
+
+void ProductFlatteningPass::flatten(const Product* product,
+                                    std::vector<Symbol*>& factors) {
+    for (int i = 0; i < product->getFactors(); i++) {
+        if (auto* inner = dynamic_cast<const Product*>(product->get(i))) {
+            flatten(inner, factors);
+        } else {
+            factors.push_back(product->get(i)->copy());
+        }
+    }
+}
+
+Symbol* ProductFlatteningPass::multiplyScalars(std::vector<Symbol*>& scalars,
+                                               float coefficient,
+                                               PassManager& manager) {
+    // Sums go first so that multiplying by them distributes over the terms
+    // instead of appending the sum as another factor. Variables are ordered
+    // by name so that equal products look the same.
+    std::stable_sort(scalars.begin(), scalars.end(),
+        [](const Symbol* left, const Symbol* right) -> bool {
+            const bool leftSum = dynamic_cast<const Sum*>(left) != nullptr;
+            const bool rightSum = dynamic_cast<const Sum*>(right) != nullptr;
+            if (leftSum != rightSum) return leftSum;
+
+            auto* leftVariable = dynamic_cast<const Variable*>(left);
+            auto* rightVariable = dynamic_cast<const Variable*>(right);
+            if (leftVariable && rightVariable) {
+                return leftVariable->getName() < rightVariable->getName();
+            }
+            return leftVariable != nullptr && rightVariable == nullptr;
+        });
+
+    // Merge repeated variables into powers, like a*a = a^2
+    for (std::vector<Symbol*>::size_type i = 1; i < scalars.size();) {
+        auto* previous = dynamic_cast<Variable*>(scalars[i - 1]);
+        auto* current = dynamic_cast<Variable*>(scalars[i]);
+        if (previous && current && previous->getName() == current->getName()) {
+            previous->setExponent(previous->getExponent() + current->getExponent());
+            delete current;
+            scalars.erase(scalars.begin() + i);
+
+            if (fabsf(previous->getExponent()) < FLT_EPSILON) {
+                delete previous;
+                scalars.erase(scalars.begin() + (i - 1));
+                if (i > 1) i--;
+            }
+            continue;
+        }
+        i++;
+    }
+
+    if (scalars.empty()) {
+        return new Constant{coefficient};
+    }
+
+    if (dynamic_cast<Sum*>(scalars[0])) {
+        Symbol* result = scalars[0];
+        for (std::vector<Symbol*>::size_type i = 1; i < scalars.size(); i++) {
+            result = *result * scalars[i];
+        }
+        if (fabsf(coefficient - 1.0f) >= FLT_EPSILON) {
+            result = *result * new Constant{coefficient};
+        }
+
+        // Distributing created new terms that need to be optimized
+        return manager.run(result);
+    }
+
+    if (auto* first = dynamic_cast<Variable*>(scalars[0])) {
+        first->setQuantity(coefficient);
+    } else if (fabsf(coefficient - 1.0f) >= FLT_EPSILON) {
+        scalars.insert(scalars.begin(), new Constant{coefficient});
+    }
+
+    if (scalars.size() == 1) {
+        return scalars[0];
+    }
+
+    auto* result = new Product(scalars[0], scalars[1]);
+    for (std::vector<Symbol*>::size_type i = 2; i < scalars.size(); i++) {
+        result->setFactor(i, scalars[i]);
+    }
+    return result;
+}
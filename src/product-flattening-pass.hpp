@@ -0,0 +1,30 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include "pass.hpp"
+
+class Product;
+
+/**
+ * Collapses nested products, gathers all numeric factors into a single
+ * coefficient, orders the commuting scalar factors and multiplies out
+ * matrices and sums.
+ */
+class ProductFlatteningPass : public Pass {
+public:
+    const char* getName() const override;
+
+    bool isExpensive() const override;
+
+    Symbol* leave(Symbol* input, PassManager& manager) override;
+
+private:
+    static void flatten(const Product* product, std::vector<Symbol*>& factors);
+
+    static Symbol* multiplyScalars(std::vector<Symbol*>& scalars,
+                                   float coefficient, PassManager& manager);
+};
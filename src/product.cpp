@@ -2,10 +2,13 @@
 // Copyright (c) 2020 Emil Forslund. All rights reserved.
 //
 
+#include <stdexcept>
 #include "product.hpp"
 #include "constant.hpp"
 #include "variable.hpp"
 #include "invalid-expression.hpp"
+#include "governor.hpp"
+#include "stats.hpp"
 #include "sum.hpp"
 
 Product::Product() : Symbol{}, mFactors{} {}
@@ -22,6 +25,7 @@ Product::~Product() {
 }
 
 Symbol *Product::copy() const {
+    Stats::symbolCopied();
     auto* copy = new Product{};
     for (auto& factor : mFactors) {
         copy->mFactors.push_back(factor->copy());
@@ -84,8 +88,20 @@ Symbol *Product::negate() {
         }
     }
 
-    for (auto& factor : mFactors) {
-        factor->negate();
+    if (!mFactors.empty()) {
+        // Names of matrices and functions are negated by wrapping them in a
+        // product with -1, which is merged into this one
+        Symbol* first = mFactors.front()->negate();
+        auto* product = dynamic_cast<Product*>(first);
+        if (product == nullptr) {
+            mFactors.front() = first;
+            return this;
+        }
+
+        mFactors.erase(mFactors.begin());
+        mFactors.insert(mFactors.begin(), product->mFactors.begin(), product->mFactors.end());
+        product->mFactors.clear();
+        delete product;
         return this;
     }
 
@@ -104,6 +120,7 @@ Symbol *Product::operator-(Symbol *other) {
 }
 
 Symbol *Product::operator*(Symbol *other) {
+    Governor::check();
     mFactors.push_back(other);
     return this;
 }
@@ -154,7 +171,7 @@ void Product::getDimensions(int &cols, int &rows) const {
         } else if (mFactors[i]->isScalar()) {
             // Do nothing since dimensions doesn't change.
 
-        } else if (cols == mFactors[i]->getRows()) {
+        } else if (isSameSize(cols, mFactors[i]->getRows())) {
             cols = mFactors[i]->getColumns();
 
         } else throw InvalidExpression(); // Dimensions does not match.
@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * Thrown by the Governor when a configured limit is hit. Describes which
+ * resource ran out, how much was used, the limit and the define that was
+ * being computed at the time.
+ */
+class ResourceLimitExceeded : public std::runtime_error {
+public:
+    ResourceLimitExceeded(const std::string& resource, double value,
+                          double limit, const std::string& define) :
+        std::runtime_error{"Limit on " + resource + " exceeded (" +
+            format(value) + " > " + format(limit) + ") while computing '" +
+            define + "'."},
+        mResource{resource}, mValue{value}, mLimit{limit}, mDefine{define} {}
+
+    const std::string& getResource() const {
+        return mResource;
+    }
+
+    double getValue() const {
+        return mValue;
+    }
+
+    double getLimit() const {
+        return mLimit;
+    }
+
+    const std::string& getDefine() const {
+        return mDefine;
+    }
+
+private:
+    static std::string format(double value) {
+        std::string str = std::to_string(value);
+        str.erase(str.find_last_not_of('0') + 1);
+        if (str.back() == '.') str.pop_back();
+        return str;
+    }
+
+    std::string mResource;
+    double mValue, mLimit;
+    std::string mDefine;
+};
@@ -0,0 +1,111 @@
+#include "result-cache.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <unistd.h>
+#include "symbol.hpp"
+#include "serializer.hpp"
+
+namespace {
+    const std::string MAGIC {"SOLVEC"};
+}
+
+ResultCache::ResultCache(std::string directory) :
+    mDirectory{std::move(directory)}, mHits{0}, mMisses{0} {
+    std::filesystem::create_directories(mDirectory);
+}
+
+ResultCache::~ResultCache() = default;
+
+uint64_t ResultCache::hash(const std::string& text, uint64_t seed) {
+    // 64-bit FNV-1a
+    uint64_t hash = seed;
+    for (char c : text) {
+        hash ^= (uint8_t) c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+Symbol* ResultCache::load(uint64_t key) {
+    std::ifstream in(path(key), std::ios::binary);
+    if (!in) {
+        mMisses++;
+        return nullptr;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+
+    if (data.size() <= MAGIC.size()
+    ||  data.compare(0, MAGIC.size(), MAGIC) != 0
+    ||  (uint8_t) data[MAGIC.size()] != VERSION) {
+        mMisses++;
+        return nullptr;
+    }
+
+    const char* cursor = data.data() + MAGIC.size() + 1;
+    const char* end = data.data() + data.size();
+
+    try {
+        Symbol* symbol = Serializer::decode(cursor, end);
+        if (cursor != end) {
+            delete symbol;
+            mMisses++;
+            return nullptr;
+        }
+        mHits++;
+        return symbol;
+    } catch (const std::invalid_argument&) {
+        mMisses++;
+        return nullptr; // Treat corrupt entries as missing
+    }
+}
+
+void ResultCache::store(uint64_t key, const Symbol* symbol) {
+    std::string data {MAGIC};
+    data.push_back((char) VERSION);
+    Serializer::encode(data, symbol);
+
+    // Write to a temporary file first so that concurrent runs never see a
+    // partially written entry. Every process has its own temporary file, so
+    // that two runs storing the same entry do not write into each other.
+    const std::string target = path(key);
+    const std::string temporary = target + "." + std::to_string(getpid()) + ".tmp";
+    std::error_code error;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        out.write(data.data(), data.size());
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporary, target, error);
+    if (error) std::filesystem::remove(temporary, error);
+}
+
+int ResultCache::getHits() const {
+    return mHits;
+}
+
+int ResultCache::getMisses() const {
+    return mMisses;
+}
+
+std::string ResultCache::path(uint64_t key) const {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) key);
+    return (std::filesystem::path(mDirectory) / (std::string(name) + ".sym")).string();
+}
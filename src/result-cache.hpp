@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Symbol;
+
+/**
+ * On-disk cache of optimized defines. Each entry is stored in its own file
+ * in the cache directory, named after the hexadecimal key. The file starts
+ * with the version of the encoding, and entries of any other version are
+ * treated as missing.
+ */
+class ResultCache {
+public:
+    /**
+     * Has to be increased whenever the encoding of the symbols changes.
+     */
+    static const uint8_t VERSION = 2;
+
+    explicit ResultCache(std::string directory);
+
+    ~ResultCache();
+
+    static uint64_t hash(const std::string& text, uint64_t seed = 14695981039346656037ULL);
+
+    Symbol* load(uint64_t key);
+
+    void store(uint64_t key, const Symbol* symbol);
+
+    int getHits() const;
+
+    int getMisses() const;
+
+private:
+    std::string path(uint64_t key) const;
+
+    const std::string mDirectory;
+    int mHits, mMisses;
+};
@@ -0,0 +1,374 @@
+#include "serializer.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "symbol.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "fraction.hpp"
+#include "function.hpp"
+#include "transpose.hpp"
+#include "slice.hpp"
+#include "sparse-matrix.hpp"
+#include "matrix-symbol.hpp"
+#include "block-matrix.hpp"
+
+namespace {
+    const char TAG_CONSTANT  = 'C';
+    const char TAG_VARIABLE  = 'V';
+    const char TAG_MATRIX    = 'M';
+    const char TAG_PRODUCT   = 'P';
+    const char TAG_SUM       = 'S';
+    const char TAG_TRANSPOSE = 'T';
+    const char TAG_FRACTION  = 'Q';
+    const char TAG_FUNCTION  = 'F';
+    const char TAG_SPARSE    = 'R';
+    const char TAG_NAME      = 'N';
+    const char TAG_BLOCKS    = 'B';
+    const char TAG_SLICE     = 'L';
+
+    std::invalid_argument corrupt() {
+        return std::invalid_argument("Serialized symbol is corrupt.");
+    }
+}
+
+void Serializer::encode(std::string& out, const Symbol* symbol) {
+    encodeNode(out, symbol, [](std::string& inner, const Symbol* child) {
+        encode(inner, child);
+    });
+}
+
+bool Serializer::isSame(const Symbol* a, const Symbol* b) {
+    if (a == b) return true;
+
+    std::string first, second;
+    std::vector<const Symbol*> left, right;
+    encodeNode(first, a, [&left](std::string&, const Symbol* child) { left.push_back(child); });
+    encodeNode(second, b, [&right](std::string&, const Symbol* child) { right.push_back(child); });
+    if (first != second || left.size() != right.size()) return false;
+
+    for (std::vector<const Symbol*>::size_type i = 0; i < left.size(); i++) {
+        if (!isSame(left[i], right[i])) return false;
+    }
+    return true;
+}
+
+void Serializer::encodeNode(std::string& out, const Symbol* symbol, const Child& child) {
+    if (auto* constant = dynamic_cast<const Constant*>(symbol)) {
+        out.push_back(TAG_CONSTANT);
+        writeValue(out, constant->getValue());
+    } else if (auto* variable = dynamic_cast<const Variable*>(symbol)) {
+        out.push_back(TAG_VARIABLE);
+        writeString(out, variable->getName());
+        writeValue(out, variable->getQuantity());
+        writeValue(out, variable->getExponent());
+    } else if (auto* name = dynamic_cast<const MatrixSymbol*>(symbol)) {
+        // Sizes are written plus one, so that zero is an unknown size
+        out.push_back(TAG_NAME);
+        writeString(out, name->getName());
+        writeSize(out, (uint32_t) (name->getRows() + 1));
+        writeSize(out, (uint32_t) (name->getColumns() + 1));
+        writeValue(out, name->getExponent());
+    } else if (auto* matrix = dynamic_cast<const Matrix*>(symbol)) {
+        out.push_back(TAG_MATRIX);
+        writeSize(out, matrix->getRows());
+        writeSize(out, matrix->getColumns());
+        for (int i = 0; i < matrix->getRows(); i++) {
+            for (int j = 0; j < matrix->getColumns(); j++) {
+                child(out, matrix->get(i, j));
+            }
+        }
+    } else if (auto* blocks = dynamic_cast<const BlockMatrix*>(symbol)) {
+        // The sizes of the rows and columns of blocks are also plus one
+        out.push_back(TAG_BLOCKS);
+        writeSize(out, blocks->getBlockRows());
+        writeSize(out, blocks->getBlockColumns());
+        for (int i = 0; i < blocks->getBlockRows(); i++) {
+            writeSize(out, (uint32_t) (blocks->getHeight(i) + 1));
+        }
+        for (int j = 0; j < blocks->getBlockColumns(); j++) {
+            writeSize(out, (uint32_t) (blocks->getWidth(j) + 1));
+        }
+        for (int i = 0; i < blocks->getBlockRows(); i++) {
+            for (int j = 0; j < blocks->getBlockColumns(); j++) {
+                child(out, blocks->get(i, j));
+            }
+        }
+    } else if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        out.push_back(TAG_PRODUCT);
+        writeSize(out, product->getFactors());
+        for (int i = 0; i < product->getFactors(); i++) {
+            child(out, product->get(i));
+        }
+    } else if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        out.push_back(TAG_SUM);
+        writeSize(out, sum->getTerms());
+        for (int i = 0; i < sum->getTerms(); i++) {
+            child(out, sum->get(i));
+        }
+    } else if (auto* transpose = dynamic_cast<const Transpose*>(symbol)) {
+        out.push_back(TAG_TRANSPOSE);
+        child(out, transpose->getInner());
+    } else if (auto* slice = dynamic_cast<const Slice*>(symbol)) {
+        // The ends are written plus one, so that zero is the end
+        out.push_back(TAG_SLICE);
+        writeSize(out, slice->getFirstRow());
+        writeSize(out, (uint32_t) (slice->getLastRow() + 1));
+        writeSize(out, slice->getFirstColumn());
+        writeSize(out, (uint32_t) (slice->getLastColumn() + 1));
+        child(out, slice->getInner());
+    } else if (auto* fraction = dynamic_cast<const Fraction*>(symbol)) {
+        out.push_back(TAG_FRACTION);
+        child(out, fraction->getNumerator());
+        child(out, fraction->getDenominator());
+    } else if (auto* function = dynamic_cast<const Function*>(symbol)) {
+        out.push_back(TAG_FUNCTION);
+        writeString(out, function->getName());
+        writeSize(out, function->getArguments());
+        for (int i = 0; i < function->getArguments(); i++) {
+            child(out, function->get(i));
+        }
+    } else if (auto* sparse = dynamic_cast<const SparseMatrix*>(symbol)) {
+        // Row lengths, then the column and value of every non-zero
+        const Sparse& values = sparse->getValues();
+        out.push_back(TAG_SPARSE);
+        writeSize(out, values.getRows());
+        writeSize(out, values.getColumns());
+        for (int i = 0; i < values.getRows(); i++) {
+            writeSize(out, values.getRowStarts()[i + 1] - values.getRowStarts()[i]);
+        }
+        for (std::size_t k = 0; k < values.getNonZeros(); k++) {
+            writeSize(out, values.getColumnIndices()[k]);
+            writeDouble(out, values.getValues()[k]);
+        }
+    } else {
+        throw std::invalid_argument("Input was a symbol of an undefined type.");
+    }
+}
+
+Symbol* Serializer::decode(const char*& cursor, const char* end) {
+    if (cursor >= end) throw corrupt();
+
+    switch (*cursor++) {
+        case TAG_CONSTANT: {
+            return new Constant{readValue(cursor, end)};
+        }
+        case TAG_VARIABLE: {
+            auto* variable = new Variable{readString(cursor, end)};
+            variable->setQuantity(readValue(cursor, end));
+            variable->setExponent(readValue(cursor, end));
+            return variable;
+        }
+        case TAG_NAME: {
+            const std::string name = readString(cursor, end);
+            const int rows = (int) readSize(cursor, end) - 1;
+            const int cols = (int) readSize(cursor, end) - 1;
+            auto* symbol = new MatrixSymbol{name, rows, cols};
+            symbol->setExponent(readValue(cursor, end));
+            return symbol;
+        }
+        case TAG_MATRIX: {
+            const int rows = (int) readSize(cursor, end);
+            const int cols = (int) readSize(cursor, end);
+            auto* matrix = Matrix::zero(rows, cols);
+            try {
+                for (int i = 0; i < rows; i++) {
+                    for (int j = 0; j < cols; j++) {
+                        matrix->set(i, j, decode(cursor, end));
+                    }
+                }
+            } catch (...) {
+                delete matrix;
+                throw;
+            }
+            return matrix;
+        }
+        case TAG_BLOCKS: {
+            const int rows = (int) readSize(cursor, end);
+            const int cols = (int) readSize(cursor, end);
+            std::vector<int> heights, widths;
+            for (int i = 0; i < rows; i++) heights.push_back((int) readSize(cursor, end) - 1);
+            for (int j = 0; j < cols; j++) widths.push_back((int) readSize(cursor, end) - 1);
+
+            std::vector<Symbol*> blocks;
+            try {
+                for (int k = 0; k < rows * cols; k++) {
+                    blocks.push_back(decode(cursor, end));
+                }
+            } catch (...) {
+                for (auto* block : blocks) delete block;
+                throw;
+            }
+            return new BlockMatrix(rows, cols, std::move(blocks),
+                                   std::move(heights), std::move(widths));
+        }
+        case TAG_PRODUCT:
+        case TAG_SUM: {
+            const bool isProduct = cursor[-1] == TAG_PRODUCT;
+            const uint32_t count = readSize(cursor, end);
+            if (count < 2) throw corrupt();
+
+            Symbol* first = decode(cursor, end);
+            Symbol* second;
+            try {
+                second = decode(cursor, end);
+            } catch (...) {
+                delete first;
+                throw;
+            }
+
+            if (isProduct) {
+                auto* product = new Product(first, second);
+                try {
+                    for (uint32_t i = 2; i < count; i++) {
+                        product->setFactor(i, decode(cursor, end));
+                    }
+                } catch (...) {
+                    delete product;
+                    throw;
+                }
+                return product;
+            } else {
+                auto* sum = new Sum(first, second);
+                try {
+                    for (uint32_t i = 2; i < count; i++) {
+                        sum->setTerm(i, decode(cursor, end));
+                    }
+                } catch (...) {
+                    delete sum;
+                    throw;
+                }
+                return sum;
+            }
+        }
+        case TAG_TRANSPOSE: {
+            return Transpose::of(decode(cursor, end));
+        }
+        case TAG_SLICE: {
+            const int firstRow = (int) readSize(cursor, end);
+            const int lastRow = (int) readSize(cursor, end) - 1;
+            const int firstCol = (int) readSize(cursor, end);
+            const int lastCol = (int) readSize(cursor, end) - 1;
+            try {
+                return Slice::of(decode(cursor, end), firstRow, lastRow, firstCol, lastCol);
+            } catch (const std::invalid_argument&) {
+                throw corrupt();
+            }
+        }
+        case TAG_FRACTION: {
+            Symbol* numerator = decode(cursor, end);
+            try {
+                return new Fraction(numerator, decode(cursor, end));
+            } catch (...) {
+                delete numerator;
+                throw;
+            }
+        }
+        case TAG_FUNCTION: {
+            const std::string name = readString(cursor, end);
+            if (!Function::exists(name)) throw corrupt();
+            const uint32_t count = readSize(cursor, end);
+            std::vector<Symbol*> arguments;
+            try {
+                for (uint32_t i = 0; i < count; i++) {
+                    arguments.push_back(decode(cursor, end));
+                }
+            } catch (...) {
+                for (auto* argument : arguments) delete argument;
+                throw;
+            }
+            try {
+                return Function::call(name, std::move(arguments));
+            } catch (const std::invalid_argument&) {
+                throw corrupt(); // Wrong number of arguments
+            }
+        }
+        case TAG_SPARSE: {
+            const int rows = (int) readSize(cursor, end);
+            const int cols = (int) readSize(cursor, end);
+            std::vector<std::size_t> rowStarts {0};
+            for (int i = 0; i < rows; i++) {
+                rowStarts.push_back(rowStarts.back() + readSize(cursor, end));
+            }
+            std::vector<int> columns;
+            std::vector<double> values;
+            for (std::size_t k = 0; k < rowStarts.back(); k++) {
+                const auto col = (int) readSize(cursor, end);
+                if (col >= cols) throw corrupt();
+                columns.push_back(col);
+                values.push_back(readDouble(cursor, end));
+            }
+            return new SparseMatrix(Sparse{rows, cols, std::move(rowStarts),
+                                           std::move(columns), std::move(values)});
+        }
+        default: throw corrupt();
+    }
+}
+
+void Serializer::writeSize(std::string& out, uint32_t size) {
+    while (size >= 0x80) {
+        out.push_back((char) ((size & 0x7F) | 0x80));
+        size >>= 7;
+    }
+    out.push_back((char) size);
+}
+
+void Serializer::writeValue(std::string& out, float value) {
+    char bytes[sizeof(float)];
+    std::memcpy(bytes, &value, sizeof(float));
+    out.append(bytes, sizeof(float));
+}
+
+void Serializer::writeDouble(std::string& out, double value) {
+    char bytes[sizeof(double)];
+    std::memcpy(bytes, &value, sizeof(double));
+    out.append(bytes, sizeof(double));
+}
+
+void Serializer::writeString(std::string& out, const std::string& str) {
+    writeSize(out, str.size());
+    out.append(str);
+}
+
+uint32_t Serializer::readSize(const char*& cursor, const char* end) {
+    uint32_t size = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (cursor >= end) throw corrupt();
+        const auto byte = (uint8_t) *cursor++;
+        size |= (uint32_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return size;
+    }
+    throw corrupt();
+}
+
+float Serializer::readValue(const char*& cursor, const char* end) {
+    if (end - cursor < (long) sizeof(float)) throw corrupt();
+    float value;
+    std::memcpy(&value, cursor, sizeof(float));
+    cursor += sizeof(float);
+    return value;
+}
+
+double Serializer::readDouble(const char*& cursor, const char* end) {
+    if (end - cursor < (long) sizeof(double)) throw corrupt();
+    double value;
+    std::memcpy(&value, cursor, sizeof(double));
+    cursor += sizeof(double);
+    return value;
+}
+
+std::string Serializer::readString(const char*& cursor, const char* end) {
+    const uint32_t length = readSize(cursor, end);
+    if ((uint32_t) (end - cursor) < length) throw corrupt();
+    std::string str {cursor, length};
+    cursor += length;
+    return str;
+}
@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Symbol;
+
+/**
+ * Compact binary encoding of symbol trees. Every node is written as a one
+ * byte tag followed by its payload. Counts and lengths are written as
+ * variable-length integers and values as little-endian floats, except for
+ * the elements of sparse matrices that are kept as doubles.
+ */
+class Serializer {
+public:
+    /**
+     * Called for every child of a node, in the order they are encoded.
+     */
+    typedef std::function<void(std::string&, const Symbol*)> Child;
+
+    static void encode(std::string& out, const Symbol* symbol);
+
+    /**
+     * Writes the tag and payload of a single node, but hands every child to
+     * the given function instead of encoding it. This lets a tree be
+     * identified bottom-up, one node at a time.
+     */
+    static void encodeNode(std::string& out, const Symbol* symbol, const Child& child);
+
+    /**
+     * True if both trees have the same encoding. The trees are compared one
+     * node at a time, stopping at the first difference.
+     */
+    static bool isSame(const Symbol* a, const Symbol* b);
+
+    static Symbol* decode(const char*& cursor, const char* end);
+
+private:
+    static void writeSize(std::string& out, uint32_t size);
+
+    static void writeValue(std::string& out, float value);
+
+    static void writeDouble(std::string& out, double value);
+
+    static void writeString(std::string& out, const std::string& str);
+
+    static uint32_t readSize(const char*& cursor, const char* end);
+
+    static float readValue(const char*& cursor, const char* end);
+
+    static double readDouble(const char*& cursor, const char* end);
+
+    static std::string readString(const char*& cursor, const char* end);
+};
@@ -0,0 +1,185 @@
+#include "slice.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <stdexcept>
+#include "constant.hpp"
+#include "formatter.hpp"
+#include "invalid-expression.hpp"
+#include "matrix.hpp"
+#include "block-matrix.hpp"
+#include "sparse-matrix.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+Slice::Slice(Symbol* inner, int firstRow, int lastRow, int firstCol, int lastCol) :
+    Symbol{}, mInner{inner}, mFirstRow{firstRow}, mLastRow{lastRow},
+    mFirstCol{firstCol}, mLastCol{lastCol} {}
+
+Slice::~Slice() {
+    delete mInner;
+}
+
+Symbol *Slice::of(Symbol* inner, int firstRow, int lastRow, int firstCol, int lastCol) {
+    const int rows = inner->getRows(), cols = inner->getColumns();
+    if (lastRow == END && rows != UNKNOWN) lastRow = rows;
+    if (lastCol == END && cols != UNKNOWN) lastCol = cols;
+
+    if ((lastRow != END && (lastRow <= firstRow || (rows != UNKNOWN && lastRow > rows)))
+    ||  (lastCol != END && (lastCol <= firstCol || (cols != UNKNOWN && lastCol > cols)))) {
+        delete inner;
+        throw std::invalid_argument("Can't take [" + range(firstRow, lastRow) + ", " +
+            range(firstCol, lastCol) + "] of a [" + std::to_string(rows) + ", " +
+            std::to_string(cols) + "] matrix.");
+    }
+
+    inner = BlockMatrix::flatten(inner);
+    if (auto* sparse = dynamic_cast<SparseMatrix*>(inner)) {
+        // Only the elements in the slice are made dense
+        auto* matrix = Matrix::zero(lastRow - firstRow, lastCol - firstCol);
+        for (int i = firstRow; i < lastRow; i++) {
+            for (int j = firstCol; j < lastCol; j++) {
+                const double value = sparse->getValues().get(i, j);
+                if (value != 0.0) matrix->set(i - firstRow, j - firstCol, new Constant{(float) value});
+            }
+        }
+        delete inner;
+        inner = matrix;
+        firstRow = firstCol = 0;
+    }
+
+    if (auto* matrix = dynamic_cast<Matrix*>(inner)) {
+        matrix->slice(firstRow, firstCol, lastRow - firstRow, lastCol - firstCol);
+        if (!matrix->isScalar()) return matrix;
+
+        Symbol* element = matrix->get(0, 0)->copy();
+        delete matrix;
+        return element;
+    }
+
+    // Scalars only have the element at (0, 0)
+    if (inner->isScalar()) {
+        return inner;
+    }
+
+    return new Slice(inner, firstRow, lastRow, firstCol, lastCol);
+}
+
+Symbol *Slice::release() {
+    Symbol* inner = mInner;
+    mInner = nullptr;
+    delete this;
+    return inner;
+}
+
+const Symbol *Slice::getInner() const {
+    return mInner;
+}
+
+int Slice::getFirstRow() const {
+    return mFirstRow;
+}
+
+int Slice::getLastRow() const {
+    return mLastRow;
+}
+
+int Slice::getFirstColumn() const {
+    return mFirstCol;
+}
+
+int Slice::getLastColumn() const {
+    return mLastCol;
+}
+
+Symbol *Slice::copy() const {
+    Stats::symbolCopied();
+    return new Slice(mInner->copy(), mFirstRow, mLastRow, mFirstCol, mLastCol);
+}
+
+Symbol *Slice::negate() {
+    mInner = mInner->negate();
+    return this;
+}
+
+Symbol *Slice::operator+(Symbol *other) {
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *Slice::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *Slice::operator*(Symbol *other) {
+    // The order is kept since the inner symbol may become a matrix
+    return new Product(this, other);
+}
+
+Symbol *Slice::operator/(Symbol *other) {
+    auto* constant = dynamic_cast<Constant*>(other);
+    if (constant == nullptr || constant->isZero()) throw InvalidExpression();
+
+    const value_t inverse = 1.0f / constant->getValue();
+    delete other;
+    return new Product(this, new Constant{inverse});
+}
+
+Symbol *Slice::replace(const std::function<bool(const Symbol *)> &predicate,
+                       const std::function<Symbol *(Symbol *)> &mapper) {
+    if (predicate(mInner)) {
+        mInner = mapper(mInner);
+    }
+
+    if (dynamic_cast<Matrix*>(mInner) || dynamic_cast<BlockMatrix*>(mInner)
+    ||  dynamic_cast<SparseMatrix*>(mInner) || mInner->isScalar()) {
+        const int firstRow = mFirstRow, lastRow = mLastRow;
+        const int firstCol = mFirstCol, lastCol = mLastCol;
+        return of(release(), firstRow, lastRow, firstCol, lastCol);
+    }
+
+    return this;
+}
+
+std::string Slice::format(const Formatter &formatter) const {
+    std::string inner = mInner->format(formatter);
+    if (dynamic_cast<const Product*>(mInner) || dynamic_cast<const Sum*>(mInner)) {
+        inner = formatter.paranthesis(inner);
+    }
+    return formatter.slice(inner, range(mFirstRow, mLastRow), range(mFirstCol, mLastCol));
+}
+
+std::string Slice::range(int first, int last) {
+    if (last == first + 1) return std::to_string(first);
+    if (first == 0 && last == END) return ":";
+    return std::to_string(first) + ":" + (last == END ? "" : std::to_string(last));
+}
+
+bool Slice::isConstant() const {
+    return mInner->isConstant();
+}
+
+bool Slice::isZero() const {
+    return mInner->isZero();
+}
+
+int Slice::getColumns() const {
+    if (mLastCol != END) return mLastCol - mFirstCol;
+    const int cols = mInner->getColumns();
+    return cols == UNKNOWN ? UNKNOWN : cols - mFirstCol;
+}
+
+int Slice::getRows() const {
+    if (mLastRow != END) return mLastRow - mFirstRow;
+    const int rows = mInner->getRows();
+    return rows == UNKNOWN ? UNKNOWN : rows - mFirstRow;
+}
+
+std::set<std::string> Slice::findUndefined() {
+    return mInner->findUndefined();
+}
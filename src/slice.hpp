@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include "symbol.hpp"
+
+/**
+ * Some of the rows and columns of a symbol that is not known to be a matrix
+ * yet, like A[0:3, 3]. As soon as the inner symbol becomes a matrix, this is
+ * replaced by a view of its elements, which are only copied if the view is
+ * modified. Ranges include the first index but not the last.
+ */
+class Slice : public Symbol {
+public:
+    /**
+     * The last index of a range that goes on to the end of the matrix.
+     */
+    static constexpr int END = -1;
+
+    /**
+     * Takes the given rows and columns of the symbol, consuming it. Throws
+     * std::invalid_argument if they are outside of the symbol.
+     */
+    static Symbol* of(Symbol* inner, int firstRow, int lastRow, int firstCol, int lastCol);
+
+    ~Slice() override;
+
+    const Symbol* getInner() const;
+
+    int getFirstRow() const;
+
+    int getLastRow() const;
+
+    int getFirstColumn() const;
+
+    int getLastColumn() const;
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    explicit Slice(Symbol* inner, int firstRow, int lastRow, int firstCol, int lastCol);
+
+    /**
+     * Returns the inner symbol and deletes this.
+     */
+    Symbol* release();
+
+    static std::string range(int first, int last);
+
+    Symbol* mInner;
+    int mFirstRow, mLastRow, mFirstCol, mLastCol;
+};
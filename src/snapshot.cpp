@@ -0,0 +1,125 @@
+#include "snapshot.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "parser.hpp"
+#include "serializer.hpp"
+#include "symbol.hpp"
+
+namespace {
+    const char MAGIC[8] = {'S', 'O', 'L', 'V', 'E', 'S', 'N', 'P'};
+
+    void writeUint32(std::string& out, uint32_t value) {
+        char bytes[sizeof(uint32_t)];
+        std::memcpy(bytes, &value, sizeof(uint32_t));
+        out.append(bytes, sizeof(uint32_t));
+    }
+
+    uint32_t readUint32(const char*& cursor, const char* end) {
+        if (end - cursor < (long) sizeof(uint32_t)) {
+            throw std::invalid_argument("Snapshot is truncated.");
+        }
+        uint32_t value;
+        std::memcpy(&value, cursor, sizeof(uint32_t));
+        cursor += sizeof(uint32_t);
+        return value;
+    }
+}
+
+void Snapshot::save(const Parser& parser, const std::string& filename) {
+    // Layout: magic, version, number of defines and then every define as a
+    // length-prefixed name followed by its encoded symbol.
+    std::string data {MAGIC, sizeof(MAGIC)};
+    writeUint32(data, VERSION);
+    writeUint32(data, parser.getDefines().size());
+
+    for (auto& define : parser.getDefines()) {
+        writeUint32(data, define.first.size());
+        data.append(define.first);
+        Serializer::encode(data, define.second);
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+    if (!out) {
+        throw std::invalid_argument("Could not write snapshot '" + filename + "'.");
+    }
+}
+
+void Snapshot::load(Parser& parser, const std::string& filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("Could not open snapshot '" + filename + "'.");
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::invalid_argument("Snapshot '" + filename + "' is empty.");
+    }
+
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::invalid_argument("Could not map snapshot '" + filename + "'.");
+    }
+
+    const char* begin = static_cast<const char*>(mapped);
+    try {
+        decode(parser, begin, begin + info.st_size);
+    } catch (...) {
+        munmap(mapped, info.st_size);
+        throw;
+    }
+    munmap(mapped, info.st_size);
+}
+
+void Snapshot::decode(Parser& parser, const char* begin, const char* end) {
+    const char* cursor = begin;
+    if (end - cursor < (long) sizeof(MAGIC)
+    ||  std::memcmp(cursor, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("File is not a snapshot.");
+    }
+    cursor += sizeof(MAGIC);
+
+    const uint32_t version = readUint32(cursor, end);
+    if (version != VERSION) {
+        throw std::invalid_argument(
+            "Unsupported snapshot version " + std::to_string(version) +
+            " (expected " + std::to_string(VERSION) + ").");
+    }
+
+    const uint32_t count = readUint32(cursor, end);
+    std::vector<std::pair<std::string, Symbol*>> defines;
+    try {
+        for (uint32_t i = 0; i < count; i++) {
+            const uint32_t length = readUint32(cursor, end);
+            if ((uint32_t) (end - cursor) < length) {
+                throw std::invalid_argument("Snapshot is truncated.");
+            }
+            std::string name {cursor, length};
+            cursor += length;
+
+            Symbol* symbol = Serializer::decode(cursor, end);
+            defines.emplace_back(std::move(name), symbol);
+        }
+    } catch (...) {
+        for (auto& define : defines) delete define.second;
+        throw;
+    }
+
+    for (auto& define : defines) {
+        parser.define(define.first, define.second);
+    }
+}
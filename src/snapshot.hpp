@@ -0,0 +1,32 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Parser;
+
+/**
+ * Versioned binary image of every define in a parser after optimization.
+ * The file is memory-mapped when loaded and the symbols are decoded straight
+ * from the mapping, so nothing has to be parsed or simplified again. The
+ * defines are only handed to the parser once the whole snapshot has been
+ * decoded, so a snapshot that can't be loaded leaves the parser unchanged.
+ */
+class Snapshot {
+public:
+    /**
+     * Has to be increased whenever the encoding of the symbols changes.
+     */
+    static const uint32_t VERSION = 2;
+
+    static void save(const Parser& parser, const std::string& filename);
+
+    static void load(Parser& parser, const std::string& filename);
+
+private:
+    static void decode(Parser& parser, const char* begin, const char* end);
+};
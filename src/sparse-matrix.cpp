@@ -0,0 +1,165 @@
+#include "sparse-matrix.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <stdexcept>
+#include <vector>
+#include "constant.hpp"
+#include "invalid-expression.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+SparseMatrix::SparseMatrix(Sparse values) :
+    Symbol{}, mValues{std::make_shared<const Sparse>(std::move(values))} {}
+
+SparseMatrix::SparseMatrix(std::shared_ptr<const Sparse> values) :
+    Symbol{}, mValues{std::move(values)} {}
+
+const Sparse &SparseMatrix::getValues() const {
+    return *mValues;
+}
+
+Matrix *SparseMatrix::toMatrix() const {
+    auto* matrix = Matrix::zero(mValues->getRows(), mValues->getColumns());
+    const auto& starts = mValues->getRowStarts();
+    for (int i = 0; i < mValues->getRows(); i++) {
+        for (auto k = starts[i]; k < starts[i + 1]; k++) {
+            matrix->set(i, mValues->getColumnIndices()[k],
+                        new Constant{(float) mValues->getValues()[k]});
+        }
+    }
+    return matrix;
+}
+
+Matrix *SparseMatrix::solve(const Matrix* right) const {
+    Matrix* result = mValues->trySolve(right);
+    if (result == nullptr) {
+        throw std::invalid_argument(
+            "Iterative solver did not reach a residual of " +
+            std::to_string(Sparse::getTolerance()) + ".");
+    }
+    return result;
+}
+
+Symbol *SparseMatrix::copy() const {
+    Stats::symbolCopied();
+    return new SparseMatrix(mValues);
+}
+
+Symbol *SparseMatrix::negate() {
+    mValues = std::make_shared<const Sparse>(mValues->scaled(-1.0));
+    return this;
+}
+
+Symbol *SparseMatrix::operator+(Symbol *other) {
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *SparseMatrix::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *SparseMatrix::operator*(Symbol *other) {
+    if (auto* constant = dynamic_cast<Constant*>(other)) {
+        mValues = std::make_shared<const Sparse>(mValues->scaled(constant->getValue()));
+        delete other;
+        return this;
+    }
+
+    auto* matrix = dynamic_cast<Matrix*>(other);
+    if (matrix == nullptr || !matrix->isConstant()) {
+        // The order is kept since the result is a matrix
+        return new Product(this, other);
+    }
+
+    if (matrix->getRows() != getColumns()) {
+        throw dimensionMismatch("multiply", other);
+    }
+
+    auto* result = Matrix::zero(getRows(), matrix->getColumns());
+    std::vector<double> column(getColumns()), product;
+    for (int j = 0; j < matrix->getColumns(); j++) {
+        for (int i = 0; i < getColumns(); i++) {
+            auto* element = dynamic_cast<Constant*>(matrix->get(i, j));
+            if (element == nullptr) {
+                delete result;
+                return new Product(this, other);
+            }
+            column[i] = element->getValue();
+        }
+
+        mValues->multiply(column, product);
+        for (int i = 0; i < getRows(); i++) {
+            if (product[i] != 0.0) result->set(i, j, new Constant{(float) product[i]});
+        }
+    }
+
+    delete this;
+    delete other;
+    return result;
+}
+
+Symbol *SparseMatrix::operator/(Symbol *other) {
+    auto* constant = dynamic_cast<Constant*>(other);
+    if (constant == nullptr || constant->isZero()) throw InvalidExpression();
+
+    mValues = std::make_shared<const Sparse>(mValues->scaled(1.0 / constant->getValue()));
+    delete other;
+    return this;
+}
+
+Symbol *SparseMatrix::replace(const std::function<bool(const Symbol *)> &,
+                              const std::function<Symbol *(Symbol *)> &) {
+    return this; // The elements are numbers
+}
+
+std::string SparseMatrix::format(const Formatter &formatter) const {
+    const Constant zero {0.0f};
+    const std::string formattedZero = zero.format(formatter);
+
+    std::vector<std::string> elements;
+    elements.reserve((std::size_t) getRows() * getColumns());
+    const auto& starts = mValues->getRowStarts();
+    for (int i = 0; i < getRows(); i++) {
+        int col = 0;
+        for (auto k = starts[i]; k < starts[i + 1]; k++, col++) {
+            for (; col < mValues->getColumnIndices()[k]; col++) {
+                elements.push_back(formattedZero);
+            }
+            const Constant element {(float) mValues->getValues()[k]};
+            elements.push_back(element.format(formatter));
+        }
+        for (; col < getColumns(); col++) {
+            elements.push_back(formattedZero);
+        }
+    }
+
+    return formatter.matrix(getRows(), getColumns(), elements);
+}
+
+bool SparseMatrix::isConstant() const {
+    return true;
+}
+
+bool SparseMatrix::isZero() const {
+    return mValues->getNonZeros() == 0;
+}
+
+int SparseMatrix::getColumns() const {
+    return mValues->getColumns();
+}
+
+int SparseMatrix::getRows() const {
+    return mValues->getRows();
+}
+
+std::set<std::string> SparseMatrix::findUndefined() {
+    return {};
+}
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <memory>
+#include "symbol.hpp"
+#include "sparse.hpp"
+
+class Matrix;
+
+/**
+ * A numeric matrix that is loaded from a file instead of written as a
+ * literal, and is too large to keep a symbol for every element. Copies
+ * share the elements. It can be multiplied with numbers and numeric
+ * matrices and be the left side of solve(A, b) or A \ b, which is solved
+ * iteratively.
+ */
+class SparseMatrix : public Symbol {
+public:
+    explicit SparseMatrix(Sparse values);
+
+    const Sparse& getValues() const;
+
+    /**
+     * Returns a new matrix with every element, including the zeros.
+     */
+    Matrix* toMatrix() const;
+
+    /**
+     * Returns a new matrix X such that this * X = right. Throws
+     * std::invalid_argument if the solver does not converge.
+     */
+    Matrix* solve(const Matrix* right) const;
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    explicit SparseMatrix(std::shared_ptr<const Sparse> values);
+
+    std::shared_ptr<const Sparse> mValues;
+};
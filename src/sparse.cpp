@@ -0,0 +1,437 @@
+#include "sparse.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "constant.hpp"
+#include "governor.hpp"
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+namespace {
+    const char MAGIC[8] = {'S', 'O', 'L', 'V', 'E', 'S', 'P', 'M'};
+
+    // Numeric matrices smaller than this are factorized densely
+    const int MIN_SIZE = 256;
+
+    // Non-zeros per row that make it worth handing rows to another thread
+    const long GRAIN_WORK = 1L << 16;
+
+    template <typename T>
+    void write(std::ofstream& out, T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T read(std::ifstream& in, const std::string& filename) {
+        T value;
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+            throw std::invalid_argument("Matrix file '" + filename + "' is truncated.");
+        }
+        return value;
+    }
+
+    double dot(const std::vector<double>& a, const std::vector<double>& b) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < a.size(); i++) sum += a[i] * b[i];
+        return sum;
+    }
+
+    double norm(const std::vector<double>& a) {
+        return std::sqrt(dot(a, a));
+    }
+
+    std::vector<double> precondition(const std::vector<double>& inverseDiagonal,
+                                     const std::vector<double>& vector) {
+        std::vector<double> result(vector.size());
+        for (std::size_t i = 0; i < vector.size(); i++) result[i] = inverseDiagonal[i] * vector[i];
+        return result;
+    }
+}
+
+Sparse::Sparse(int rows, int cols, std::vector<Entry> entries) :
+    mRows{rows}, mCols{cols}, mRowStarts(rows + 1, 0), mColumns{}, mValues{} {
+
+    for (auto& entry : entries) {
+        if (entry.row < 0 || entry.row >= rows || entry.col < 0 || entry.col >= cols) {
+            throw std::invalid_argument(
+                "Entry (" + std::to_string(entry.row) + ", " + std::to_string(entry.col) +
+                ") is outside of a [" + std::to_string(rows) + ", " +
+                std::to_string(cols) + "] matrix.");
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.row != b.row ? a.row < b.row : a.col < b.col;
+    });
+
+    mColumns.reserve(entries.size());
+    mValues.reserve(entries.size());
+    for (std::size_t i = 0; i < entries.size();) {
+        const Entry& first = entries[i];
+        double value = 0.0;
+        for (; i < entries.size() && entries[i].row == first.row
+                                  && entries[i].col == first.col; i++) {
+            value += entries[i].value;
+        }
+        if (value != 0.0) {
+            mColumns.push_back(first.col);
+            mValues.push_back(value);
+            mRowStarts[first.row + 1]++;
+        }
+    }
+
+    for (int i = 0; i < rows; i++) {
+        mRowStarts[i + 1] += mRowStarts[i];
+    }
+}
+
+Sparse::Sparse(int rows, int cols,
+               std::vector<std::size_t> rowStarts,
+               std::vector<int> columns,
+               std::vector<double> values) :
+    mRows{rows}, mCols{cols},
+    mRowStarts{std::move(rowStarts)},
+    mColumns{std::move(columns)},
+    mValues{std::move(values)} {
+
+    if ((int) mRowStarts.size() != rows + 1 || mColumns.size() != mValues.size()
+    ||  mRowStarts.back() != mValues.size()) {
+        throw std::invalid_argument("Sparse matrix rows does not match its elements.");
+    }
+}
+
+Sparse Sparse::of(const Matrix* matrix) {
+    std::vector<Entry> entries;
+    for (int i = 0; i < matrix->getRows(); i++) {
+        for (int j = 0; j < matrix->getColumns(); j++) {
+            auto* constant = dynamic_cast<const Constant*>(matrix->get(i, j));
+            if (constant == nullptr) {
+                throw std::invalid_argument("Matrix is not numeric.");
+            }
+            if (!constant->isZero()) {
+                entries.push_back({i, j, constant->getValue()});
+            }
+        }
+    }
+    return Sparse{matrix->getRows(), matrix->getColumns(), std::move(entries)};
+}
+
+bool Sparse::suits(const Matrix* matrix) {
+    const long n = matrix->getRows();
+    if (n < MIN_SIZE || n != matrix->getColumns()) return false;
+
+    // At most a tenth of the elements may be non-zero
+    long nonZeros = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (!matrix->get(i, j)->isZero() && ++nonZeros * 10 > n * n) return false;
+        }
+    }
+    return true;
+}
+
+Sparse Sparse::load(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        throw std::invalid_argument("Could not open matrix file '" + filename + "'.");
+    }
+
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(MAGIC)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::invalid_argument("File '" + filename + "' is not a sparse matrix.");
+    }
+
+    const auto version = read<uint32_t>(in, filename);
+    if (version != VERSION) {
+        throw std::invalid_argument(
+            "Unsupported matrix file version " + std::to_string(version) +
+            " (expected " + std::to_string(VERSION) + ").");
+    }
+
+    const auto rows = read<uint32_t>(in, filename);
+    const auto cols = read<uint32_t>(in, filename);
+    const auto count = read<uint64_t>(in, filename);
+
+    std::vector<Entry> entries;
+    entries.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        const auto row = read<uint32_t>(in, filename);
+        const auto col = read<uint32_t>(in, filename);
+        entries.push_back({(int) row, (int) col, read<double>(in, filename)});
+    }
+
+    return Sparse{(int) rows, (int) cols, std::move(entries)};
+}
+
+void Sparse::save(const Sparse& matrix, const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(MAGIC, sizeof(MAGIC));
+    write<uint32_t>(out, VERSION);
+    write<uint32_t>(out, matrix.mRows);
+    write<uint32_t>(out, matrix.mCols);
+    write<uint64_t>(out, matrix.mValues.size());
+
+    for (int i = 0; i < matrix.mRows; i++) {
+        for (auto k = matrix.mRowStarts[i]; k < matrix.mRowStarts[i + 1]; k++) {
+            write<uint32_t>(out, i);
+            write<uint32_t>(out, matrix.mColumns[k]);
+            write<double>(out, matrix.mValues[k]);
+        }
+    }
+
+    if (!out) {
+        throw std::invalid_argument("Could not write matrix file '" + filename + "'.");
+    }
+}
+
+int Sparse::getRows() const {
+    return mRows;
+}
+
+int Sparse::getColumns() const {
+    return mCols;
+}
+
+std::size_t Sparse::getNonZeros() const {
+    return mValues.size();
+}
+
+double Sparse::get(int row, int col) const {
+    const auto begin = mColumns.begin() + mRowStarts[row];
+    const auto end = mColumns.begin() + mRowStarts[row + 1];
+    const auto found = std::lower_bound(begin, end, col);
+    return found != end && *found == col ? mValues[found - mColumns.begin()] : 0.0;
+}
+
+const std::vector<std::size_t> &Sparse::getRowStarts() const {
+    return mRowStarts;
+}
+
+const std::vector<int> &Sparse::getColumnIndices() const {
+    return mColumns;
+}
+
+const std::vector<double> &Sparse::getValues() const {
+    return mValues;
+}
+
+Sparse Sparse::scaled(double factor) const {
+    Sparse result {*this};
+    for (auto& value : result.mValues) value *= factor;
+    return result;
+}
+
+bool Sparse::isSymmetric() const {
+    if (mRows != mCols) return false;
+    for (int i = 0; i < mRows; i++) {
+        for (auto k = mRowStarts[i]; k < mRowStarts[i + 1]; k++) {
+            if (get(mColumns[k], i) != mValues[k]) return false;
+        }
+    }
+    return true;
+}
+
+void Sparse::multiply(const std::vector<double>& vector, std::vector<double>& result) const {
+    result.resize(mRows);
+    const long perRow = std::max(1L, (long) (mValues.size() / std::max(1, mRows)));
+
+    Parallel::forRange(0, mRows, (int) std::max(1L, GRAIN_WORK / perRow),
+            [this, &vector, &result](int from, int to) {
+        for (int i = from; i < to; i++) {
+            double sum = 0.0;
+            for (auto k = mRowStarts[i]; k < mRowStarts[i + 1]; k++) {
+                sum += mValues[k] * vector[mColumns[k]];
+            }
+            result[i] = sum;
+        }
+    });
+}
+
+Sparse::Convergence Sparse::solve(const std::vector<double>& right,
+                                  std::vector<double>& solution) const {
+    if (mRows != mCols) {
+        throw std::invalid_argument(
+            "Can't solve a non-square [" + std::to_string(mRows) + ", " +
+            std::to_string(mCols) + "] system.");
+    }
+
+    // The conjugate gradient method needs a symmetric matrix, and is only
+    // known to converge if it is also positive definite.
+    if (isSymmetric()) {
+        std::vector<double> guess {solution};
+        Convergence result = conjugateGradient(right, solution);
+        if (result.converged) return result;
+        solution = std::move(guess);
+    }
+    return biconjugateGradientStabilized(right, solution);
+}
+
+Sparse::Convergence Sparse::conjugateGradient(const std::vector<double>& right,
+                                              std::vector<double>& solution) const {
+    Trace::Span span {"conjugate-gradient"};
+    const std::vector<double> inverseDiagonal = jacobi();
+    const double goal = sTolerance * norm(right);
+
+    std::vector<double> residual {right}, product;
+    multiply(solution, product);
+    for (int i = 0; i < mRows; i++) residual[i] -= product[i];
+
+    std::vector<double> direction = precondition(inverseDiagonal, residual);
+    double alignment = dot(residual, direction);
+    double distance = norm(residual);
+
+    int iteration = 0;
+    for (; distance > goal && iteration < maxIterations(); iteration++) {
+        Governor::check();
+        multiply(direction, product);
+
+        const double curvature = dot(direction, product);
+        if (curvature <= 0.0) break; // Not positive definite
+
+        const double step = alignment / curvature;
+        for (int i = 0; i < mRows; i++) {
+            solution[i] += step * direction[i];
+            residual[i] -= step * product[i];
+        }
+        distance = norm(residual);
+
+        const std::vector<double> preconditioned = precondition(inverseDiagonal, residual);
+        const double next = dot(residual, preconditioned);
+        const double beta = next / alignment;
+        alignment = next;
+        for (int i = 0; i < mRows; i++) {
+            direction[i] = preconditioned[i] + beta * direction[i];
+        }
+    }
+
+    span.arg("iterations", iteration);
+    return {iteration, distance / std::max(norm(right), 1e-300), distance <= goal};
+}
+
+Sparse::Convergence Sparse::biconjugateGradientStabilized(
+        const std::vector<double>& right, std::vector<double>& solution) const {
+    Trace::Span span {"bicgstab"};
+    const std::vector<double> inverseDiagonal = jacobi();
+    const double goal = sTolerance * norm(right);
+
+    std::vector<double> residual {right}, product;
+    multiply(solution, product);
+    for (int i = 0; i < mRows; i++) residual[i] -= product[i];
+
+    const std::vector<double> shadow {residual};
+    std::vector<double> direction(mRows, 0.0), v(mRows, 0.0), s(mRows), t;
+    double rho = 1.0, alpha = 1.0, omega = 1.0;
+    double distance = norm(residual);
+
+    int iteration = 0;
+    for (; distance > goal && iteration < maxIterations(); iteration++) {
+        Governor::check();
+
+        const double nextRho = dot(shadow, residual);
+        if (nextRho == 0.0 || omega == 0.0) break; // Broken down
+
+        const double beta = (nextRho / rho) * (alpha / omega);
+        rho = nextRho;
+        for (int i = 0; i < mRows; i++) {
+            direction[i] = residual[i] + beta * (direction[i] - omega * v[i]);
+        }
+
+        const std::vector<double> y = precondition(inverseDiagonal, direction);
+        multiply(y, v);
+        alpha = rho / dot(shadow, v);
+        for (int i = 0; i < mRows; i++) s[i] = residual[i] - alpha * v[i];
+
+        if (norm(s) <= goal) {
+            for (int i = 0; i < mRows; i++) solution[i] += alpha * y[i];
+            distance = norm(s);
+            iteration++;
+            break;
+        }
+
+        const std::vector<double> z = precondition(inverseDiagonal, s);
+        multiply(z, t);
+        const double tt = dot(t, t);
+        omega = tt == 0.0 ? 0.0 : dot(t, s) / tt;
+
+        for (int i = 0; i < mRows; i++) {
+            solution[i] += alpha * y[i] + omega * z[i];
+            residual[i] = s[i] - omega * t[i];
+        }
+        distance = norm(residual);
+    }
+
+    span.arg("iterations", iteration);
+    return {iteration, distance / std::max(norm(right), 1e-300), distance <= goal};
+}
+
+Matrix *Sparse::trySolve(const Matrix* right) const {
+    if (right->getRows() != mRows) {
+        throw std::invalid_argument(
+            "Can't solve a [" + std::to_string(mRows) + ", " +
+            std::to_string(mCols) + "] system for a [" +
+            std::to_string(right->getRows()) + ", " +
+            std::to_string(right->getColumns()) + "] right-hand side.");
+    }
+
+    auto* result = Matrix::zero(mCols, right->getColumns());
+    std::vector<double> column(mRows), solution;
+    for (int j = 0; j < right->getColumns(); j++) {
+        for (int i = 0; i < mRows; i++) {
+            auto* constant = dynamic_cast<const Constant*>(right->get(i, j));
+            if (constant == nullptr) {
+                delete result;
+                throw std::invalid_argument("Right-hand side is not numeric.");
+            }
+            column[i] = constant->getValue();
+        }
+
+        solution.assign(mCols, 0.0);
+        if (!solve(column, solution).converged) {
+            delete result;
+            return nullptr;
+        }
+
+        // Values this small are what is left of zeros within the tolerance
+        double largest = 0.0;
+        for (double value : solution) largest = std::max(largest, std::fabs(value));
+        for (int i = 0; i < mCols; i++) {
+            if (std::fabs(solution[i]) > sTolerance * largest) {
+                result->set(i, j, new Constant{(float) solution[i]});
+            }
+        }
+    }
+    return result;
+}
+
+void Sparse::setTolerance(double tolerance) {
+    sTolerance = tolerance;
+}
+
+double Sparse::getTolerance() {
+    return sTolerance;
+}
+
+void Sparse::setMaxIterations(int iterations) {
+    sMaxIterations = iterations;
+}
+
+int Sparse::maxIterations() const {
+    return sMaxIterations > 0 ? sMaxIterations : std::max(mRows, 100);
+}
+
+std::vector<double> Sparse::jacobi() const {
+    std::vector<double> result(mRows, 1.0);
+    for (int i = 0; i < mRows; i++) {
+        const double diagonal = get(i, i);
+        if (diagonal != 0.0) result[i] = 1.0 / diagonal;
+    }
+    return result;
+}
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Matrix;
+
+/**
+ * A numeric matrix in compressed sparse row form, where only the non-zero
+ * elements are stored, so memory grows with the number of non-zeros instead
+ * of with the square of the size. Linear systems are solved iteratively
+ * with the conjugate gradient method if the matrix is symmetric, or with
+ * BiCGSTAB otherwise, both preconditioned with the inverse of the diagonal.
+ */
+class Sparse {
+public:
+    static const uint32_t VERSION = 1;
+
+    struct Entry {
+        int row;
+        int col;
+        double value;
+    };
+
+    struct Convergence {
+        int iterations;
+        double residual;
+        bool converged;
+    };
+
+    /**
+     * Entries may come in any order. Entries at the same position are added
+     * together, the same way as when a system is assembled from elements.
+     */
+    explicit Sparse(int rows, int cols, std::vector<Entry> entries);
+
+    explicit Sparse(int rows, int cols,
+                    std::vector<std::size_t> rowStarts,
+                    std::vector<int> columns,
+                    std::vector<double> values);
+
+    /**
+     * The non-zero elements of a matrix where every element is a number.
+     */
+    static Sparse of(const Matrix* matrix);
+
+    /**
+     * True if a numeric matrix is large and has few enough non-zeros for an
+     * iterative solver to be faster than a dense factorization.
+     */
+    static bool suits(const Matrix* matrix);
+
+    /**
+     * Reads a matrix from a binary file. The layout is the magic bytes
+     * SOLVESPM, the version, the number of rows and columns as 32-bit
+     * integers and the number of entries as a 64-bit integer, followed by
+     * every entry as a 32-bit row, a 32-bit column and a 64-bit float, all
+     * in the byte order of the machine.
+     */
+    static Sparse load(const std::string& filename);
+
+    static void save(const Sparse& matrix, const std::string& filename);
+
+    int getRows() const;
+
+    int getColumns() const;
+
+    std::size_t getNonZeros() const;
+
+    double get(int row, int col) const;
+
+    const std::vector<std::size_t>& getRowStarts() const;
+
+    const std::vector<int>& getColumnIndices() const;
+
+    const std::vector<double>& getValues() const;
+
+    Sparse scaled(double factor) const;
+
+    bool isSymmetric() const;
+
+    /**
+     * Sets result to this * vector. The rows are split between threads.
+     */
+    void multiply(const std::vector<double>& vector, std::vector<double>& result) const;
+
+    /**
+     * Solves this * solution = right, starting from the given solution.
+     */
+    Convergence solve(const std::vector<double>& right, std::vector<double>& solution) const;
+
+    Convergence conjugateGradient(const std::vector<double>& right,
+                                  std::vector<double>& solution) const;
+
+    Convergence biconjugateGradientStabilized(const std::vector<double>& right,
+                                              std::vector<double>& solution) const;
+
+    /**
+     * Returns a new matrix X such that this * X = right, or nullptr if any
+     * column did not converge.
+     */
+    Matrix* trySolve(const Matrix* right) const;
+
+    /**
+     * The largest residual, relative to the right-hand side, that counts as
+     * solved. Defaults to 1e-10.
+     */
+    static void setTolerance(double tolerance);
+
+    static double getTolerance();
+
+    /**
+     * Iterations before giving up. Zero, the default, allows as many
+     * iterations as there are unknowns, but at least 100.
+     */
+    static void setMaxIterations(int iterations);
+
+private:
+    int maxIterations() const;
+
+    /**
+     * The inverse of the diagonal, where rows without a diagonal are kept.
+     */
+    std::vector<double> jacobi() const;
+
+    int mRows, mCols;
+    std::vector<std::size_t> mRowStarts;
+    std::vector<int> mColumns;
+    std::vector<double> mValues;
+
+    static inline double sTolerance = 1e-10;
+    static inline int sMaxIterations = 0;
+};
@@ -0,0 +1,309 @@
+#include "stats.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include "symbol.hpp"
+#include "matrix.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+#include "transpose.hpp"
+#include "slice.hpp"
+#include "fraction.hpp"
+#include "function.hpp"
+
+namespace {
+    struct PhaseTime {
+        std::string name;
+        double seconds;
+        long allocations;
+        long bytes;
+        long peakBytes;
+        long liveBytes;
+    };
+
+    struct DefineSize {
+        std::string name;
+        long before;
+        long after;
+        long allocations;
+        long bytes;
+        long peakBytes;
+    };
+
+    struct Counters {
+        bool enabled = false;
+        long symbolsCreated = 0;
+        long symbolsLive = 0;
+        long symbolsPeak = 0;
+        long copies = 0;
+        long allocations = 0;
+        long bytesAllocated = 0;
+        long bytesLive = 0;
+        long bytesPeak = 0;
+        long scopePeak = 0;
+        std::vector<PhaseTime> phases;
+        std::vector<DefineSize> defines;
+    };
+
+    Counters& counters() {
+        static Counters instance;
+        return instance;
+    }
+}
+
+Stats::Allocations::Allocations() : mOpen{true} {
+    auto& c = counters();
+    mCount = c.allocations;
+    mBytes = c.bytesAllocated;
+    mOuterPeak = c.scopePeak;
+    mPeak = 0;
+    c.scopePeak = c.bytesLive;
+}
+
+Stats::Allocations::~Allocations() {
+    close();
+}
+
+void Stats::Allocations::close() {
+    if (!mOpen) return;
+    auto& c = counters();
+    mOpen = false;
+    mCount = c.allocations - mCount;
+    mBytes = c.bytesAllocated - mBytes;
+    mPeak = c.scopePeak;
+    c.scopePeak = std::max(mOuterPeak, mPeak);
+}
+
+long Stats::Allocations::getCount() const {
+    return mOpen ? counters().allocations - mCount : mCount;
+}
+
+long Stats::Allocations::getBytes() const {
+    return mOpen ? counters().bytesAllocated - mBytes : mBytes;
+}
+
+long Stats::Allocations::getPeakBytes() const {
+    // While open, this is the innermost scope since nested scopes are closed
+    // in reverse order.
+    return mOpen ? counters().scopePeak : mPeak;
+}
+
+Stats::Phase::Phase(const char* name) :
+    mName{name}, mBegin{std::chrono::steady_clock::now()}, mAllocations{} {}
+
+Stats::Phase::~Phase() {
+    mAllocations.close();
+
+    auto& c = counters();
+    if (!c.enabled) return;
+
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - mBegin).count();
+
+    for (auto& phase : c.phases) {
+        if (phase.name == mName) {
+            phase.seconds += seconds;
+            phase.allocations += mAllocations.getCount();
+            phase.bytes += mAllocations.getBytes();
+            phase.peakBytes = std::max(phase.peakBytes, mAllocations.getPeakBytes());
+            phase.liveBytes = c.bytesLive;
+            return;
+        }
+    }
+    c.phases.push_back(PhaseTime{mName, seconds, mAllocations.getCount(),
+        mAllocations.getBytes(), mAllocations.getPeakBytes(), c.bytesLive});
+}
+
+void Stats::enable() {
+    counters().enabled = true;
+}
+
+bool Stats::isEnabled() {
+    return counters().enabled;
+}
+
+void Stats::symbolCreated() {
+    auto& c = counters();
+    c.symbolsCreated++;
+    if (++c.symbolsLive > c.symbolsPeak) {
+        c.symbolsPeak = c.symbolsLive;
+    }
+}
+
+void Stats::symbolDestroyed() {
+    counters().symbolsLive--;
+}
+
+void Stats::symbolCopied() {
+    counters().copies++;
+}
+
+void Stats::bytesAllocated(std::size_t bytes) {
+    auto& c = counters();
+    c.allocations++;
+    c.bytesAllocated += (long) bytes;
+    c.bytesLive += (long) bytes;
+    if (c.bytesLive > c.bytesPeak) {
+        c.bytesPeak = c.bytesLive;
+    }
+    if (c.bytesLive > c.scopePeak) {
+        c.scopePeak = c.bytesLive;
+    }
+}
+
+void Stats::bytesFreed(std::size_t bytes) {
+    counters().bytesLive -= (long) bytes;
+}
+
+void Stats::recordDefine(const std::string& name, long before, long after,
+                         const Allocations& allocations) {
+    auto& c = counters();
+    if (c.enabled) {
+        c.defines.push_back(DefineSize{name, before, after, allocations.getCount(),
+            allocations.getBytes(), allocations.getPeakBytes()});
+    }
+}
+
+long Stats::countNodes(const Symbol* symbol) {
+    long count = 1;
+    if (auto* matrix = dynamic_cast<const Matrix*>(symbol)) {
+        for (int i = 0; i < matrix->getRows(); i++) {
+            for (int j = 0; j < matrix->getColumns(); j++) {
+                count += countNodes(matrix->get(i, j));
+            }
+        }
+    } else if (auto* blocks = dynamic_cast<const BlockMatrix*>(symbol)) {
+        for (int i = 0; i < blocks->getBlockRows(); i++) {
+            for (int j = 0; j < blocks->getBlockColumns(); j++) {
+                count += countNodes(blocks->get(i, j));
+            }
+        }
+    } else if (auto* product = dynamic_cast<const Product*>(symbol)) {
+        for (int i = 0; i < product->getFactors(); i++) {
+            count += countNodes(product->get(i));
+        }
+    } else if (auto* sum = dynamic_cast<const Sum*>(symbol)) {
+        for (int i = 0; i < sum->getTerms(); i++) {
+            count += countNodes(sum->get(i));
+        }
+    } else if (auto* transpose = dynamic_cast<const Transpose*>(symbol)) {
+        count += countNodes(transpose->getInner());
+    } else if (auto* slice = dynamic_cast<const Slice*>(symbol)) {
+        count += countNodes(slice->getInner());
+    } else if (auto* fraction = dynamic_cast<const Fraction*>(symbol)) {
+        count += countNodes(fraction->getNumerator());
+        count += countNodes(fraction->getDenominator());
+    } else if (auto* function = dynamic_cast<const Function*>(symbol)) {
+        for (int i = 0; i < function->getArguments(); i++) {
+            count += countNodes(function->get(i));
+        }
+    }
+    return count;
+}
+
+long Stats::getLiveSymbols() {
+    return counters().symbolsLive;
+}
+
+long Stats::getLiveBytes() {
+    return counters().bytesLive;
+}
+
+long Stats::getPeakLiveBytes() {
+    return counters().bytesPeak;
+}
+
+void Stats::resetPeaks() {
+    auto& c = counters();
+    c.symbolsPeak = c.symbolsLive;
+    c.bytesPeak = c.bytesLive;
+}
+
+bool Stats::isTrackingAllAllocations() {
+#ifdef SOLVE_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Stats::report(std::ostream& out, bool json) {
+    auto& c = counters();
+
+    if (json) {
+        out << "{\"phases\":{";
+        for (std::vector<PhaseTime>::size_type i = 0; i < c.phases.size(); i++) {
+            if (i > 0) out << ",";
+            out << "\"" << c.phases[i].name << "\":{"
+                << "\"seconds\":" << c.phases[i].seconds << ","
+                << "\"allocations\":" << c.phases[i].allocations << ","
+                << "\"bytesAllocated\":" << c.phases[i].bytes << ","
+                << "\"peakLiveBytes\":" << c.phases[i].peakBytes << ","
+                << "\"liveBytes\":" << c.phases[i].liveBytes << "}";
+        }
+        out << "},\"symbols\":{"
+            << "\"created\":" << c.symbolsCreated << ","
+            << "\"copied\":" << c.copies << ","
+            << "\"live\":" << c.symbolsLive << ","
+            << "\"peakLive\":" << c.symbolsPeak
+            << "},\"memory\":{"
+            << "\"allHeap\":" << (isTrackingAllAllocations() ? "true" : "false") << ","
+            << "\"allocations\":" << c.allocations << ","
+            << "\"bytesAllocated\":" << c.bytesAllocated << ","
+            << "\"liveBytes\":" << c.bytesLive << ","
+            << "\"peakLiveBytes\":" << c.bytesPeak
+            << "},\"defines\":{";
+        for (std::vector<DefineSize>::size_type i = 0; i < c.defines.size(); i++) {
+            if (i > 0) out << ",";
+            out << "\"" << c.defines[i].name << "\":{"
+                << "\"nodesBefore\":" << c.defines[i].before << ","
+                << "\"nodesAfter\":" << c.defines[i].after << ","
+                << "\"allocations\":" << c.defines[i].allocations << ","
+                << "\"bytesAllocated\":" << c.defines[i].bytes << ","
+                << "\"peakLiveBytes\":" << c.defines[i].peakBytes << "}";
+        }
+        out << "}}" << std::endl;
+        return;
+    }
+
+    out << "Phases:" << std::setw(38) << "allocations"
+        << std::setw(14) << "bytes" << std::setw(14) << "peak live" << std::endl;
+    for (auto& phase : c.phases) {
+        out << "  " << std::left << std::setw(16) << phase.name
+            << std::right << std::setw(12) << std::fixed << std::setprecision(3)
+            << (phase.seconds * 1000.0) << " ms"
+            << std::setw(12) << phase.allocations
+            << std::setw(14) << phase.bytes
+            << std::setw(14) << phase.peakBytes << std::endl;
+    }
+
+    out << "Symbols:" << std::endl
+        << "  created         " << std::setw(12) << c.symbolsCreated << std::endl
+        << "  copied          " << std::setw(12) << c.copies << std::endl
+        << "  peak live       " << std::setw(12) << c.symbolsPeak << std::endl;
+
+    out << (isTrackingAllAllocations() ? "Memory (all heap allocations):"
+                                       : "Memory (symbols only):") << std::endl
+        << "  allocations     " << std::setw(12) << c.allocations << std::endl
+        << "  bytes allocated " << std::setw(12) << c.bytesAllocated << std::endl
+        << "  live bytes      " << std::setw(12) << c.bytesLive << std::endl
+        << "  peak live bytes " << std::setw(12) << c.bytesPeak << std::endl;
+
+    out << "Defines:" << std::setw(22) << "nodes" << "    " << std::left
+        << std::setw(10) << "optimized" << std::right << std::setw(12) << "allocations"
+        << std::setw(14) << "bytes" << std::setw(14) << "peak live" << std::endl;
+    for (auto& define : c.defines) {
+        out << "  " << std::left << std::setw(16) << define.name
+            << std::right << std::setw(12) << define.before << " -> "
+            << std::left << std::setw(10) << define.after << std::right
+            << std::setw(12) << define.allocations
+            << std::setw(14) << define.bytes
+            << std::setw(14) << define.peakBytes << std::endl;
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+class Symbol;
+
+/**
+ * Process-wide counters used by the --stats report. The symbol and allocation
+ * counters are always updated since they are just a few integer operations,
+ * while phase and define measurements are only recorded once the statistics
+ * have been enabled. None of them are synchronized, so symbols may only be
+ * created, and memory only allocated, by the thread that runs the solver.
+ */
+class Stats {
+public:
+    /**
+     * Counts the allocations made from construction until the scope is closed
+     * or destroyed. Scopes can be nested, in which case the high-water mark of
+     * the inner scope is included in the outer one.
+     */
+    class Allocations {
+    public:
+        Allocations();
+
+        ~Allocations();
+
+        void close();
+
+        long getCount() const;
+
+        long getBytes() const;
+
+        long getPeakBytes() const;
+
+    private:
+        long mCount, mBytes, mOuterPeak, mPeak;
+        bool mOpen;
+    };
+
+    /**
+     * Measures the time and allocations from construction to destruction and
+     * adds them to the phase with the given name.
+     */
+    class Phase {
+    public:
+        explicit Phase(const char* name);
+
+        ~Phase();
+
+    private:
+        const char* mName;
+        std::chrono::steady_clock::time_point mBegin;
+        Allocations mAllocations;
+    };
+
+    static void enable();
+
+    static bool isEnabled();
+
+    static void symbolCreated();
+
+    static void symbolDestroyed();
+
+    static void symbolCopied();
+
+    static void bytesAllocated(std::size_t bytes);
+
+    static void bytesFreed(std::size_t bytes);
+
+    static void recordDefine(const std::string& name, long before, long after,
+                             const Allocations& allocations);
+
+    static long countNodes(const Symbol* symbol);
+
+    static long getLiveSymbols();
+
+    static long getLiveBytes();
+
+    static long getPeakLiveBytes();
+
+    /**
+     * True if the solver was built with SOLVE_TRACK_ALLOCATIONS, in which case
+     * every heap allocation is counted and not only those of symbols.
+     */
+    static bool isTrackingAllAllocations();
+
+    /**
+     * Restarts the high-water marks from the current number of live symbols
+     * and bytes.
+     */
+    static void resetPeaks();
+
+    static void report(std::ostream& out, bool json);
+};
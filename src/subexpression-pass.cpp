@@ -0,0 +1,93 @@
+#include "subexpression-pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <utility>
+#include "serializer.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+
+SubexpressionPass::SubexpressionPass() :
+    mIds{}, mMemo{}, mPending{}, mHits{0}, mMisses{0} {}
+
+SubexpressionPass::~SubexpressionPass() {
+    for (auto& entry : mMemo) {
+        delete entry.second;
+    }
+}
+
+const char* SubexpressionPass::getName() const {
+    return "common-subexpressions";
+}
+
+Symbol* SubexpressionPass::enter(Symbol* input) {
+    // Leaves are cheaper to optimize than to look up. No id is still pushed
+    // so that every enter is matched by exactly one leave.
+    if (isLeaf(input)) {
+        mPending.push_back(NONE);
+        return nullptr;
+    }
+
+    // The other passes may have rewritten, freed or reallocated any node
+    // since the parent was entered, so ids are never kept between nodes
+    const uint32_t id = identify(input);
+
+    auto found = mMemo.find(id);
+    if (found != mMemo.end()) {
+        mHits++;
+        delete input;
+        return found->second->copy();
+    }
+
+    mMisses++;
+    mPending.push_back(id);
+    return nullptr;
+}
+
+Symbol* SubexpressionPass::leave(Symbol* input, PassManager&) {
+    const uint32_t id = mPending.back();
+    mPending.pop_back();
+
+    if (id != NONE && mMemo.find(id) == mMemo.end()) {
+        mMemo.emplace(id, input->copy());
+    }
+
+    return input;
+}
+
+uint32_t SubexpressionPass::identify(const Symbol* symbol) {
+    // Leaves are written as they are, and the other children by their id
+    std::string key;
+    Serializer::encodeNode(key, symbol, [this](std::string& out, const Symbol* child) {
+        if (isLeaf(child)) {
+            Serializer::encode(out, child);
+            return;
+        }
+
+        const uint32_t id = identify(child);
+        out.push_back('#');
+        out.append(reinterpret_cast<const char*>(&id), sizeof id);
+    });
+
+    // Equal keys mean equal trees, since the children are equal too
+    auto found = mIds.find(key);
+    if (found != mIds.end()) return found->second;
+
+    const auto id = (uint32_t) mIds.size();
+    mIds.emplace(std::move(key), id);
+    return id;
+}
+
+bool SubexpressionPass::isLeaf(const Symbol* symbol) {
+    return dynamic_cast<const Constant*>(symbol) || dynamic_cast<const Variable*>(symbol);
+}
+
+int SubexpressionPass::getHits() const {
+    return mHits;
+}
+
+int SubexpressionPass::getMisses() const {
+    return mMisses;
+}
@@ -0,0 +1,54 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pass.hpp"
+
+/**
+ * Remembers the optimized form of every compound subtree, keyed by its
+ * structure. Identical subtrees in different places (or in different
+ * defines) are then only optimized once. This pass must be the last one so
+ * that it stores the result of all the others.
+ *
+ * Every distinct structure gets an id. The id of a node is looked up by its
+ * own payload and the ids of its children, so a key never holds more than
+ * a single node.
+ */
+class SubexpressionPass : public Pass {
+public:
+    explicit SubexpressionPass();
+
+    ~SubexpressionPass() override;
+
+    const char* getName() const override;
+
+    Symbol* enter(Symbol* input) override;
+
+    Symbol* leave(Symbol* input, PassManager& manager) override;
+
+    int getHits() const;
+
+    int getMisses() const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /**
+     * Returns the id of the structure of the symbol, found bottom-up from
+     * the ids of its children.
+     */
+    uint32_t identify(const Symbol* symbol);
+
+    static bool isLeaf(const Symbol* symbol);
+
+    std::unordered_map<std::string, uint32_t> mIds;
+    std::unordered_map<uint32_t, Symbol*> mMemo;
+    std::vector<uint32_t> mPending;
+    int mHits, mMisses;
+};
@@ -0,0 +1,188 @@
+#include "sum-normalization-pass.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "pass-manager.hpp"
+#include "serializer.hpp"
+#include "constant.hpp"
+#include "variable.hpp"
+#include "matrix.hpp"
+#include "product.hpp"
+#include "sum.hpp"
+
+const char* SumNormalizationPass::getName() const {
+    return "sum-normalization";
+}
+
+bool SumNormalizationPass::isExpensive() const {
+    return true;
+}
+
+Symbol* SumNormalizationPass::leave(Symbol* input, PassManager& manager) {
+    auto* sum = dynamic_cast<Sum*>(input);
+    if (sum == nullptr) return input;
+
+    std::vector<Symbol*> terms;
+    flatten(sum, terms);
+
+    bool allMatrices = true, anyMatrix = false;
+    for (auto* term : terms) {
+        const bool matrix = dynamic_cast<Matrix*>(term) != nullptr;
+        allMatrices &= matrix;
+        anyMatrix |= matrix;
+    }
+
+    if (anyMatrix) {
+        if (!allMatrices) {
+            for (auto* term : terms) delete term;
+            return input; // Leave mixed sums as they are
+        }
+
+        delete input;
+        Symbol* result = terms[0];
+        for (std::vector<Symbol*>::size_type i = 1; i < terms.size(); i++) {
+            result = *result + terms[i];
+        }
+        return manager.run(result);
+    }
+
+    delete input;
+
+    // Group the terms by everything except their coefficient, keeping the
+    // order in which each group first appeared. The group of plain numbers
+    // has no symbol.
+    std::vector<std::pair<float, Symbol*>> groups;
+    std::unordered_map<std::string, std::vector<Symbol*>::size_type> index;
+    for (auto* term : terms) {
+        float coefficient;
+        Symbol* rest = split(term, coefficient);
+
+        std::string key;
+        if (rest != nullptr) Serializer::encode(key, rest);
+
+        auto found = index.find(key);
+        if (found == index.end()) {
+            index.emplace(std::move(key), groups.size());
+            groups.emplace_back(coefficient, rest);
+        } else {
+            groups[found->second].first += coefficient;
+            delete rest;
+        }
+    }
+
+    std::vector<Symbol*> merged;
+    for (auto& group : groups) {
+        if (fabsf(group.first) < FLT_EPSILON) {
+            delete group.second;
+        } else if (group.second == nullptr) {
+            merged.push_back(new Constant{group.first});
+        } else {
+            merged.push_back(scale(group.second, group.first));
+        }
+    }
+
+    if (merged.empty()) {
+        return new Constant{0.0f};
+    } else if (merged.size() == 1) {
+        return merged[0];
+    }
+
+    auto* result = new Sum(merged[0], merged[1]);
+    for (std::vector<Symbol*>::size_type i = 2; i < merged.size(); i++) {
+        result->setTerm(i, merged[i]);
+    }
+    return result;
+}
+
+void SumNormalizationPass::flatten(const Sum* sum, std::vector<Symbol*>& terms) {
+    for (int i = 0; i < sum->getTerms(); i++) {
+        if (auto* inner = dynamic_cast<const Sum*>(sum->get(i))) {
+            flatten(inner, terms);
+        } else {
+            terms.push_back(sum->get(i)->copy());
+        }
+    }
+}
+
+Symbol* SumNormalizationPass::split(Symbol* term, float& coefficient) {
+    if (auto* constant = dynamic_cast<Constant*>(term)) {
+        coefficient = constant->getValue();
+        delete term;
+        return nullptr;
+    }
+
+    if (auto* variable = dynamic_cast<Variable*>(term)) {
+        coefficient = variable->getQuantity();
+        if (fabsf(variable->getExponent()) < FLT_EPSILON) {
+            delete term;
+            return nullptr;
+        }
+        variable->setQuantity(1.0f);
+        return term;
+    }
+
+    if (auto* product = dynamic_cast<Product*>(term)) {
+        coefficient = 1.0f;
+        std::vector<Symbol*> factors;
+        for (int i = 0; i < product->getFactors(); i++) {
+            const Symbol* factor = product->get(i);
+            if (auto* constant = dynamic_cast<const Constant*>(factor)) {
+                coefficient *= constant->getValue();
+            } else if (auto* variable = dynamic_cast<const Variable*>(factor)) {
+                coefficient *= variable->getQuantity();
+                auto* unit = variable->copy();
+                static_cast<Variable*>(unit)->setQuantity(1.0f);
+                factors.push_back(unit);
+            } else {
+                factors.push_back(factor->copy());
+            }
+        }
+        delete term;
+
+        if (factors.empty()) return nullptr;
+        if (factors.size() == 1) return factors[0];
+
+        auto* rest = new Product(factors[0], factors[1]);
+        for (std::vector<Symbol*>::size_type i = 2; i < factors.size(); i++) {
+            rest->setFactor(i, factors[i]);
+        }
+        return rest;
+    }
+
+    coefficient = 1.0f;
+    return term;
+}
+
+Symbol* SumNormalizationPass::scale(Symbol* term, float coefficient) {
+    if (fabsf(coefficient - 1.0f) < FLT_EPSILON) return term;
+
+    if (auto* variable = dynamic_cast<Variable*>(term)) {
+        variable->setQuantity(coefficient);
+        return term;
+    }
+
+    if (auto* product = dynamic_cast<Product*>(term)) {
+        if (auto* first = dynamic_cast<const Variable*>(product->get(0))) {
+            auto* scaled = first->copy();
+            static_cast<Variable*>(scaled)->setQuantity(coefficient);
+            product->setFactor(0, scaled);
+            return term;
+        }
+
+        auto* scaled = new Product(new Constant{coefficient}, product->get(0)->copy());
+        for (int i = 1; i < product->getFactors(); i++) {
+            scaled->setFactor(i + 1, product->get(i)->copy());
+        }
+        delete term;
+        return scaled;
+    }
+
+    return *term * new Constant{coefficient};
+}
@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include "pass.hpp"
+
+class Sum;
+
+/**
+ * Collapses nested sums and merges terms that only differ by a numeric
+ * coefficient, like 3*a*b + a*b = 4*a*b. Terms that cancel out are removed.
+ * Sums of matrices are added element-wise.
+ */
+class SumNormalizationPass : public Pass {
+public:
+    const char* getName() const override;
+
+    bool isExpensive() const override;
+
+    Symbol* leave(Symbol* input, PassManager& manager) override;
+
+private:
+    static void flatten(const Sum* sum, std::vector<Symbol*>& terms);
+
+    static Symbol* split(Symbol* term, float& coefficient);
+
+    static Symbol* scale(Symbol* term, float coefficient);
+};
@@ -8,9 +8,12 @@
 #include "variable.hpp"
 #include "constant.hpp"
 #include "invalid-expression.hpp"
+#include "governor.hpp"
+#include "stats.hpp"
 #include "product.hpp"
 
 Symbol *Sum::copy() const {
+    Stats::symbolCopied();
     if (mTerms.size() < 2) throw InvalidExpression();
     auto* sum = new Sum(mTerms[0]->copy(), mTerms[1]->copy());
     for (Terms::size_type i = 2; i < mTerms.size(); i++) {
@@ -21,7 +24,7 @@ Symbol *Sum::copy() const {
 
 Symbol *Sum::negate() {
     for (auto & mTerm : mTerms) {
-        mTerm->negate();
+        mTerm = mTerm->negate();
     }
     return this;
 }
@@ -42,6 +45,7 @@ Symbol *Sum::operator+(Symbol *other) {
     }
 
     mTerms.push_back(other);
+    Governor::checkTerms(mTerms.size());
     return this;
 }
 
@@ -51,7 +55,9 @@ Symbol *Sum::operator-(Symbol *other) {
 }
 
 Symbol *Sum::operator*(Symbol *other) {
-    assertSameDimensions(other);
+    if (!isScalar() && !other->isScalar() && !isSameSize(getColumns(), other->getRows())) {
+        throw dimensionMismatch("multiply", other);
+    }
 
     if (auto* otherSum = dynamic_cast<Sum*>(other)) {
         Terms terms;
@@ -91,6 +97,8 @@ Symbol *Sum::operator*(Symbol *other) {
 
                 if (found) delete result;
                 else terms.push_back(result);
+
+                Governor::checkTerms(terms.size());
             }
         }
 
@@ -189,10 +197,12 @@ void Sum::getDimensions(int &cols, int &rows) const {
             int termCols = term->getColumns();
             int termRows = term->getRows();
 
-            if ((cols == 1 && rows == 1)
-            || ((cols == termCols) && (rows == termRows))) {
+            if (cols == 1 && rows == 1) {
                 cols = termCols;
                 rows = termRows;
+            } else if (isSameSize(cols, termCols) && isSameSize(rows, termRows)) {
+                if (cols == UNKNOWN) cols = termCols;
+                if (rows == UNKNOWN) rows = termRows;
             } else {
                 throw InvalidExpression(); // Dimensions does not match
             }
@@ -211,6 +221,23 @@ std::set<std::string> Sum::findUndefined() {
     return undefined;
 }
 
+int Sum::getTerms() const {
+    return mTerms.size();
+}
+
+void Sum::setTerm(int index, Symbol* term) {
+    if (index == mTerms.size()) {
+        mTerms.push_back(term);
+    } else {
+        delete mTerms[index];
+        mTerms[index] = term;
+    }
+}
+
+const Symbol *Sum::get(int term) const {
+    return mTerms[term];
+}
+
 Sum::Sum(Symbol *first, Symbol *second) : Symbol{}, mTerms{} {
     mTerms.push_back(first);
     mTerms.push_back(second);
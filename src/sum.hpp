@@ -40,6 +40,12 @@ public:
 
     std::set<std::string> findUndefined() override;
 
+    int getTerms() const;
+
+    void setTerm(int index, Symbol* term);
+
+    const Symbol* get(int term) const;
+
 private:
     void getDimensions(int& cols, int& rows) const;
 
@@ -5,13 +5,57 @@
 #include "symbol.hpp"
 #include "invalid-expression.hpp"
 #include "constant.hpp"
+#include "matrix.hpp"
+#include "fraction.hpp"
+#include "function.hpp"
+#include "stats.hpp"
+
+Symbol::Symbol() {
+    Stats::symbolCreated();
+}
+
+Symbol::Symbol(const Symbol&) {
+    Stats::symbolCreated();
+}
+
+Symbol::~Symbol() {
+    Stats::symbolDestroyed();
+}
+
+void* Symbol::operator new(std::size_t size) {
+#ifndef SOLVE_TRACK_ALLOCATIONS
+    Stats::bytesAllocated(size); // Otherwise counted by the global operator
+#endif
+    return ::operator new(size);
+}
+
+void Symbol::operator delete(void* pointer, std::size_t size) {
+#ifndef SOLVE_TRACK_ALLOCATIONS
+    Stats::bytesFreed(size);
+#endif
+    ::operator delete(pointer);
+}
+
+bool Symbol::isSameSize(int size, int other) {
+    return size == other || size == UNKNOWN || other == UNKNOWN;
+}
 
 void Symbol::assertSameDimensions(const Symbol *other) const {
-    if (getRows() != other->getRows() || getColumns() != other->getColumns()) {
-        throw InvalidExpression();
+    if (!isSameSize(getRows(), other->getRows()) || !isSameSize(getColumns(), other->getColumns())) {
+        throw dimensionMismatch("add", other);
     }
 }
 
+std::invalid_argument Symbol::dimensionMismatch(const std::string& operation,
+                                                const Symbol* other) const {
+    auto size = [](int size) -> std::string {
+        return size == UNKNOWN ? "?" : std::to_string(size);
+    };
+    return std::invalid_argument("Can't " + operation + " a "
+        + size(getRows()) + "x" + size(getColumns()) + " matrix with a "
+        + size(other->getRows()) + "x" + size(other->getColumns()) + " matrix.");
+}
+
 Symbol* Symbol::assertNotNull(Symbol* symbol) const {
     if (symbol == nullptr) throw InvalidExpression();
     return symbol;
@@ -40,3 +84,47 @@ bool Symbol::isScalar() const {
 Symbol *Symbol::operator-() {
     return negate();
 }
+
+Symbol *Symbol::pow(Symbol::value_t exponent) {
+    auto n = (long) exponent;
+    if ((value_t) n != exponent) {
+        delete this;
+        throw std::invalid_argument("Can't raise a symbol to the power of "
+            + std::to_string(exponent) + ", only integer powers are supported.");
+    }
+    if (!isSameSize(getRows(), getColumns())) {
+        const std::string message = "Can't raise a non-square [" + std::to_string(getRows())
+            + ", " + std::to_string(getColumns()) + "] matrix to a power.";
+        delete this;
+        throw std::invalid_argument(message);
+    }
+
+    // A^-n is (A^-1)^n
+    if (n < 0) {
+        Symbol* inverse = isScalar()
+            ? new Fraction(new Constant{1.0f}, this)
+            : Function::call("inv", {this});
+        return inverse->pow((value_t) -n);
+    }
+
+    if (n == 0) {
+        const int size = getRows();
+        delete this;
+        if (size == 1) return new Constant{1.0f};
+        return Matrix::eye(size);
+    }
+
+    Symbol* result = nullptr;
+    Symbol* base = this;
+    while (true) {
+        if (n & 1) {
+            result = result == nullptr ? base->copy() : *result * base->copy();
+        }
+        n >>= 1;
+        if (n == 0) break;
+        base = *base * base->copy();
+    }
+
+    delete base;
+    return result;
+}
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <functional>
 #include <map>
@@ -14,7 +16,23 @@ class Symbol {
 public:
     typedef float value_t;
 
-    virtual ~Symbol() = default;
+    /**
+     * The number of rows or columns of a matrix that is only known by its
+     * name, which matches any other size.
+     */
+    static constexpr int UNKNOWN = -1;
+
+    static bool isSameSize(int size, int other);
+
+    Symbol();
+
+    Symbol(const Symbol& other);
+
+    virtual ~Symbol();
+
+    static void* operator new(std::size_t size);
+
+    static void operator delete(void* pointer, std::size_t size);
 
     virtual Symbol* copy() const = 0;
 
@@ -38,6 +56,15 @@ public:
 
     virtual Symbol* operator-();
 
+    /**
+     * Raises this to the given power. The default implementation supports
+     * integer exponents of square symbols and uses repeated squaring, so
+     * only O(log n) multiplications are needed. Negative exponents are
+     * powers of the inverse. Consumes this, also if it throws
+     * std::invalid_argument for an exponent that is not supported.
+     */
+    virtual Symbol* pow(value_t exponent);
+
     virtual Symbol* replace(
         const std::function<bool(const Symbol*)>& predicate,
         const std::function<Symbol*(Symbol*)>& mapper) = 0;
@@ -59,5 +86,12 @@ public:
 protected:
     void assertSameDimensions(const Symbol* other) const;
 
+    /**
+     * An error that names the dimensions of both sides, like "Can't
+     * multiply a 2x2 matrix with a 3x3 matrix."
+     */
+    std::invalid_argument dimensionMismatch(const std::string& operation,
+                                            const Symbol* other) const;
+
     Symbol* assertNotNull(Symbol* other) const;
 };
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "trace.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Event {
+        std::string name;
+        std::string args;
+        double begin;
+        double duration;
+        std::size_t thread;
+    };
+
+    struct Timeline {
+        std::ofstream out;
+        std::chrono::steady_clock::time_point origin;
+        std::vector<Event> events;
+        std::mutex mutex;
+    };
+
+    Timeline& timeline() {
+        static Timeline instance;
+        return instance;
+    }
+
+    double microsecondsSince(std::chrono::steady_clock::time_point origin,
+                             std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - origin).count();
+    }
+
+    std::string escape(const std::string& str) {
+        std::string escaped;
+        for (char c : str) {
+            switch (c) {
+                case '"': escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                default: escaped.push_back(c);
+            }
+        }
+        return escaped;
+    }
+}
+
+Trace::Span& Trace::Span::arg(const char* key, const std::string& value) {
+    if (mName != nullptr) {
+        if (!mArgs.empty()) mArgs += ",";
+        mArgs += "\"" + escape(key) + "\":\"" + escape(value) + "\"";
+    }
+    return *this;
+}
+
+Trace::Span& Trace::Span::arg(const char* key, long value) {
+    if (mName != nullptr) {
+        if (!mArgs.empty()) mArgs += ",";
+        mArgs += "\"" + escape(key) + "\":" + std::to_string(value);
+    }
+    return *this;
+}
+
+void Trace::Span::begin(const char* name) {
+    mName = name;
+    mBegin = std::chrono::steady_clock::now();
+}
+
+void Trace::Span::end() {
+    const auto now = std::chrono::steady_clock::now();
+    auto& t = timeline();
+
+    Event event {
+        mName,
+        std::move(mArgs),
+        microsecondsSince(t.origin, mBegin),
+        microsecondsSince(mBegin, now),
+        std::hash<std::thread::id>{}(std::this_thread::get_id())
+    };
+
+    std::lock_guard<std::mutex> lock {t.mutex};
+    t.events.push_back(std::move(event));
+}
+
+void Trace::open(const std::string& filename) {
+    auto& t = timeline();
+    t.out.open(filename, std::ios::trunc);
+    if (!t.out) {
+        throw std::invalid_argument("Could not write trace '" + filename + "'.");
+    }
+
+    t.origin = std::chrono::steady_clock::now();
+    t.events.clear();
+    sEnabled = true;
+}
+
+bool Trace::close() {
+    if (!sEnabled) return true;
+    sEnabled = false;
+
+    auto& t = timeline();
+    std::ofstream& out = t.out;
+
+    // Threads are numbered in the order they first appear
+    std::vector<std::size_t> threads;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    for (std::vector<Event>::size_type i = 0; i < t.events.size(); i++) {
+        const Event& event = t.events[i];
+
+        std::size_t tid = 0;
+        while (tid < threads.size() && threads[tid] != event.thread) tid++;
+        if (tid == threads.size()) threads.push_back(event.thread);
+
+        if (i > 0) out << ",";
+        out << "\n{\"name\":\"" << escape(event.name) << "\","
+            << "\"cat\":\"solve\",\"ph\":\"X\","
+            << "\"ts\":" << event.begin << ","
+            << "\"dur\":" << event.duration << ","
+            << "\"pid\":1,\"tid\":" << (tid + 1)
+            << ",\"args\":{" << event.args << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+    out.close();
+
+    t.events.clear();
+    return !out.fail();
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+/**
+ * Writes a timeline of the run in the Chrome trace-event format, which can
+ * be opened in chrome://tracing or Perfetto. When no trace file has been
+ * opened, creating a span only costs a check of a global flag.
+ */
+class Trace {
+public:
+    /**
+     * Only expressions with at least this many nodes (or multiplications
+     * with at least this many element products) get their own span.
+     */
+    static const long SIZE_THRESHOLD = 64;
+
+    class Span {
+    public:
+        explicit Span(const char* name, bool condition = true) : mName{nullptr} {
+            if (sEnabled && condition) begin(name);
+        }
+
+        ~Span() {
+            if (mName != nullptr) end();
+        }
+
+        Span& arg(const char* key, const std::string& value);
+
+        Span& arg(const char* key, long value);
+
+    private:
+        void begin(const char* name);
+
+        void end();
+
+        const char* mName;
+        std::chrono::steady_clock::time_point mBegin;
+        std::string mArgs;
+    };
+
+    /**
+     * Opens the trace file and starts recording spans. The file is created
+     * right away, so that a path that can't be written is reported before
+     * the run instead of after it. Throws std::invalid_argument if it can't
+     * be created.
+     */
+    static void open(const std::string& filename);
+
+    /**
+     * Writes every recorded span to the trace file and stops recording.
+     * Returns false if the file could not be written.
+     */
+    static bool close();
+
+    static bool isEnabled() {
+        return sEnabled;
+    }
+
+private:
+    static inline bool sEnabled = false;
+};
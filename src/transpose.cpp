@@ -0,0 +1,129 @@
+#include "transpose.hpp"
+
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <stdexcept>
+#include "constant.hpp"
+#include "matrix.hpp"
+#include "block-matrix.hpp"
+#include "product.hpp"
+#include "stats.hpp"
+#include "sum.hpp"
+
+Transpose::Transpose(Symbol* inner) : Symbol{}, mInner{inner} {}
+
+Transpose::~Transpose() {
+    delete mInner;
+}
+
+Symbol *Transpose::of(Symbol* inner) {
+    if (auto* matrix = dynamic_cast<Matrix*>(inner)) {
+        return matrix->transpose();
+    }
+
+    if (auto* blocks = dynamic_cast<BlockMatrix*>(inner)) {
+        return blocks->transpose();
+    }
+
+    if (dynamic_cast<Constant*>(inner)) {
+        return inner;
+    }
+
+    if (auto* transpose = dynamic_cast<Transpose*>(inner)) {
+        return transpose->release(); // (A')' = A
+    }
+
+    return new Transpose(inner);
+}
+
+Symbol *Transpose::release() {
+    Symbol* inner = mInner;
+    mInner = nullptr;
+    delete this;
+    return inner;
+}
+
+const Symbol *Transpose::getInner() const {
+    return mInner;
+}
+
+Symbol *Transpose::copy() const {
+    Stats::symbolCopied();
+    return new Transpose(mInner->copy());
+}
+
+Symbol *Transpose::negate() {
+    mInner = mInner->negate();
+    return this;
+}
+
+Symbol *Transpose::operator+(Symbol *other) {
+    if (dynamic_cast<Sum*>(other)) {
+        return *other + this;
+    }
+    return new Sum(this, other);
+}
+
+Symbol *Transpose::operator-(Symbol *other) {
+    return *this + other->negate();
+}
+
+Symbol *Transpose::operator*(Symbol *other) {
+    // The order is kept since the inner symbol may become a matrix
+    return new Product(this, other);
+}
+
+Symbol *Transpose::operator/(Symbol *other) {
+    auto* constant = dynamic_cast<Constant*>(other);
+    if (constant == nullptr || constant->isZero()) {
+        throw std::invalid_argument("A transposed matrix can only be divided by a number other than zero.");
+    }
+
+    const value_t inverse = 1.0f / constant->getValue();
+    delete other;
+    return new Product(this, new Constant{inverse});
+}
+
+Symbol *Transpose::replace(const std::function<bool(const Symbol *)> &predicate,
+                           const std::function<Symbol *(Symbol *)> &mapper) {
+    if (predicate(mInner)) {
+        mInner = mapper(mInner);
+    }
+
+    if (dynamic_cast<Matrix*>(mInner) || dynamic_cast<BlockMatrix*>(mInner)
+    ||  dynamic_cast<Constant*>(mInner)) {
+        return of(release());
+    }
+
+    return this;
+}
+
+std::string Transpose::format(const Formatter &formatter) const {
+    std::string inner = mInner->format(formatter);
+    if (dynamic_cast<const Product*>(mInner)) {
+        inner = formatter.paranthesis(inner);
+    }
+    return formatter.transpose(inner);
+}
+
+bool Transpose::isConstant() const {
+    return mInner->isConstant();
+}
+
+bool Transpose::isZero() const {
+    return mInner->isZero();
+}
+
+int Transpose::getColumns() const {
+    return mInner->getRows();
+}
+
+int Transpose::getRows() const {
+    return mInner->getColumns();
+}
+
+std::set<std::string> Transpose::findUndefined() {
+    return mInner->findUndefined();
+}
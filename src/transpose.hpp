@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#pragma once
+
+#include "symbol.hpp"
+
+/**
+ * The transpose of a symbol that is not known to be a matrix yet, like a
+ * name that is substituted later on. As soon as the inner symbol becomes a
+ * matrix, this is replaced by a transposed view of it.
+ */
+class Transpose : public Symbol {
+public:
+    /**
+     * Transposes the given symbol, consuming it. Matrices are transposed
+     * directly, and only symbols that might still become matrices are
+     * wrapped.
+     */
+    static Symbol* of(Symbol* inner);
+
+    ~Transpose() override;
+
+    const Symbol* getInner() const;
+
+    Symbol* copy() const override;
+
+    Symbol* negate() override;
+
+    Symbol* operator+(Symbol* other) override;
+
+    Symbol* operator-(Symbol* other) override;
+
+    Symbol* operator*(Symbol* other) override;
+
+    Symbol* operator/(Symbol* other) override;
+
+    Symbol* replace(const std::function<bool(const Symbol *)> &predicate,
+                    const std::function<Symbol *(Symbol *)> &mapper) override;
+
+    std::string format(const Formatter &formatter) const override;
+
+    bool isConstant() const override;
+
+    bool isZero() const override;
+
+    int getColumns() const override;
+
+    int getRows() const override;
+
+    std::set<std::string> findUndefined() override;
+
+private:
+    explicit Transpose(Symbol* inner);
+
+    /**
+     * Returns the inner symbol and deletes this.
+     */
+    Symbol* release();
+
+    Symbol* mInner;
+};
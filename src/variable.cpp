@@ -10,6 +10,7 @@
 #include "constant.hpp"
 #include "product.hpp"
 #include "invalid-expression.hpp"
+#include "stats.hpp"
 
 Variable::Variable(std::string name)
     : Symbol{}, mName{std::move(name)}, mQuantity{1.0f}, mExponent{1.0f} {}
@@ -37,6 +38,7 @@ Symbol::value_t Variable::getExponent() const {
 }
 
 Symbol *Variable::copy() const {
+    Stats::symbolCopied();
     auto* copy = new Variable{mName};
     copy->setQuantity(mQuantity);
     copy->setExponent(mExponent);
@@ -190,7 +192,12 @@ Symbol *Variable::operator*(Symbol *other) {
         return *otherSum * this;
     }
 
-    throw InvalidExpression();
+    // Scalars commute, so x*A = A*x
+    if (!other->isScalar()) {
+        return *other * this;
+    }
+
+    return new Product(this, other);
 }
 
 Symbol *Variable::operator/(Symbol *other) {
@@ -248,6 +255,14 @@ Symbol *Variable::operator/(Symbol *other) {
     throw InvalidExpression();
 }
 
+Symbol *Variable::pow(Symbol::value_t exponent) {
+    // (3x^2)^2 = 9x^4. A zero exponent is kept rather than folded into a
+    // constant, since the name may be substituted by a matrix later on.
+    mQuantity = powf(mQuantity, exponent);
+    mExponent *= exponent;
+    return this;
+}
+
 bool Variable::isConstant() const {
     return false;
 }
@@ -31,6 +31,8 @@ public:
 
     Symbol *operator/(Symbol *other) override;
 
+    Symbol *pow(value_t exponent) override;
+
     Symbol *replace(const std::function<bool(const Symbol *)> &predicate,
                     const std::function<Symbol *(Symbol *)> &mapper) override;
 
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/block-matrix.hpp"
+#include "../src/matrix.hpp"
+#include "../src/parser.hpp"
+#include "../src/serializer.hpp"
+#include "../src/default-formatter.hpp"
+
+TEST(blocks, blockProductMatchesFlatProduct) {
+    const std::string blocks =
+        "A = [1,2;3,4]; B = [5,6;7,8]; I = eye(2); M = [A,B;0,I]; N = [I,A;B,0]; P = M*N;";
+    const std::string flat =
+        "M = [1,2,5,6;3,4,7,8;0,0,1,0;0,0,0,1];"
+        "N = [1,0,1,2;0,1,3,4;5,6,0,0;7,8,0,0]; P = M*N;";
+
+    Parser blockParser{};
+    std::stringstream blockInput {blocks};
+    EXPECT_TRUE(blockParser.parse(blockInput));
+
+    Parser flatParser{};
+    std::stringstream flatInput {flat};
+    EXPECT_TRUE(flatParser.parse(flatInput));
+
+    // The output is always a plain matrix
+    DefaultFormatter formatter {};
+    EXPECT_TRUE(dynamic_cast<Matrix*>(blockParser.get("P")));
+    for (auto* name : {"M", "N", "P"}) {
+        EXPECT_EQ(blockParser.get(name)->format(formatter),
+                  flatParser.get(name)->format(formatter)) << name;
+    }
+}
+
+TEST(blocks, zeroBlocksAreSkipped) {
+    Parser parser{};
+    parser.setUppercaseMatrices(true);
+
+    std::stringstream input {};
+    input << "M = [X,0;0,Y];\n";
+    input << "N = M*M;\n";
+    input << "T = M';\n";
+    input << "S = M + M;";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    // The blocks of unknown size are never multiplied with the zeros
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("N")->format(formatter), "[X^2,0;0,Y^2]");
+    EXPECT_EQ(parser.get("T")->format(formatter), "[X',0;0,Y']");
+
+    std::string encoded;
+    Serializer::encode(encoded, parser.get("S"));
+    const char* cursor = encoded.data();
+    Symbol* decoded = Serializer::decode(cursor, encoded.data() + encoded.size());
+    EXPECT_TRUE(dynamic_cast<BlockMatrix*>(decoded));
+    EXPECT_EQ(decoded->format(formatter), parser.get("S")->format(formatter));
+    delete decoded;
+}
+
+TEST(blocks, rejectBlocksThatDoNotLineUp) {
+    Parser parser{};
+    std::stringstream input {"A = [1,2;3,4]; M = [A,[1;1;1]];"};
+    EXPECT_THROW(parser.parse(input), std::invalid_argument);
+
+    Parser scalars{};
+    std::stringstream scalarInput {"A = [1,2;3,4]; M = [A,2;0,1];"};
+    EXPECT_THROW(scalars.parse(scalarInput), std::invalid_argument);
+}
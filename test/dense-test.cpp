@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/dense.hpp"
+#include "../src/matrix.hpp"
+#include "../src/constant.hpp"
+
+namespace {
+    // Larger than a block, so that the blocked updates are used
+    const int SIZE = 150;
+
+    std::vector<double> randomValues(int n, unsigned seed) {
+        std::mt19937 random {seed};
+        std::uniform_real_distribution<double> distribution {-1.0, 1.0};
+        std::vector<double> values((std::size_t) n * n);
+        for (auto& value : values) value = distribution(random);
+        return values;
+    }
+
+    Matrix* toMatrix(const std::vector<double>& values, int rows, int cols) {
+        auto* matrix = Matrix::zero(rows, cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                matrix->set(i, j, new Constant{(float) values[i * cols + j]});
+            }
+        }
+        return matrix;
+    }
+
+    float valueAt(const Matrix* matrix, int row, int col) {
+        return dynamic_cast<const Constant*>(matrix->get(row, col))->getValue();
+    }
+}
+
+TEST(dense, factorLUReproducesMatrix) {
+    const int n = SIZE;
+    const std::vector<double> original = randomValues(n, 1);
+    std::vector<double> factors {original};
+    std::vector<int> pivots;
+    ASSERT_NE(Dense::factorLU(factors, n, pivots), 0);
+
+    // L * U should be the original with the rows swapped in order
+    std::vector<double> permuted {original};
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            std::swap(permuted[k * n + j], permuted[pivots[k] * n + j]);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (int k = 0; k <= std::min(i, j); k++) {
+                const double lower = k == i ? 1.0 : factors[i * n + k];
+                sum += lower * factors[k * n + j];
+            }
+            ASSERT_NEAR(sum, permuted[i * n + j], 1e-9) << i << ", " << j;
+        }
+    }
+}
+
+TEST(dense, factorCholeskyReproducesMatrix) {
+    const int n = SIZE;
+    const std::vector<double> random = randomValues(n, 2);
+
+    // B * B' + n * I is symmetric positive definite
+    std::vector<double> original((std::size_t) n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = i == j ? n : 0.0;
+            for (int k = 0; k < n; k++) sum += random[i * n + k] * random[j * n + k];
+            original[i * n + j] = sum;
+        }
+    }
+
+    std::vector<double> factors {original};
+    ASSERT_TRUE(Dense::factorCholesky(factors, n));
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double sum = 0.0;
+            for (int k = 0; k <= j; k++) sum += factors[i * n + k] * factors[j * n + k];
+            ASSERT_NEAR(sum, original[i * n + j], 1e-8) << i << ", " << j;
+        }
+    }
+
+    std::vector<double> indefinite {original};
+    indefinite[0] = -1.0;
+    EXPECT_FALSE(Dense::factorCholesky(indefinite, n));
+}
+
+TEST(dense, solveNumericSystem) {
+    const int n = SIZE;
+    std::vector<double> values = randomValues(n, 3);
+    for (int i = 0; i < n; i++) values[i * n + i] += 4.0;
+
+    auto* left = toMatrix(values, n, n);
+    auto* right = toMatrix(randomValues(n, 4), n, 1);
+
+    Matrix* solution = left->solve(right);
+    ASSERT_EQ(solution->getRows(), n);
+    ASSERT_EQ(solution->getColumns(), 1);
+
+    for (int i = 0; i < n; i++) {
+        double sum = 0.0;
+        for (int k = 0; k < n; k++) sum += valueAt(left, i, k) * valueAt(solution, k, 0);
+        EXPECT_NEAR(sum, valueAt(right, i, 0), 1e-4) << i;
+    }
+
+    delete solution;
+    delete right;
+    delete left;
+
+    auto* singular = Matrix::square({1.0f, 2.0f, 2.0f, 4.0f});
+    EXPECT_THROW(delete singular->inverse(), std::invalid_argument);
+    Symbol* determinant = singular->determinant();
+    EXPECT_TRUE(determinant->isZero());
+    delete determinant;
+    delete singular;
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/parser.hpp"
+#include "../src/symbol.hpp"
+#include "../src/default-formatter.hpp"
+
+TEST(derivative, differentiateWithRespectToName) {
+    Parser parser{};
+
+    std::stringstream input {};
+    input << "f = x^2*y + 3*x;\n";
+    input << "g = d(f, x);\n";
+    input << "h = d(f, y);\n";
+    input << "v = d([x^3, y], x);\n";
+    input << "M = inv([x, 1; 1, y]);\n";
+    input << "w = d(M[1,1], x);";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("g")->format(formatter), "(3+2*x*y)");
+    EXPECT_EQ(parser.get("h")->format(formatter), "x^2");
+    EXPECT_EQ(parser.get("v")->format(formatter), "[3*x^2,0]");
+    EXPECT_EQ(parser.get("w")->format(formatter),
+              "(1/(x*y-1)+(-x)*y/(x^2*y^2-2*x*y+1))");
+}
+
+TEST(derivative, jacobianOfTransform) {
+    Parser parser{};
+
+    std::stringstream input {};
+    input << "T = [cosR,-sinR,a_x; sinR,cosR,a_y; 0,0,1] * [p_x; p_y; 1];\n";
+    input << "J = jacobian(T, [cosR, sinR, a_x, p_y]);";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("J")->format(formatter),
+              "[p_x,(-p_y),1,(-sinR);p_y,p_x,0,cosR;0,0,0,0]");
+
+    // Only found elements are computed
+    Parser lazy{};
+    lazy.setLazy(true);
+    std::stringstream lazyInput {
+        "T = [cosR,-sinR,a_x; sinR,cosR,a_y; 0,0,1] * [p_x; p_y; 1];"
+        "J = jacobian(T, [cosR, sinR, a_x, p_y]);"};
+    EXPECT_TRUE(lazy.parse(lazyInput));
+    Symbol* element = lazy.find("J[1,3]");
+    EXPECT_EQ(element->format(formatter), "cosR");
+    delete element;
+}
+
+TEST(derivative, rejectDefinedNames) {
+    Parser parser{};
+    std::stringstream input {"x = 2; g = d(x^2*y, x);"};
+    EXPECT_THROW(parser.parse(input), std::invalid_argument);
+
+    Parser matrix{};
+    std::stringstream matrixInput {"J = jacobian([x, y; y, x], [x, y]);"};
+    EXPECT_THROW(matrix.parse(matrixInput), std::invalid_argument);
+}
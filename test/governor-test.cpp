@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include "gtest/gtest.h"
+#include "../src/parser.hpp"
+#include "../src/governor.hpp"
+#include "../src/resource-limit-exceeded.hpp"
+#include "../src/stats.hpp"
+
+TEST(governor, abortSumExpansionOverTermLimit) {
+    std::string resource, define;
+    double limit = 0.0;
+
+    Governor::setMaxTerms(20);
+    try {
+        Parser parser {};
+        std::stringstream input {"a = 1 + 2; x = (a+b+c+d+e+f)*(g+h+i+j+k+l);"};
+        parser.parse(input);
+    } catch (const ResourceLimitExceeded& e) {
+        resource = e.getResource();
+        define = e.getDefine();
+        limit = e.getLimit();
+    }
+    Governor::reset();
+
+    EXPECT_EQ(resource, "terms");
+    EXPECT_EQ(define, "x");
+    EXPECT_EQ(limit, 20);
+}
+
+TEST(governor, abortMatrixProductOverNodeLimit) {
+    std::string resource, define;
+
+    Governor::setMaxLiveNodes(Stats::getLiveSymbols() + 150);
+    try {
+        Parser parser {};
+        std::stringstream input {
+            "A = [a,b,c,d;e,f,g,h;i,j,k,l;m,n,o,p];"
+            "C = [q,r,s,t;u,v,w,x;y,z,a,b;c,d,e,f];"
+            "B = A*C;"
+        };
+        parser.parse(input);
+    } catch (const ResourceLimitExceeded& e) {
+        resource = e.getResource();
+        define = e.getDefine();
+    }
+    Governor::reset();
+
+    EXPECT_EQ(resource, "live nodes");
+    EXPECT_EQ(define, "B");
+}
+
+TEST(governor, unlimitedByDefault) {
+    Parser parser {};
+    std::stringstream input {"x = (a+b+c+d+e+f)*(g+h+i+j+k+l);"};
+    EXPECT_TRUE(parser.parse(input));
+}
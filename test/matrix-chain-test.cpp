@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <sstream>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/matrix-chain.hpp"
+#include "../src/matrix.hpp"
+#include "../src/parser.hpp"
+#include "../src/default-formatter.hpp"
+#include "../src/helper.hpp"
+
+namespace {
+    Matrix* dense(int rows, int cols, const std::string& prefix) {
+        auto* matrix = Matrix::zero(rows, cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                matrix->set(i, j, _(prefix + std::string(1, (char) ('a' + i * cols + j))));
+            }
+        }
+        return matrix;
+    }
+
+    Matrix* diagonal(int size, const std::string& prefix) {
+        auto* matrix = Matrix::zero(size);
+        for (int i = 0; i < size; i++) {
+            matrix->set(i, i, _(prefix + std::string(1, (char) ('a' + i))));
+        }
+        return matrix;
+    }
+
+    void deleteAll(std::vector<Symbol*>& factors) {
+        for (auto* factor : factors) delete factor;
+    }
+}
+
+TEST(chain, multiplyVectorLast) {
+    std::vector<Symbol*> factors {dense(4, 4, "a"), dense(4, 4, "b"), dense(4, 1, "v")};
+    EXPECT_EQ(MatrixChain::describe(factors), "(0*(1*2))");
+    deleteAll(factors);
+}
+
+TEST(chain, multiplyOuterProductLast) {
+    std::vector<Symbol*> factors {dense(4, 1, "v"), dense(1, 4, "w"), dense(4, 4, "a")};
+    EXPECT_EQ(MatrixChain::describe(factors), "(0*(1*2))");
+    deleteAll(factors);
+}
+
+TEST(chain, preferStructuralZeros) {
+    // By dimensions alone both orders cost the same
+    std::vector<Symbol*> factors {diagonal(4, "a"), diagonal(4, "b"), dense(4, 4, "c")};
+    EXPECT_EQ(MatrixChain::describe(factors), "((0*1)*2)");
+    deleteAll(factors);
+
+    std::vector<Symbol*> reversed {dense(4, 4, "c"), diagonal(4, "a"), diagonal(4, "b")};
+    EXPECT_EQ(MatrixChain::describe(reversed), "(0*(1*2))");
+    deleteAll(reversed);
+}
+
+TEST(chain, sameResultAsLeftToRight) {
+    Parser parser {};
+    std::stringstream input {
+        "A = [a,b;c,d];"
+        "B = [e,0;0,f];"
+        "v = [x;y];"
+        "left = [a,b;c,d]*[e,0;0,f]*[x;y];"
+        "chain = A*B*v;"
+    };
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("chain")->format(formatter), parser.get("left")->format(formatter));
+    EXPECT_EQ(parser.get("chain")->format(formatter), "[(a*e*x+b*f*y);(c*e*x+d*f*y)]");
+}
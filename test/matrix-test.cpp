@@ -0,0 +1,336 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <memory>
+#include <tuple>
+#include "gtest/gtest.h"
+#include "../src/matrix.hpp"
+#include "../src/constant.hpp"
+#include "../src/stats.hpp"
+#include "../src/default-formatter.hpp"
+#include "../src/latex-formatter.hpp"
+#include "../src/helper.hpp"
+
+namespace {
+    // An element of the product as the general kernel computes it
+    Symbol* expectedElement(const Matrix* left, const Matrix* right, int i, int j) {
+        Symbol* sum = _(0.0f);
+        for (int k = 0; k < left->getColumns(); k++) {
+            if (left->get(i, k)->isZero() || right->get(k, j)->isZero()) continue;
+            sum = *sum + (*left->get(i, k)->copy() * right->get(k, j)->copy());
+        }
+        return sum;
+    }
+
+    std::string expectedProduct(const Matrix* left, const Matrix* right) {
+        auto* result = Matrix::zero(left->getRows(), right->getColumns());
+        for (int i = 0; i < left->getRows(); i++) {
+            for (int j = 0; j < right->getColumns(); j++) {
+                result->set(i, j, expectedElement(left, right, i, j));
+            }
+        }
+        DefaultFormatter formatter {};
+        std::string formatted = result->format(formatter);
+        delete result;
+        return formatted;
+    }
+
+    // A matrix of distinct names, with zeros where the predicate says so
+    Matrix* namedMatrix(int size, const std::string& prefix,
+                        const std::function<bool(int, int)>& isZero) {
+        auto* matrix = Matrix::zero(size, size);
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                if (!isZero(i, j)) {
+                    matrix->set(i, j, _(prefix + std::string(1, (char) ('a' + i)) +
+                                               std::string(1, (char) ('a' + j))));
+                }
+            }
+        }
+        return matrix;
+    }
+}
+
+TEST(matrix, transposeKeepsLowerTriangle) {
+    auto* matrix = Matrix::zero(2, 3);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 3; j++) {
+            matrix->set(i, j, _((float) (i * 3 + j + 1)));
+        }
+    }
+
+    Matrix* transposed = matrix->transpose();
+    EXPECT_EQ(transposed->getRows(), 3);
+    EXPECT_EQ(transposed->getColumns(), 2);
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(transposed->format(formatter), "[1,4;2,5;3,6]");
+    delete transposed;
+}
+
+TEST(matrix, transposeCopyWithoutCopyingElements) {
+    auto* matrix = Matrix::square({_("a"), _("b"), _("c"), _("d")});
+
+    Stats::Allocations allocations {};
+    auto* view = dynamic_cast<Matrix*>(matrix->copy())->transpose();
+    allocations.close();
+
+    // Only the matrix itself is allocated, the elements are shared
+    EXPECT_EQ(allocations.getCount(), 1);
+    EXPECT_TRUE(matrix->isShared());
+
+    // Modifying the view must not affect the original
+    view->set(0, 1, _("e"));
+    EXPECT_FALSE(matrix->isShared());
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(matrix->format(formatter), "[a,b;c,d]");
+    EXPECT_EQ(view->format(formatter), "[a,e;b,d]");
+
+    delete view;
+    delete matrix;
+}
+
+TEST(matrix, sliceWithoutCopyingElements) {
+    auto* matrix = Matrix::square({
+        _("a"), _("b"), _("c"),
+        _("d"), _("e"), _("f"),
+        _("g"), _("h"), _("i")});
+
+    Stats::Allocations allocations {};
+    auto* column = dynamic_cast<Matrix*>(matrix->copy())->slice(0, 2, 2, 1);
+    allocations.close();
+
+    EXPECT_EQ(allocations.getCount(), 1);
+    EXPECT_EQ(column->getRows(), 2);
+    EXPECT_EQ(column->getColumns(), 1);
+
+    // The slice is the only one left that refers to the storage, but it
+    // must still only modify its own elements
+    delete matrix;
+    EXPECT_FALSE(column->isShared());
+    column->negate();
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(column->format(formatter), "[(-c);(-f)]");
+    delete column;
+}
+
+TEST(matrix, scaleNumbersInPlace) {
+    auto* matrix = Matrix::square({1, 2, 3, 4, 5, 6, 7, 8, 9});
+
+    Stats::Allocations allocations {};
+    Symbol* result = *(*matrix * new Constant{2.0f}) + new Constant{1.0f};
+    allocations.close();
+
+    // Only the two scalars are allocated
+    EXPECT_EQ(allocations.getCount(), 2);
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(result->format(formatter), "[3,5,7;9,11,13;15,17,19]");
+    delete result;
+}
+
+TEST(matrix, inverseTimesMatrixIsIdentity) {
+    auto* matrix = Matrix::square({2.0f, 0.0f, 1.0f,
+                                   1.0f, 3.0f, 2.0f,
+                                   1.0f, 1.0f, 2.0f});
+
+    Symbol* determinant = matrix->determinant();
+    DefaultFormatter formatter {};
+    EXPECT_EQ(determinant->format(formatter), "6");
+
+    Symbol* product = *matrix->copy() * matrix->inverse();
+    auto* result = dynamic_cast<Matrix*>(product);
+    ASSERT_NE(result, nullptr);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            auto* element = dynamic_cast<Constant*>(result->get(i, j));
+            ASSERT_NE(element, nullptr);
+            EXPECT_NEAR(element->getValue(), i == j ? 1.0f : 0.0f, 1e-5f);
+        }
+    }
+
+    delete determinant;
+    delete product;
+    delete matrix;
+}
+
+TEST(matrix, multiplyNumericTransformWithoutPartialProducts) {
+    auto* left = Matrix::square({1.0f, 0.0f, 0.0f, 5.0f,
+                                 0.0f, 2.0f, 0.0f, 6.0f,
+                                 0.0f, 0.0f, 3.0f, 7.0f,
+                                 0.0f, 0.0f, 0.0f, 1.0f});
+    auto* right = Matrix::square({0.5f, 1.0f, 0.0f, 0.0f,
+                                  -1.0f, 0.5f, 0.0f, 0.0f,
+                                  0.0f, 0.0f, 1.0f, 0.0f,
+                                  0.0f, 0.0f, 0.0f, 1.0f});
+    Symbol* lhs = left->copy();
+    Symbol* rhs = right->copy();
+
+    Stats::Allocations allocations {};
+    Symbol* product = *lhs * rhs;
+    allocations.close();
+
+    // Only the result and its elements are allocated
+    EXPECT_EQ(allocations.getCount(), 17);
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(product->format(formatter), "[0.5,1,0,5;(-2),1,0,6;0,0,3,7;0,0,0,1]");
+
+    Symbol* sum = *product + left->copy();
+    EXPECT_EQ(sum->format(formatter), "[1.5,1,0,10;(-2),3,0,12;0,0,6,14;0,0,0,2]");
+    EXPECT_EQ(left->format(formatter), "[1,0,0,5;0,2,0,6;0,0,3,7;0,0,0,1]");
+
+    delete sum;
+    delete left;
+    delete right;
+}
+
+TEST(matrix, findStructure) {
+    auto* upper = namedMatrix(5, "u", [](int i, int j) { return j < i; });
+    auto* affine = namedMatrix(5, "a", [](int i, int j) { return i == 4 && j < 4; });
+    affine->set(4, 4, _(1.0f));
+    auto* permutation = Matrix::zero(5, 5);
+    for (int i = 0; i < 5; i++) permutation->set(i, (i + 2) % 5, _(1.0f));
+
+    EXPECT_EQ(upper->getStructure(), Matrix::UPPER);
+    EXPECT_EQ(affine->getStructure(), Matrix::AFFINE);
+    EXPECT_EQ(permutation->getStructure(), Matrix::PERMUTATION);
+    std::unique_ptr<Matrix> identity {Matrix::eye(5)};
+    EXPECT_EQ(identity->getStructure(), Matrix::IDENTITY);
+
+    upper->transpose();
+    EXPECT_EQ(upper->getStructure(), Matrix::LOWER);
+    upper->set(0, 4, _("x"));
+    EXPECT_EQ(upper->getStructure(), Matrix::GENERAL);
+
+    delete upper;
+    delete affine;
+    delete permutation;
+}
+
+TEST(matrix, structuredProductsMatchGeneralProduct) {
+    // Transforms of 4x4 go through the unrolled kernels, larger ones do not
+    for (int n : {4, 6}) {
+        auto* full = namedMatrix(n, "f", [](int, int) { return false; });
+        auto* upper = namedMatrix(n, "u", [](int i, int j) { return j < i; });
+        auto* lower = namedMatrix(n, "l", [](int i, int j) { return j > i; });
+        auto* diagonal = namedMatrix(n, "d", [](int i, int j) { return i != j; });
+        auto* affine = namedMatrix(n, "a", [n](int i, int) { return i == n - 1; });
+        affine->set(n - 1, n - 1, _(1.0f));
+        auto* permutation = Matrix::zero(n, n);
+        for (int i = 0; i < n; i++) permutation->set(i, (i + 2) % n, _(1.0f));
+
+        const std::vector<std::tuple<Matrix*, Matrix*, unsigned>> operands {
+            {upper, upper, Matrix::UPPER}, {lower, upper, 0u}, {upper, full, 0u},
+            {full, lower, 0u}, {diagonal, full, 0u}, {full, diagonal, 0u},
+            {permutation, full, 0u}, {full, permutation, 0u},
+            {affine, affine, Matrix::AFFINE}, {diagonal, diagonal, Matrix::DIAGONAL}
+        };
+
+        DefaultFormatter formatter {};
+        for (auto& operand : operands) {
+            Matrix* left = std::get<0>(operand);
+            Matrix* right = std::get<1>(operand);
+            const std::string expected = expectedProduct(left, right);
+            Symbol* product = *left->copy() * right->copy();
+            EXPECT_EQ(product->format(formatter), expected) << n;
+
+            // The structure that the product is tagged with must be right,
+            // and the structure that both operands share must be kept
+            auto* matrix = dynamic_cast<Matrix*>(product);
+            auto* recomputed = dynamic_cast<Matrix*>(matrix->copy());
+            recomputed->set(0, 0, matrix->get(0, 0)->copy());
+            EXPECT_EQ(matrix->getStructure() & ~recomputed->getStructure(), 0u) << n;
+            EXPECT_EQ(matrix->getStructure() & std::get<2>(operand), std::get<2>(operand)) << n;
+
+            delete recomputed;
+            delete product;
+        }
+
+        Symbol* identity = *Matrix::eye(n) * full->copy();
+        EXPECT_EQ(identity->format(formatter), full->format(formatter));
+        delete identity;
+
+        for (auto* matrix : {full, upper, lower, diagonal, affine, permutation}) {
+            delete matrix;
+        }
+    }
+}
+
+TEST(matrix, structuredNumericTransformsOfFour) {
+    // A numeric scaling composed with a translation is only a scaling of
+    // the translation, and keeps the affine last row
+    auto* scale = Matrix::square({2.0f, 0.0f, 0.0f, 0.0f,
+                                  0.0f, 3.0f, 0.0f, 0.0f,
+                                  0.0f, 0.0f, 4.0f, 0.0f,
+                                  0.0f, 0.0f, 0.0f, 1.0f});
+    auto* translate = Matrix::square({1.0f, 0.0f, 0.0f, 5.0f,
+                                      0.0f, 1.0f, 0.0f, 6.0f,
+                                      0.0f, 0.0f, 1.0f, 7.0f,
+                                      0.0f, 0.0f, 0.0f, 1.0f});
+
+    auto* product = dynamic_cast<Matrix*>(*scale->copy() * translate->copy());
+    DefaultFormatter formatter {};
+    EXPECT_EQ(product->format(formatter), "[2,0,0,10;0,3,0,18;0,0,4,28;0,0,0,1]");
+    EXPECT_NE(product->getStructure() & Matrix::AFFINE, 0u);
+    EXPECT_NE(product->getStructure() & Matrix::UPPER, 0u);
+
+    delete product;
+    delete scale;
+    delete translate;
+}
+
+TEST(matrix, symmetricProductsMirrorTheUpperTriangle) {
+    DefaultFormatter formatter {};
+    for (int n : {3, 6}) {
+        auto* matrix = namedMatrix(n, "a", [](int, int) { return false; });
+        auto* transposed = dynamic_cast<Matrix*>(matrix->copy())->transpose();
+        EXPECT_EQ(matrix->getStructure() & Matrix::SYMMETRIC, 0u);
+
+        for (auto& pair : {std::make_pair(matrix, transposed), std::make_pair(transposed, matrix)}) {
+            Symbol* product = *pair.first->copy() * pair.second->copy();
+            auto* result = dynamic_cast<Matrix*>(product);
+            EXPECT_NE(result->getStructure() & Matrix::SYMMETRIC, 0u);
+
+            // The lower triangle is a copy of the upper triangle, so its
+            // factors are in the same order as there.
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    Symbol* expected = j >= i
+                        ? expectedElement(pair.first, pair.second, i, j)
+                        : result->get(j, i)->copy();
+                    EXPECT_EQ(result->get(i, j)->format(formatter), expected->format(formatter));
+                    if (j != i) {
+                        EXPECT_NE(result->get(i, j), result->get(j, i));
+                    }
+                    delete expected;
+                }
+            }
+            delete product;
+        }
+
+        delete matrix;
+        delete transposed;
+    }
+}
+
+TEST(matrix, findSymmetricStructure) {
+    auto* matrix = Matrix::square({_("a"), _("b"), _("b"), _("c")});
+    EXPECT_EQ(matrix->getStructure(), Matrix::SYMMETRIC);
+
+    LatexFormatter latex {};
+    EXPECT_EQ(matrix->format(latex), "\\left[\\begin{matrix}a & b \\\\ b & c\\end{matrix}\\right]");
+
+    // The product of a symmetric matrix with itself is also symmetric
+    Symbol* square = *matrix->copy() * matrix->copy();
+    EXPECT_EQ(dynamic_cast<Matrix*>(square)->getStructure(), Matrix::SYMMETRIC);
+
+    matrix->set(1, 0, _("d"));
+    EXPECT_EQ(matrix->getStructure(), Matrix::GENERAL);
+
+    delete square;
+    delete matrix;
+}
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include "gtest/gtest.h"
+#include "../src/optimizer.hpp"
+#include "../src/matrix.hpp"
+#include "../src/product.hpp"
+#include "../src/helper.hpp"
+#include "../src/default-formatter.hpp"
+
+namespace {
+    Symbol* rotationTimesScale() {
+        auto* rotation = Matrix::square({_("c"), _("s"), _("d"), _("c")});
+        auto* scale = Matrix::square({_("s_x"), _(0.0f), _(0.0f), _("s_y")});
+        return new Product(rotation, scale);
+    }
+}
+
+TEST(optimizer, reuseIdenticalSubexpressions) {
+    Optimizer optimizer {};
+    DefaultFormatter formatter {};
+
+    Symbol* first = optimizer.optimize(rotationTimesScale());
+    EXPECT_EQ(optimizer.getMemoHits(), 0);
+
+    Symbol* second = optimizer.optimize(rotationTimesScale());
+    EXPECT_EQ(optimizer.getMemoHits(), 1);
+
+    EXPECT_EQ(first->format(formatter), second->format(formatter));
+    EXPECT_EQ(first->format(formatter), "[c*s_x,s*s_y;d*s_x,c*s_y]");
+
+    delete first;
+    delete second;
+}
+
+TEST(optimizer, reuseSubtreesOfOtherExpressions) {
+    Optimizer optimizer {};
+    DefaultFormatter formatter {};
+
+    delete optimizer.optimize(rotationTimesScale());
+    EXPECT_EQ(optimizer.getMemoHits(), 0);
+
+    // Only the product below the new root has been seen before
+    Symbol* result = optimizer.optimize(new Product(_("k"), rotationTimesScale()));
+    EXPECT_EQ(optimizer.getMemoHits(), 1);
+    EXPECT_EQ(result->format(formatter), "[c*k*s_x,k*s*s_y;d*k*s_x,c*k*s_y]");
+
+    delete result;
+}
+
+TEST(optimizer, levelZeroLeavesExpressionsAsParsed) {
+    Optimizer optimizer {0};
+    DefaultFormatter formatter {};
+
+    Symbol* result = optimizer.optimize(new Product(_("b"), _("a")));
+    EXPECT_EQ(result->format(formatter), "b*a");
+    delete result;
+
+    // Known matrices are still multiplied, only the elements are left as
+    // they were
+    result = optimizer.optimize(rotationTimesScale());
+    EXPECT_TRUE(dynamic_cast<Matrix*>(result));
+    delete result;
+}
+
+TEST(optimizer, multiplyKnownMatricesOverBudget) {
+    Optimizer optimizer {};
+    optimizer.setTimeBudget(1e-9);
+    DefaultFormatter formatter {};
+
+    delete optimizer.optimize(rotationTimesScale());
+    Symbol* result = optimizer.optimize(rotationTimesScale());
+    EXPECT_TRUE(dynamic_cast<Matrix*>(result));
+    delete result;
+}
+
+TEST(optimizer, mergeTermsWithEqualFactors) {
+    Optimizer optimizer {};
+    DefaultFormatter formatter {};
+
+    // 3*a*b + b*a - 4*a*b + c
+    auto* product1 = new Product(_("a"), _("b"));
+    auto* product2 = new Product(_("b"), _("a"));
+    auto* product3 = new Product(_("a"), _("b"));
+    Symbol* sum = *(*(*(*product1 * _(3.0f)) + product2) - (*product3 * _(4.0f))) + _("c");
+
+    Symbol* result = optimizer.optimize(sum);
+    EXPECT_EQ(result->format(formatter), "c");
+
+    delete result;
+}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/parallel.hpp"
+
+TEST(parallel, visitEveryIndexOnceOnReusedThreads) {
+    Parallel::setThreads(4);
+
+    // Several loops in a row are handed to the same workers
+    for (int round = 0; round < 50; round++) {
+        std::vector<std::atomic<int>> visits(1000);
+        Parallel::forRange(0, 1000, 7, [&](int from, int to) {
+            for (int i = from; i < to; i++) visits[i]++;
+        });
+        for (auto& count : visits) ASSERT_EQ(count.load(), 1);
+    }
+
+    Parallel::setThreads(0);
+}
+
+TEST(parallel, runNestedLoopsOnTheCallingThread) {
+    Parallel::setThreads(4);
+
+    std::atomic<long> total {0};
+    Parallel::forRange(0, 16, 1, [&](int from, int to) {
+        for (int i = from; i < to; i++) {
+            Parallel::forRange(0, 100, 1, [&](int inner, int innerTo) {
+                total += innerTo - inner;
+            });
+        }
+    });
+    EXPECT_EQ(total.load(), 1600);
+
+    Parallel::setThreads(0);
+}
+
+TEST(parallel, rethrowExceptionsFromWorkers) {
+    Parallel::setThreads(4);
+
+    EXPECT_THROW(Parallel::forRange(0, 100, 1, [](int from, int) {
+        if (from == 42) throw std::invalid_argument("Failed.");
+    }), std::invalid_argument);
+
+    // The pool can still be used afterwards
+    std::atomic<int> count {0};
+    Parallel::forRange(0, 100, 1, [&](int from, int to) { count += to - from; });
+    EXPECT_EQ(count.load(), 100);
+
+    Parallel::setThreads(0);
+}
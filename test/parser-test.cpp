@@ -9,6 +9,7 @@
 #include "../src/variable.hpp"
 #include "../src/constant.hpp"
 #include "../src/matrix.hpp"
+#include "../src/default-formatter.hpp"
 
 TEST(constant, parseSimpleAddition) {
     Parser parser{};
@@ -67,4 +68,319 @@ TEST(constant, parseMatrixExpression) {
 
     EXPECT_TRUE(dynamic_cast<Variable*>(matrix->get(1, 1)));
     EXPECT_STREQ(dynamic_cast<Variable*>(matrix->get(1, 1))->getName().c_str(), "d");
-}
\ No newline at end of file
+}
+
+TEST(parser, parseScalarPower) {
+    Parser parser{};
+
+    std::stringstream input {"x = 2^3^2; y = -3*a^2*a; z = (a+b)^2;"};
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("x")->format(formatter), "512");
+    EXPECT_EQ(parser.get("y")->format(formatter), "(-3)*a^3");
+    EXPECT_EQ(parser.get("z")->format(formatter), "(a^2+2*a*b+b^2)");
+}
+
+TEST(parser, parseMatrixPower) {
+    Parser parser{};
+
+    std::stringstream input {};
+    input << "A = [1,1;1,0];\n";
+    input << "F = A^10;\n";
+    input << "I = A^0;\n";
+    input << "S = A*A;\n";
+    input << "n = 3;\n";
+    input << "C = A^n;\n";
+    input << "V = [2,0;0,4]^-2;\n";
+    input << "W = A^-1;";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("F")->format(formatter), "[89,55;55,34]");
+    EXPECT_EQ(parser.get("I")->format(formatter), "[1,0;0,1]");
+    EXPECT_EQ(parser.get("S")->format(formatter), "[2,1;1,1]");
+    EXPECT_EQ(parser.get("C")->format(formatter), "[3,2;2,1]");
+    EXPECT_EQ(parser.get("V")->format(formatter), "[0.25,0;0,0.0625]");
+    EXPECT_EQ(parser.get("W")->format(formatter), "[0,1;1,(-1)]");
+
+    Parser rectangular{};
+    std::stringstream rectangularInput {"A = [1,2,3;4,5,6]; B = A^2;"};
+    EXPECT_THROW(rectangular.parse(rectangularInput), std::invalid_argument);
+
+    Parser unknown{};
+    std::stringstream unknownInput {"A = [1,1;1,0]; B = A^k;"};
+    EXPECT_THROW(unknown.parse(unknownInput), std::invalid_argument);
+}
+
+TEST(parser, parseTransposedNames) {
+    Parser parser{};
+
+    std::stringstream input {};
+    input << "A = [1,2,3;4,5,6];\n";
+    input << "B = A';\n";
+    input << "C = A'*A;\n";
+    input << "D = A'';\n";
+    input << "E = x';\n";
+    input << "F = A'/2;";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("B")->format(formatter), "[1,4;2,5;3,6]");
+    EXPECT_EQ(parser.get("C")->format(formatter), "[17,22,27;22,29,36;27,36,45]");
+    EXPECT_EQ(parser.get("D")->format(formatter), "[1,2,3;4,5,6]");
+    EXPECT_EQ(parser.get("E")->format(formatter), "x");
+    EXPECT_EQ(parser.get("F")->format(formatter), "[0.5,2;1,2.5;1.5,3]");
+
+    Parser divided{};
+    std::stringstream dividedInput {"A = [1,2;3,4]; B = A'/x;"};
+    EXPECT_THROW(divided.parse(dividedInput), std::invalid_argument);
+
+    Parser untransposed{};
+    std::stringstream untransposedInput {"A = [1,2;3,4]; B = A/x;"};
+    EXPECT_THROW(untransposed.parse(untransposedInput), std::invalid_argument);
+}
+
+TEST(parser, findElementsLazily) {
+    const std::string source =
+        "A = [1,2;3,4]; B = [a,b;c,d]; v = [x;y]; C = A*B*v; D = 2*B'; E = A^2;";
+    DefaultFormatter formatter {};
+
+    Parser eager{};
+    std::stringstream eagerInput {source};
+    EXPECT_TRUE(eager.parse(eagerInput));
+
+    Parser lazy{};
+    lazy.setLazy(true);
+    std::stringstream lazyInput {source};
+    EXPECT_TRUE(lazy.parse(lazyInput));
+
+    for (auto& query : {"D[0,1]", "D[1,:]", "E[:,1]", "C"}) {
+        Symbol* expected = eager.find(query);
+        Symbol* actual = lazy.find(query);
+        EXPECT_EQ(actual->format(formatter), expected->format(formatter)) << query;
+        delete expected;
+        delete actual;
+    }
+
+    // The row of A*B is multiplied with v, without computing all of A*B
+    Symbol* element = lazy.find("C[1,0]");
+    EXPECT_EQ(element->format(formatter), "(3*a*x+4*c*x+3*b*y+4*d*y)");
+    delete element;
+
+    EXPECT_THROW(lazy.find("C[2,0]"), std::invalid_argument);
+    EXPECT_THROW(lazy.find("C[0,0"), std::invalid_argument);
+}
+
+TEST(parser, parseDeterminantAndInverse) {
+    Parser parser{};
+
+    std::stringstream input {};
+    input << "A = [a,b;c,d];\n";
+    input << "D = det(A);\n";
+    input << "I = inv([a,0;0,b]);\n";
+    input << "x = [2,1;1,3] \\ [1;2];";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("D")->format(formatter), "(a*d-b*c)");
+    EXPECT_EQ(parser.get("I")->format(formatter), "[1/a,0;0,1/b]");
+    EXPECT_EQ(parser.get("x")->format(formatter), "[0.2;0.6]");
+
+    Parser singular{};
+    std::stringstream singularInput {"S = inv([1,2;2,4]);"};
+    EXPECT_THROW(singular.parse(singularInput), std::invalid_argument);
+}
+
+TEST(parser, rewriteWholeMatrices) {
+    Parser parser{};
+    parser.setUppercaseMatrices(true);
+
+    std::stringstream input {};
+    input << "A = [a,b;c,d];\n";
+    input << "B = A*[1;1];\n";
+    input << "C = X*Y';\n";
+    input << "D = (X*Y)';\n";
+    input << "E = X*inv(X)*Y;\n";
+    input << "F = A*eye(2);\n";
+    input << "G = 2*X + Y - 2*X;\n";
+    input << "H = A - A;";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    // Undefined uppercase names are matrices that keep their place
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("B")->format(formatter), "[(a+b);(c+d)]");
+    EXPECT_EQ(parser.get("C")->format(formatter), "X*Y'");
+    EXPECT_EQ(parser.get("D")->format(formatter), "Y'*X'");
+    EXPECT_EQ(parser.get("E")->format(formatter), "Y");
+    EXPECT_EQ(parser.get("F")->format(formatter), "[a,b;c,d]");
+    EXPECT_EQ(parser.get("G")->format(formatter), "Y");
+    EXPECT_EQ(parser.get("H")->format(formatter), "[0,0;0,0]");
+
+    Parser mismatched{};
+    std::stringstream mismatchedInput {"A = [1,2;3,4]; B = A*[1,2,3];"};
+    EXPECT_THROW(mismatched.parse(mismatchedInput), std::invalid_argument);
+
+    Parser identity{};
+    std::stringstream identityInput {"A = [a,b;c,d]; F = A*eye(3);"};
+    EXPECT_THROW(identity.parse(identityInput), std::invalid_argument);
+
+    // Without the option, uppercase names are scalars
+    Parser scalars{};
+    std::stringstream scalarInput {"s = a*T + T*a; t = A*B - B*A;"};
+    EXPECT_TRUE(scalars.parse(scalarInput));
+    EXPECT_EQ(scalars.get("s")->format(formatter), "2*T*a");
+    EXPECT_EQ(scalars.get("t")->format(formatter), "0");
+}
+
+TEST(parser, evaluateDefinedMatricesAtEveryLevel) {
+    for (int level = 0; level <= 2; level++) {
+        Parser parser{};
+        parser.getOptimizer().setLevel(level);
+
+        std::stringstream input {"A = [a,b;c,d]; w = A*[1;1]; s = A+A;"
+                                 "B = [2,0;0,4]; x = solve(B, [2;2]);"
+                                 "f = x_a*y; g = d(f, x_a);"};
+        EXPECT_TRUE(parser.parse(input));
+
+        DefaultFormatter formatter {};
+        EXPECT_EQ(parser.get("w")->format(formatter), "[(a+b);(c+d)]");
+        EXPECT_EQ(parser.get("s")->format(formatter), "[2*a,2*b;2*c,2*d]");
+        EXPECT_EQ(parser.get("x")->format(formatter), "[1;0.5]");
+        EXPECT_EQ(parser.get("g")->format(formatter), "y");
+    }
+}
+
+TEST(parser, subtractProductsOfDefinedMatrices) {
+    for (int level = 0; level <= 2; level++) {
+        Parser parser{};
+        parser.setUppercaseMatrices(true);
+        parser.getOptimizer().setLevel(level);
+
+        std::stringstream input {"a = [1,2;3,4]; b = [1,1;1,1]; c = a - b*a;"
+                                 "e = (-1)*(a*[1,0;0,1]); F = X - Y*X;"};
+        EXPECT_TRUE(parser.parse(input));
+
+        DefaultFormatter formatter {};
+        EXPECT_EQ(parser.get("c")->format(formatter), "[(-3),(-4);(-1),(-2)]");
+        EXPECT_EQ(parser.get("e")->format(formatter), "[(-1),(-2);(-3),(-4)]");
+        EXPECT_NE(parser.get("F")->format(formatter), "(X+Y*X)");
+    }
+
+    // The constant is kept first as parsed, later passes may move it
+    Parser parser{};
+    parser.setUppercaseMatrices(true);
+    parser.getOptimizer().setLevel(0);
+    std::stringstream input {"F = X - Y*X;"};
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("F")->format(formatter), "(X-1*Y*X)");
+}
+
+TEST(parser, multiplySumsOfNonSquareMatrices) {
+    for (int level = 0; level <= 2; level++) {
+        Parser parser{};
+        parser.getOptimizer().setLevel(level);
+
+        std::stringstream input {"a = [1;2]; b = [3;4]; c = [1,2];"
+                                 "d = (a+b)*c; e = c*(a+b);"};
+        EXPECT_TRUE(parser.parse(input));
+
+        DefaultFormatter formatter {};
+        EXPECT_EQ(parser.get("d")->format(formatter), "[4,8;6,12]");
+        EXPECT_EQ(parser.get("e")->format(formatter), "[16]");
+    }
+
+    Parser mismatched{};
+    std::stringstream mismatchedInput {"a = [1;2]; b = [3;4]; d = (a+b)*[1,2,3;4,5,6];"};
+    EXPECT_THROW(mismatched.parse(mismatchedInput), std::invalid_argument);
+}
+
+TEST(parser, parseSlices) {
+    Parser parser{};
+    parser.setUppercaseMatrices(true);
+
+    std::stringstream input {};
+    input << "A = [1,2,3,4;5,6,7,8;9,10,11,12;0,0,0,1];\n";
+    input << "R = A[0:3, 0:3];\n";
+    input << "t = A[0:3, 3];\n";
+    input << "c = A[:, 1]';\n";
+    input << "e = A[1, 2];\n";
+    input << "B = X[1:, :];";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("R")->format(formatter), "[1,2,3;5,6,7;9,10,11]");
+    EXPECT_EQ(parser.get("t")->format(formatter), "[4;8;12]");
+    EXPECT_EQ(parser.get("c")->format(formatter), "[2,6,10,0]");
+    EXPECT_EQ(parser.get("e")->format(formatter), "7");
+    EXPECT_EQ(parser.get("B")->format(formatter), "X[1:,:]");
+
+    Parser outside{};
+    std::stringstream outsideInput {"A = [1,2;3,4]; B = A[0:3, 0];"};
+    EXPECT_THROW(outside.parse(outsideInput), std::invalid_argument);
+}
+
+TEST(parser, optimizeSlicesOfProducts) {
+    const char* expected[] = {
+        "[w*x*y,w*x*(w^2+3*w),0,0;0,0,0,0;0,0,0,0;0,0,0,0]",
+        "[w*x*y,(w^3*x+3*w^2*x),0,0;0,0,0,0;0,0,0,0;0,0,0,0]",
+        "[w*x*y,(w^3*x+3*w^2*x),0,0;0,0,0,0;0,0,0,0;0,0,0,0]"
+    };
+
+    for (int level = 0; level <= 2; level++) {
+        Parser parser{};
+        parser.getOptimizer().setLevel(level);
+
+        std::stringstream input {
+            "ma = (([0,0,0;0,0,0;0,0,(w*x);0,0,0;0,0,0;0,0,0]"
+            "*[0,0,0,0,0;0,0,0,0,0;0,y,((w+3)*w),0,0]))[2:6,1:5];"};
+        EXPECT_TRUE(parser.parse(input));
+
+        DefaultFormatter formatter {};
+        EXPECT_EQ(parser.get("ma")->format(formatter), expected[level]);
+    }
+}
+
+TEST(parser, parseElementwiseOperators) {
+    Parser parser{};
+    parser.setUppercaseMatrices(true);
+
+    std::stringstream input {};
+    input << "A = [1,2,3;4,5,6];\n";
+    input << "P = A .* [a,0,b;c,d,0];\n";
+    input << "Q = A ./ [1,2,3;4,5,6];\n";
+    input << "R = A .* [2,1,0];\n";
+    input << "S = A ./ [1;2];\n";
+    input << "T = 2 .* A;\n";
+    input << "U = X .* Y;";
+
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("P")->format(formatter), "[a,0,3*b;4*c,5*d,0]");
+    EXPECT_EQ(parser.get("Q")->format(formatter), "[1,1,1;1,1,1]");
+    EXPECT_EQ(parser.get("R")->format(formatter), "[2,2,0;8,5,0]");
+    EXPECT_EQ(parser.get("S")->format(formatter), "[1,2,3;2,2.5,3]");
+    EXPECT_EQ(parser.get("T")->format(formatter), "[2,4,6;8,10,12]");
+    EXPECT_EQ(parser.get("U")->format(formatter), "times(X,Y)");
+
+    // Only the element that is asked for is multiplied
+    Parser lazy{};
+    lazy.setLazy(true);
+    std::stringstream lazyInput {"A = [1,2;3,4]; B = [a,b;c,d]; C = A .* B' ./ [1,2];"};
+    EXPECT_TRUE(lazy.parse(lazyInput));
+    Symbol* element = lazy.find("C[1,0]");
+    EXPECT_EQ(element->format(formatter), "3*b");
+    delete element;
+
+    Parser mismatch{};
+    std::stringstream mismatchInput {"A = [1,2;3,4]; B = A .* [1,2,3];"};
+    EXPECT_THROW(mismatch.parse(mismatchInput), std::invalid_argument);
+}
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/parser.hpp"
+#include "../src/result-cache.hpp"
+#include "../src/serializer.hpp"
+#include "../src/default-formatter.hpp"
+#include "../src/matrix.hpp"
+#include "../src/helper.hpp"
+
+TEST(cache, serializeMatrixRoundTrip) {
+    auto* matrix = Matrix::square({
+        _("a"), _(2.0f),
+        *_("b") + _("c"), *_("d") * _("e")
+    });
+
+    std::string data;
+    Serializer::encode(data, matrix);
+
+    const char* cursor = data.data();
+    Symbol* decoded = Serializer::decode(cursor, data.data() + data.size());
+    EXPECT_EQ(cursor, data.data() + data.size());
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(decoded->format(formatter), matrix->format(formatter));
+
+    delete decoded;
+    delete matrix;
+}
+
+TEST(cache, compareTreesNodeByNode) {
+    Symbol* first = *_("a") * (*_("b") + _("c"));
+    Symbol* second = *_("a") * (*_("b") + _("c"));
+    Symbol* third = *_("a") * (*_("b") + _("d"));
+
+    EXPECT_TRUE(Serializer::isSame(first, second));
+    EXPECT_FALSE(Serializer::isSame(first, third));
+
+    delete first;
+    delete second;
+    delete third;
+}
+
+TEST(cache, reuseResultsBetweenRuns) {
+    const auto directory = std::filesystem::temp_directory_path() / "solve-cache-test";
+    std::filesystem::remove_all(directory);
+
+    const std::string source = "A = [2,0;0,3]; B = [a,b;c,d]; C = A * B;";
+    DefaultFormatter formatter {};
+
+    std::string first;
+    {
+        ResultCache cache {directory.string()};
+        Parser parser {};
+        parser.setCache(&cache);
+        std::stringstream input {source};
+        EXPECT_TRUE(parser.parse(input));
+        EXPECT_EQ(cache.getHits(), 0);
+        first = parser.format(formatter);
+    }
+
+    {
+        ResultCache cache {directory.string()};
+        Parser parser {};
+        parser.setCache(&cache);
+        std::stringstream input {source};
+        EXPECT_TRUE(parser.parse(input));
+        EXPECT_EQ(cache.getHits(), 3);
+        EXPECT_EQ(parser.format(formatter), first);
+    }
+
+    {
+        // Changing a dependency invalidates the define that uses it
+        ResultCache cache {directory.string()};
+        Parser parser {};
+        parser.setCache(&cache);
+        std::stringstream input {"A = [2,0;0,4]; B = [a,b;c,d]; C = A * B;"};
+        EXPECT_TRUE(parser.parse(input));
+        EXPECT_EQ(cache.getHits(), 1);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(cache, ignoreEntriesOfOtherVersions) {
+    const auto directory = std::filesystem::temp_directory_path() / "solve-cache-version-test";
+    std::filesystem::remove_all(directory);
+
+    ResultCache cache {directory.string()};
+    auto* matrix = Matrix::square({_("a"), _("b"), _("c"), _("d")});
+    cache.store(1, matrix);
+    delete matrix;
+
+    Symbol* loaded = cache.load(1);
+    EXPECT_NE(loaded, nullptr);
+    delete loaded;
+
+    // Rewrite the version that follows the magic
+    const auto entry = directory / "0000000000000001.sym";
+    {
+        std::fstream file {entry, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekp(6);
+        file.put((char) (ResultCache::VERSION - 1));
+    }
+
+    EXPECT_EQ(cache.load(1), nullptr);
+    EXPECT_EQ(cache.getHits(), 1);
+    EXPECT_EQ(cache.getMisses(), 1);
+
+    // Nothing but the entry is left behind
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator{directory},
+                            std::filesystem::directory_iterator{}), 1);
+
+    std::filesystem::remove_all(directory);
+}
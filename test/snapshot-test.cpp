@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+#include "../src/parser.hpp"
+#include "../src/snapshot.hpp"
+#include "../src/default-formatter.hpp"
+
+TEST(snapshot, saveAndLoadDefines) {
+    const auto filename = (std::filesystem::temp_directory_path() / "solve-snapshot-test.snap").string();
+    DefaultFormatter formatter {};
+
+    std::string expected;
+    {
+        Parser parser {};
+        std::stringstream input {"A = [2,0;0,3]; B = [a,b;c,d]; C = A * B; x = 5*y + 2*y;"};
+        EXPECT_TRUE(parser.parse(input));
+        expected = parser.format(formatter);
+        Snapshot::save(parser, filename);
+    }
+
+    Parser parser {};
+    Snapshot::load(parser, filename);
+    EXPECT_EQ(parser.getDefines().size(), 4);
+    EXPECT_EQ(parser.format(formatter), expected);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(snapshot, rejectOtherFiles) {
+    const auto filename = (std::filesystem::temp_directory_path() / "solve-snapshot-invalid.snap").string();
+    {
+        std::ofstream out(filename);
+        out << "A = [1,2];";
+    }
+
+    Parser parser {};
+    EXPECT_THROW(Snapshot::load(parser, filename), std::invalid_argument);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(snapshot, keepDefinesIfTruncated) {
+    const auto filename = (std::filesystem::temp_directory_path() / "solve-snapshot-truncated.snap").string();
+    {
+        Parser parser {};
+        std::stringstream input {"A = [2,0;0,3]; B = [a,b;c,d]; C = A * B;"};
+        EXPECT_TRUE(parser.parse(input));
+        Snapshot::save(parser, filename);
+    }
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 4);
+
+    Parser parser {};
+    std::stringstream input {"x = 2;"};
+    EXPECT_TRUE(parser.parse(input));
+    EXPECT_THROW(Snapshot::load(parser, filename), std::invalid_argument);
+    EXPECT_EQ(parser.getDefines().size(), 1);
+
+    std::filesystem::remove(filename);
+}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include <cmath>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/sparse.hpp"
+#include "../src/sparse-matrix.hpp"
+#include "../src/matrix.hpp"
+#include "../src/constant.hpp"
+#include "../src/parser.hpp"
+#include "../src/default-formatter.hpp"
+
+namespace {
+    // The five-point Laplacian on a square grid, which is symmetric
+    // positive definite like a stiffness matrix.
+    Sparse laplacian(int side) {
+        std::vector<Sparse::Entry> entries;
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                const int k = i * side + j;
+                entries.push_back({k, k, 4.0});
+                if (i > 0) entries.push_back({k, k - side, -1.0});
+                if (i < side - 1) entries.push_back({k, k + side, -1.0});
+                if (j > 0) entries.push_back({k, k - 1, -1.0});
+                if (j < side - 1) entries.push_back({k, k + 1, -1.0});
+            }
+        }
+        return Sparse{side * side, side * side, std::move(entries)};
+    }
+
+    double residual(const Sparse& matrix, const std::vector<double>& solution,
+                    const std::vector<double>& right) {
+        std::vector<double> product;
+        matrix.multiply(solution, product);
+        double sum = 0.0, norm = 0.0;
+        for (std::size_t i = 0; i < right.size(); i++) {
+            sum += (product[i] - right[i]) * (product[i] - right[i]);
+            norm += right[i] * right[i];
+        }
+        return std::sqrt(sum / norm);
+    }
+}
+
+TEST(sparse, conjugateGradientSolvesLaplacian) {
+    const Sparse matrix = laplacian(40);
+    EXPECT_EQ(matrix.getNonZeros(), 5 * 1600 - 4 * 40);
+    EXPECT_TRUE(matrix.isSymmetric());
+
+    const std::vector<double> right(matrix.getRows(), 1.0);
+    std::vector<double> solution(matrix.getRows(), 0.0);
+    const Sparse::Convergence result = matrix.conjugateGradient(right, solution);
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_LT(residual(matrix, solution, right), 1e-9);
+}
+
+TEST(sparse, biconjugateGradientSolvesNonSymmetric) {
+    // A convection term makes the matrix non-symmetric
+    std::vector<Sparse::Entry> entries;
+    const int n = 500;
+    for (int i = 0; i < n; i++) {
+        entries.push_back({i, i, 3.0});
+        if (i > 0) entries.push_back({i, i - 1, -1.5});
+        if (i < n - 1) entries.push_back({i, i + 1, -0.5});
+    }
+    const Sparse matrix {n, n, std::move(entries)};
+    EXPECT_FALSE(matrix.isSymmetric());
+
+    std::vector<double> right(n);
+    for (int i = 0; i < n; i++) right[i] = i % 7;
+    std::vector<double> solution(n, 0.0);
+    const Sparse::Convergence result = matrix.solve(right, solution);
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_LT(residual(matrix, solution, right), 1e-9);
+}
+
+TEST(sparse, saveAndLoadSumsDuplicates) {
+    const auto filename = (std::filesystem::temp_directory_path() / "solve-sparse-test.bin").string();
+
+    const Sparse assembled {3, 3, {{0, 0, 1.0}, {2, 1, 5.0}, {0, 0, 1.0}, {1, 2, -1.0}}};
+    EXPECT_EQ(assembled.getNonZeros(), 3);
+    EXPECT_EQ(assembled.get(0, 0), 2.0);
+    Sparse::save(assembled, filename);
+
+    const Sparse loaded = Sparse::load(filename);
+    EXPECT_EQ(loaded.getRows(), 3);
+    EXPECT_EQ(loaded.getColumns(), 3);
+    EXPECT_EQ(loaded.getValues(), assembled.getValues());
+    EXPECT_EQ(loaded.getColumnIndices(), assembled.getColumnIndices());
+    EXPECT_EQ(loaded.get(2, 1), 5.0);
+    EXPECT_EQ(loaded.get(2, 2), 0.0);
+
+    std::filesystem::remove(filename);
+    EXPECT_THROW(Sparse::load(filename), std::invalid_argument);
+}
+
+TEST(sparse, solveLoadedMatrixFromParser) {
+    Parser parser {};
+    parser.define("A", new SparseMatrix(Sparse{2, 2, {{0, 0, 2.0}, {0, 1, 1.0},
+                                                      {1, 0, 1.0}, {1, 1, 3.0}}}));
+
+    std::stringstream input {"x = A \\ [1;2]; z = 2*A;"};
+    EXPECT_TRUE(parser.parse(input));
+
+    DefaultFormatter formatter {};
+    EXPECT_EQ(parser.get("x")->format(formatter), "[0.2;0.6]");
+    EXPECT_EQ(parser.get("z")->format(formatter), "[4,2;2,6]");
+}
+
+TEST(sparse, solveLargeSparseLiteralIteratively) {
+    const int n = 300;
+    auto* matrix = Matrix::zero(n, n);
+    auto* right = Matrix::zero(n, 1);
+    for (int i = 0; i < n; i++) {
+        matrix->set(i, i, new Constant{2.5f});
+        if (i > 0) matrix->set(i, i - 1, new Constant{-1.0f});
+        if (i < n - 1) matrix->set(i, i + 1, new Constant{-1.0f});
+        right->set(i, 0, new Constant{1.0f});
+    }
+    EXPECT_TRUE(Sparse::suits(matrix));
+
+    Matrix* solution = matrix->solve(right);
+    for (int i = 0; i < n; i++) {
+        double sum = 0.0;
+        for (int k = std::max(i - 1, 0); k <= std::min(i + 1, n - 1); k++) {
+            sum += dynamic_cast<Constant*>(matrix->get(i, k))->getValue() *
+                   dynamic_cast<Constant*>(solution->get(k, 0))->getValue();
+        }
+        EXPECT_NEAR(sum, 1.0, 1e-5) << i;
+    }
+
+    delete solution;
+    delete right;
+    delete matrix;
+}
@@ -0,0 +1,34 @@
+//
+// Copyright (c) 2020 Emil Forslund. All rights reserved.
+//
+
+#include "gtest/gtest.h"
+#include "../src/stats.hpp"
+#include "../src/symbol.hpp"
+#include "../src/helper.hpp"
+
+TEST(stats, countAllocationsInScope) {
+    Stats::Allocations allocations {};
+    auto* sum = *_("a") + _("b");
+    delete sum;
+    allocations.close();
+
+    EXPECT_GE(allocations.getCount(), 3);
+    EXPECT_GT(allocations.getBytes(), 0);
+    EXPECT_GT(allocations.getPeakBytes(), Stats::getLiveBytes());
+}
+
+TEST(stats, nestedScopePeakIsIncludedInOuterScope) {
+    Stats::Allocations outer {};
+    long innerPeak;
+    {
+        Stats::Allocations inner {};
+        auto* product = *_("a") * _("b");
+        delete product;
+        inner.close();
+        innerPeak = inner.getPeakBytes();
+    }
+
+    EXPECT_GT(innerPeak, Stats::getLiveBytes());
+    EXPECT_EQ(outer.getPeakBytes(), innerPeak);
+}